@@ -0,0 +1,132 @@
+/**
+ * @file include/board/BitBoard.hpp
+ * @author Yuki Kobayashi
+ * @~english
+ * @brief Bitboard operations.
+ * @~japanese
+ * @brief ビットボードの操作
+ */
+#ifndef _BIT_BOARD_HPP_
+#define _BIT_BOARD_HPP_
+
+#if defined (_WIN32)
+#include <intrin.h>
+#endif
+
+#include "board/BoardData.hpp"
+#include "board/Constant.hpp"
+
+
+// 盤上の全ての点の集合
+extern unsigned long long board_bits[BITBOARD_WORDS];
+
+// 現在の盤の大きさで使うワード数
+extern int bitboard_words;
+
+// ビットボードの定数の初期化
+void InitializeBitBoard( void );
+
+// 各色の領域 (石と4近傍が同色の空点) の計算
+void CalculateAreaBits( const game_info_t *game, unsigned long long black_area[], unsigned long long white_area[] );
+
+
+/**
+ * @~english
+ * @brief Count set bits.
+ * @param[in] bits Bit sequence.
+ * @return The number of set bits.
+ * @~japanese
+ * @brief 立っているビットの数の計算
+ * @param[in] bits ビット列
+ * @return 立っているビットの数
+ */
+inline int
+PopCount( const unsigned long long bits )
+{
+#if defined (_WIN32)
+  return static_cast<int>(__popcnt64(bits));
+#else
+  return __builtin_popcountll(bits);
+#endif
+}
+
+
+/**
+ * @~english
+ * @brief Get the index of the lowest set bit. bits must not be 0.
+ * @param[in] bits Bit sequence.
+ * @return Index of the lowest set bit.
+ * @~japanese
+ * @brief 最下位の立っているビットの位置の取得 (bitsは0以外)
+ * @param[in] bits ビット列
+ * @return 最下位の立っているビットの位置
+ */
+inline int
+LowestBit( const unsigned long long bits )
+{
+#if defined (_WIN32)
+  unsigned long index;
+  _BitScanForward64(&index, bits);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctzll(bits);
+#endif
+}
+
+
+/**
+ * @~english
+ * @brief Find the first set bit at or after the index.
+ * @param[in] bits Bitset.
+ * @param[in] words The number of words of the bitset.
+ * @param[in] index Search start index.
+ * @return Index of found bit, or -1 if there is no set bit.
+ * @~japanese
+ * @brief 指定した位置以降で最初に立っているビットの探索
+ * @param[in] bits ビット集合
+ * @param[in] words ビット集合のワード数
+ * @param[in] index 探索を開始する位置
+ * @return 見つかったビットの位置 (見つからなければ-1)
+ */
+inline int
+FindBit( const unsigned long long *bits, const int words, const int index )
+{
+  int word = index >> 6;
+
+  if (word >= words) return -1;
+
+  unsigned long long rest = bits[word] & (~0ULL << (index & 63));
+
+  while (rest == 0) {
+    if (++word >= words) return -1;
+    rest = bits[word];
+  }
+
+  return (word << 6) + LowestBit(rest);
+}
+
+
+
+/**
+ * @~english
+ * @brief Count set bits of a bitboard.
+ * @param[in] bits Bitboard.
+ * @return The number of set bits.
+ * @~japanese
+ * @brief ビットボードの立っているビットの数の計算
+ * @param[in] bits ビットボード
+ * @return 立っているビットの数
+ */
+inline int
+CountBits( const unsigned long long bits[] )
+{
+  int count = 0;
+
+  for (int i = 0; i < bitboard_words; i++) {
+    count += PopCount(bits[i]);
+  }
+
+  return count;
+}
+
+#endif
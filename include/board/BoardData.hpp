@@ -12,6 +12,7 @@
 #include "board/Color.hpp"
 #include "board/Constant.hpp"
 #include "board/Record.hpp"
+#include "board/SuperKo.hpp"
 #include "pattern/Pattern.hpp"
 
 
@@ -41,11 +42,11 @@ struct string_t {
 
   /**
    * @~english
-   * @brief Coordinates of liberties.
+   * @brief Bitset of liberties indexed by onboard_index.
    * @~japanese
-   * @brief 連が持つ呼吸点の座標
+   * @brief 連が持つ呼吸点のビット集合 (onboard_indexで指定)
    */
-  short lib[STRING_LIB_MAX];
+  unsigned long long lib_bits[LIBERTY_WORDS];
 
   /**
    * @~english
@@ -57,11 +58,11 @@ struct string_t {
 
   /**
    * @~english
-   * @brief Neighbor string IDs.
+   * @brief Bitset of neighbor string IDs.
    * @~japanese
-   * @brief 隣接する相手の連の連番号
+   * @brief 隣接する相手の連の連番号のビット集合
    */
-  short neighbor[MAX_NEIGHBOR];
+  unsigned long long neighbor_bits[NEIGHBOR_WORDS];
 
   /**
    * @~english
@@ -177,6 +178,14 @@ struct game_info_t {
    */
   unsigned long long move_hash;
 
+  /**
+   * @~english
+   * @brief Hash set of positions which appeared by PutStone.
+   * @~japanese
+   * @brief PutStoneで現れた局面のハッシュ集合
+   */
+  superko_table_t superko_table;
+
   /**
    * @~english
    * @brief Colors of all coordinates.
@@ -185,6 +194,34 @@ struct game_info_t {
    */
   char board[BOARD_MAX];
 
+  /**
+   * @~english
+   * @brief Bitboards of stones for each color indexed by onboard_index.
+   * @~japanese
+   * @brief 各色の石の配置のビットボード (onboard_indexで指定)
+   */
+  unsigned long long stone_bits[S_MAX][BITBOARD_WORDS];
+
+  /**
+   * @~english
+   * @brief Bitboards of empty and not suicide intersections for each color, ignoring ko.
+   * They are valid for the position where SetMoveCandidateBits was called,
+   * and later moves are applied through the undo journal.
+   * @~japanese
+   * @brief 各手番の空点かつ自殺手でない交点のビットボード (劫は考慮しない)
+   * SetMoveCandidateBitsを呼んだ局面のもので, 以降の着手は変更履歴を使って反映する
+   */
+  unsigned long long legal_bits[2][BITBOARD_WORDS];
+
+  /**
+   * @~english
+   * @brief Bitboards of intersections which are not meaningless self atari for each color.
+   * They are valid for the same position as legal_bits.
+   * @~japanese
+   * @brief 各手番の意味のない自己アタリでない交点のビットボード (legal_bitsと同じ局面のもの)
+   */
+  unsigned long long meaningful_bits[2][BITBOARD_WORDS];
+
   /**
    * @~english
    * @brief The number of passes in a move history.
@@ -289,6 +326,41 @@ struct game_info_t {
    */
   int update_pos[2][PURE_BOARD_MAX];
 
+  /**
+   * @~english
+   * @brief The number of changed coordinates since the last rating update of each color.
+   * @~japanese
+   * @brief 各手番の前回のレート更新以降に石が変化した座標の個数
+   */
+  int dirty_num[2];
+
+  /**
+   * @~english
+   * @brief Coordinates whose stone changed since the last rating update of each color.
+   * @~japanese
+   * @brief 各手番の前回のレート更新以降に石が変化した座標
+   */
+  int dirty_pos[2][PURE_BOARD_MAX + 2];
+
+  /**
+   * @~english
+   * @brief Stamps of coordinates added to the list of the rating update.
+   * A coordinate is in the list when its stamp is not less than rating_stamp_count,
+   * and its neighborhood is also in the list when its stamp is rating_stamp_count + 1.
+   * @~japanese
+   * @brief レート更新の一覧に加えた座標の印
+   * 印がrating_stamp_count以上なら一覧に含まれ, rating_stamp_count + 1なら周辺の座標も含まれる
+   */
+  unsigned int rating_stamp[BOARD_MAX];
+
+  /**
+   * @~english
+   * @brief Stamp of the current rating update. It advances by 2 for each update.
+   * @~japanese
+   * @brief 現在のレート更新の印 (更新ごとに2ずつ進める)
+   */
+  unsigned int rating_stamp_count;
+
   /**
    * @~english
    * @brief Weights of each coordinate for Monte-Carlo simulation.
@@ -299,11 +371,11 @@ struct game_info_t {
 
   /**
    * @~english
-   * @brief Sum of weights of each row for Monte-Carlo simulation.
+   * @brief Sums of weights in the rate tree for Monte-Carlo simulation.
    * @~japanese
-   * @brief シミュレーション時の各列のレートの合計値
+   * @brief シミュレーション時のレートの木の合計値
    */
-  long long sum_rate_row[2][BOARD_SIZE];
+  long long sum_rate_tree[2][RATE_TREE_SIZE];
 
   /**
    * @~english
@@ -312,6 +384,54 @@ struct game_info_t {
    * @brief シミュレーション時の全体のレートの合計値
    */
   long long sum_rate[2];
+
+  /**
+   * @~english
+   * @brief The number of coordinates recorded in the undo journal.
+   * @~japanese
+   * @brief 変更履歴に記録された座標の個数
+   */
+  int journal_pos_num;
+
+  /**
+   * @~english
+   * @brief Coordinates whose stone has changed since the last copy.
+   * @~japanese
+   * @brief 盤面のコピー以降に石が変化した座標
+   */
+  int journal_pos[BOARD_MAX];
+
+  /**
+   * @~english
+   * @brief Flags whether the coordinate is recorded in the undo journal.
+   * @~japanese
+   * @brief 変更履歴への座標の記録済みフラグ
+   */
+  bool journal_pos_flag[BOARD_MAX];
+
+  /**
+   * @~english
+   * @brief The number of string IDs recorded in the undo journal.
+   * @~japanese
+   * @brief 変更履歴に記録された連IDの個数
+   */
+  int journal_string_num;
+
+  /**
+   * @~english
+   * @brief String IDs which have changed since the last copy.
+   * @~japanese
+   * @brief 盤面のコピー以降に変化した連ID
+   */
+  int journal_string[MAX_STRING];
+
+  /**
+   * @~english
+   * @brief Flags whether the string ID is recorded in the undo journal.
+   * @~japanese
+   * @brief 変更履歴への連IDの記録済みフラグ
+   */
+  bool journal_string_flag[MAX_STRING];
 };
 
 #endif
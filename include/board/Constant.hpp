@@ -12,10 +12,30 @@
 /**
  * @~english
  * @brief The size of board. Please change this value if you need optimize search speed and date size.
+ * It can be also given by -DRAY_BOARD_SIZE=n at compile time ('make ray9' etc.).
  * @~japanese
  * @brief 碁盤の大きさ. 基本的に19で良いが, データサイズと実行速度を最適化するときはサイズを変更する.
+ * コンパイル時に-DRAY_BOARD_SIZE=nで指定することもできる ('make ray9'など)
  */
+#if defined (RAY_BOARD_SIZE)
+constexpr int PURE_BOARD_SIZE = RAY_BOARD_SIZE;
+#else
 constexpr int PURE_BOARD_SIZE = 19;
+#endif
+
+/**
+ * @~english
+ * @brief The smallest board size which can be played. Fixed board size builds play only PURE_BOARD_SIZE,
+ * so that coordinate calculations become compile-time constants.
+ * @~japanese
+ * @brief 扱える最も小さい盤の大きさ
+ * 盤の大きさを固定したビルドでは座標の計算をコンパイル時定数にするため, PURE_BOARD_SIZEの盤だけを扱う
+ */
+#if defined (RAY_BOARD_SIZE)
+constexpr int MIN_PURE_BOARD_SIZE = PURE_BOARD_SIZE;
+#else
+constexpr int MIN_PURE_BOARD_SIZE = 1;
+#endif
 
 /**
  * @~english
@@ -89,6 +109,66 @@ constexpr int BOARD_END = PURE_BOARD_SIZE + OB_SIZE - 1;
  */
 constexpr int STRING_LIB_MAX = BOARD_SIZE * (PURE_BOARD_SIZE + OB_SIZE);
 
+/**
+ * @~english
+ * @brief The number of 64-bit words for a bitboard (384 bits on 19x19).
+ * @~japanese
+ * @brief ビットボードの64ビットワード数 (19路盤で384ビット)
+ */
+constexpr int BITBOARD_WORDS = (PURE_BOARD_MAX + 63) / 64;
+
+/**
+ * @~english
+ * @brief The number of 64-bit words for a liberty bitset.
+ * @~japanese
+ * @brief 呼吸点のビット集合の64ビットワード数
+ */
+constexpr int LIBERTY_WORDS = BITBOARD_WORDS;
+
+/**
+ * @~english
+ * @brief The number of 64-bit words for a neighbor string set.
+ * @~japanese
+ * @brief 隣接する敵連の集合の64ビットワード数
+ */
+constexpr int NEIGHBOR_WORDS = (MAX_NEIGHBOR + 63) / 64;
+
+/**
+ * @~english
+ * @brief Log2 of the fan-out of the simulation rate tree.
+ * A node of the tree sums 8 children, which fit in one cache line.
+ * @~japanese
+ * @brief シミュレーションのレートの木の分岐数の2の対数
+ * 木の各節は1つのキャッシュラインに収まる8個の子の合計を持つ
+ */
+constexpr int RATE_FANOUT_SHIFT = 3;
+
+/**
+ * @~english
+ * @brief The number of groups of coordinates in the simulation rate tree.
+ * Coordinates outside the board are included and always have zero rate.
+ * @~japanese
+ * @brief シミュレーションのレートの木の座標のグループの数
+ * 盤外の座標も含む (レートは常に0)
+ */
+constexpr int RATE_GROUP_MAX = ((BOARD_MAX - 1) >> RATE_FANOUT_SHIFT) + 1;
+
+/**
+ * @~english
+ * @brief The number of blocks of groups in the simulation rate tree.
+ * @~japanese
+ * @brief シミュレーションのレートの木のグループのブロックの数
+ */
+constexpr int RATE_BLOCK_MAX = ((RATE_GROUP_MAX - 1) >> RATE_FANOUT_SHIFT) + 1;
+
+/**
+ * @~english
+ * @brief Size of sums in the simulation rate tree (groups followed by blocks).
+ * @~japanese
+ * @brief シミュレーションのレートの木の合計値の要素数 (グループの後にブロックが続く)
+ */
+constexpr int RATE_TREE_SIZE = RATE_GROUP_MAX + RATE_BLOCK_MAX;
+
 /**
  * @~english
  * @brief Maximum nuber of a string's stone.
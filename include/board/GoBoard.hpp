@@ -14,6 +14,19 @@
 #include "board/BoardData.hpp"
 
 
+/**
+ * @def BOARD_STRIDE
+ * @~english
+ * @brief Row width of internal coordinates. It is a compile-time constant in fixed board size builds.
+ * @~japanese
+ * @brief 内部表現の座標の1行の幅 (盤の大きさを固定したビルドではコンパイル時定数になる)
+ */
+#if defined (RAY_BOARD_SIZE)
+#define BOARD_STRIDE BOARD_SIZE
+#else
+#define BOARD_STRIDE board_size
+#endif
+
 /**
  * @def POS(x, y)
  * @~english 
@@ -21,7 +34,7 @@
  * @~japanese
  * @brief (x, y)から座標を導出
  */
-#define POS(x, y) ((x) + (y) * board_size)
+#define POS(x, y) ((x) + (y) * BOARD_STRIDE)
 
 /**
  * @def X(pos)
@@ -30,7 +43,7 @@
  * @~japanese
  * @brief posのx座標の取得
  */
-#define X(pos)        ((pos) % board_size)
+#define X(pos)        ((pos) % BOARD_STRIDE)
 
 /**
  * @def Y(pos)
@@ -39,7 +52,7 @@
  * @~japanese
  * @brief posのy座標の取得
  */
-#define Y(pos)        ((pos) / board_size)
+#define Y(pos)        ((pos) / BOARD_STRIDE)
 
 /**
  * @def CORRECT_X(pos)
@@ -48,7 +61,7 @@
  * @~japanese
  * @brief 実際の盤上のx座標の取得
  */
-#define CORRECT_X(pos) ((pos) % board_size - OB_SIZE + 1)
+#define CORRECT_X(pos) ((pos) % BOARD_STRIDE - OB_SIZE + 1)
 
 /**
  * @def CORRECT_Y(pos)
@@ -57,7 +70,7 @@
  * @~japanese
  * @brief 実際の盤上のy座標の取得
  */
-#define CORRECT_Y(pos) ((pos) / board_size - OB_SIZE + 1)
+#define CORRECT_Y(pos) ((pos) / BOARD_STRIDE - OB_SIZE + 1)
 
 /**
  * @def NORTH(pos)
@@ -66,7 +79,7 @@
  * @~japanese
  * @brief posの上の座標の取得
  */
-#define NORTH(pos) ((pos) - board_size)
+#define NORTH(pos) ((pos) - BOARD_STRIDE)
 
 /**
  * @def WEST(pos)
@@ -93,7 +106,7 @@
  * @~japanese
  * @brief posの下の座標の取得
  */
-#define SOUTH(pos) ((pos) + board_size)
+#define SOUTH(pos) ((pos) + BOARD_STRIDE)
 
 /**
  * @def DX(pos1, pos2)
@@ -230,6 +243,9 @@ extern int move_dis[PURE_BOARD_SIZE][PURE_BOARD_SIZE];
 // 盤上の位置からデータ上の位置の対応
 extern int onboard_pos[PURE_BOARD_MAX];
 
+// データ上の位置から盤上の位置の通し番号の対応
+extern int onboard_index[BOARD_MAX];
+
 // 初手の候補手
 extern int first_move_candidate[PURE_BOARD_MAX];
 
@@ -237,6 +253,9 @@ extern int first_move_candidate[PURE_BOARD_MAX];
 // 超劫の設定
 void SetSuperKo( const bool flag );
 
+// 超劫の設定の取得
+bool GetSuperKo( void );
+
 // 盤の大きさの設定
 void SetBoardSize( const int size );
 
@@ -249,6 +268,15 @@ void FreeGame( game_info_t *game );
 // 盤面情報のコピー
 void CopyGame( game_info_t *dst, const game_info_t *src );
 
+// 変更履歴を使ったコピー元の盤面情報への復元
+void RestoreGame( game_info_t *dst, const game_info_t *src );
+
+// 全ての交点の候補手のビットボードの計算
+void SetMoveCandidateBits( game_info_t *game );
+
+// 変更履歴を反映した合法かつ意味のある候補手の取得
+void GetMoveCandidateBits( const game_info_t *game, const int color, unsigned long long bits[] );
+
 // 定数の初期化
 void InitializeConst( void );
 
@@ -259,6 +287,11 @@ void InitializeBoard( game_info_t *game );
 // 合法手ならばtrueを返す
 bool IsLegal( const game_info_t *game, const int pos, const int color );
 
+// 超劫判定
+// 超劫になる着手ならばtrueを返す
+bool IsSuperKoMove( const char *board, const string_t *string, const int *string_id, const int *string_next,
+                    unsigned long long hash, const superko_table_t *table, const int pos, const int color );
+
 // 合法手かつ眼でないか判定
 // 合法手かつ眼でなければtrueを返す
 bool IsLegalNotEye( game_info_t *game, const int pos, const int color );
@@ -285,4 +318,107 @@ void GetNeighbor4( int neighbor4[4], const int pos );
 // 隅のマガリ四目の確認
 void CheckBentFourInTheCorner( game_info_t *game );
 
+
+/**
+ * @~english
+ * @brief Set a stone on the bitboard.
+ * @param[in, out] game Board position data.
+ * @param[in] pos Coordinate.
+ * @param[in] color Stone color.
+ * @~japanese
+ * @brief ビットボードに石を置く
+ * @param[in, out] game 局面情報
+ * @param[in] pos 座標
+ * @param[in] color 石の色
+ */
+inline void
+SetStoneBit( game_info_t *game, const int pos, const int color )
+{
+  const int index = onboard_index[pos];
+  game->stone_bits[color][index >> 6] |= 1ULL << (index & 63);
+}
+
+
+/**
+ * @~english
+ * @brief Remove a stone from the bitboard.
+ * @param[in, out] game Board position data.
+ * @param[in] pos Coordinate.
+ * @param[in] color Stone color.
+ * @~japanese
+ * @brief ビットボードから石を取り除く
+ * @param[in, out] game 局面情報
+ * @param[in] pos 座標
+ * @param[in] color 石の色
+ */
+inline void
+ClearStoneBit( game_info_t *game, const int pos, const int color )
+{
+  const int index = onboard_index[pos];
+  game->stone_bits[color][index >> 6] &= ~(1ULL << (index & 63));
+}
+
+
+/**
+ * @~english
+ * @brief Record a coordinate whose stone changed for the next rating update.
+ * @param[in, out] game Board position data.
+ * @param[in] color Player's color whose rating will be updated.
+ * @param[in] pos Coordinate.
+ * @~japanese
+ * @brief 次のレート更新のために石が変化した座標を記録
+ * @param[in, out] game 局面情報
+ * @param[in] color レートを更新する手番の色
+ * @param[in] pos 座標
+ */
+inline void
+RecordDirtyPosition( game_info_t *game, const int color, const int pos )
+{
+  int &dirty_num = game->dirty_num[color - 1];
+
+  if (dirty_num < PURE_BOARD_MAX + 2) {
+    game->dirty_pos[color - 1][dirty_num++] = pos;
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Record a coordinate whose stone changes to the undo journal.
+ * @param[in, out] game Board position data.
+ * @param[in] pos Coordinate.
+ * @~japanese
+ * @brief 石が変化する座標を変更履歴に記録
+ * @param[in, out] game 局面情報
+ * @param[in] pos 座標
+ */
+inline void
+RecordJournalPosition( game_info_t *game, const int pos )
+{
+  if (!game->journal_pos_flag[pos]) {
+    game->journal_pos_flag[pos] = true;
+    game->journal_pos[game->journal_pos_num++] = pos;
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Record a string ID which changes to the undo journal.
+ * @param[in, out] game Board position data.
+ * @param[in] id String ID.
+ * @~japanese
+ * @brief 変化する連IDを変更履歴に記録
+ * @param[in, out] game 局面情報
+ * @param[in] id 連ID
+ */
+inline void
+RecordJournalString( game_info_t *game, const int id )
+{
+  if (!game->journal_string_flag[id]) {
+    game->journal_string_flag[id] = true;
+    game->journal_string[game->journal_string_num++] = id;
+  }
+}
+
 #endif
@@ -75,6 +75,22 @@ struct undo_record_t {
    * @brief 劫が発生した箇所の記録
    */
   int ko_pos_record;
+
+  /**
+   * @~english
+   * @brief Positional hash value record for rollback operation.
+   * @~japanese
+   * @brief 局面のハッシュ値の記録
+   */
+  unsigned long long positional_hash_record;
+
+  /**
+   * @~english
+   * @brief Record of the number of positions in super ko hash set for rollback operation.
+   * @~japanese
+   * @brief 超劫判定用のハッシュ集合の局面数の記録
+   */
+  int superko_record;
 };
 
 /**
@@ -135,6 +151,22 @@ struct search_game_info_t {
    */
   char board[BOARD_MAX];
 
+  /**
+   * @~english
+   * @brief Zobrist hash value of current position (Ignoring ko situation).
+   * @~japanese
+   * @brief 現在の局面のハッシュ値 (劫は考慮しない)
+   */
+  unsigned long long positional_hash;
+
+  /**
+   * @~english
+   * @brief Hash set of positions for super ko. It is used only when super ko is activated.
+   * @~japanese
+   * @brief 超劫判定用の局面のハッシュ集合 (超劫が有効な時だけ使用)
+   */
+  superko_table_t superko_table;
+
   /**
    * @~english
    * @brief Stone patterns.
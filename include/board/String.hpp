@@ -9,7 +9,9 @@
 #ifndef _STRING_HPP_
 #define _STRING_HPP_
 
+#include "board/BitBoard.hpp"
 #include "board/BoardData.hpp"
+#include "board/GoBoard.hpp"
 
 
 // 新しい連の作成
@@ -33,4 +35,101 @@ void RemoveLiberty( game_info_t *game, string_t *string, const int pos );
 // 連の除去
 int RemoveString( game_info_t *game, string_t *string, const int color );
 
+
+/**
+ * @~english
+ * @brief Get the smallest liberty coordinate of the string.
+ * @param[in] string String.
+ * @return Coordinate of the liberty, or LIBERTY_END.
+ * @~japanese
+ * @brief 連の最も小さい呼吸点の座標の取得
+ * @param[in] string 連
+ * @return 呼吸点の座標 (なければLIBERTY_END)
+ */
+inline int
+FirstLiberty( const string_t *string )
+{
+  const int index = FindBit(string->lib_bits, LIBERTY_WORDS, 0);
+  return (index < 0) ? LIBERTY_END : onboard_pos[index];
+}
+
+
+/**
+ * @~english
+ * @brief Get the next liberty coordinate of the string.
+ * @param[in] string String.
+ * @param[in] lib Current liberty coordinate.
+ * @return Coordinate of the next liberty, or LIBERTY_END.
+ * @~japanese
+ * @brief 連の次の呼吸点の座標の取得
+ * @param[in] string 連
+ * @param[in] lib 現在の呼吸点の座標
+ * @return 次の呼吸点の座標 (なければLIBERTY_END)
+ */
+inline int
+NextLiberty( const string_t *string, const int lib )
+{
+  if (lib == LIBERTY_END) return LIBERTY_END;
+
+  const int index = FindBit(string->lib_bits, LIBERTY_WORDS, onboard_index[lib] + 1);
+  return (index < 0) ? LIBERTY_END : onboard_pos[index];
+}
+
+
+/**
+ * @~english
+ * @brief Check whether the string is adjacent to the string ID.
+ * @param[in] string String.
+ * @param[in] id Neighbor string ID.
+ * @return Neighbor flag.
+ * @~japanese
+ * @brief 隣接する敵連かどうかの判定
+ * @param[in] string 連
+ * @param[in] id 隣接する連のID
+ * @return 隣接していればtrue
+ */
+inline bool
+IsNeighbor( const string_t *string, const int id )
+{
+  return ((string->neighbor_bits[id >> 6] >> (id & 63)) & 1) != 0;
+}
+
+
+/**
+ * @~english
+ * @brief Get the smallest neighbor string ID.
+ * @param[in] string String.
+ * @return Neighbor string ID, or NEIGHBOR_END.
+ * @~japanese
+ * @brief 最も小さい隣接する敵連のIDの取得
+ * @param[in] string 連
+ * @return 隣接する敵連のID (なければNEIGHBOR_END)
+ */
+inline int
+FirstNeighbor( const string_t *string )
+{
+  const int id = FindBit(string->neighbor_bits, NEIGHBOR_WORDS, 0);
+  return (id < 0) ? NEIGHBOR_END : id;
+}
+
+
+/**
+ * @~english
+ * @brief Get the next neighbor string ID.
+ * @param[in] string String.
+ * @param[in] id Current neighbor string ID.
+ * @return Next neighbor string ID, or NEIGHBOR_END.
+ * @~japanese
+ * @brief 次の隣接する敵連のIDの取得
+ * @param[in] string 連
+ * @param[in] id 現在の隣接する敵連のID
+ * @return 次の隣接する敵連のID (なければNEIGHBOR_END)
+ */
+inline int
+NextNeighbor( const string_t *string, const int id )
+{
+  const int next = FindBit(string->neighbor_bits, NEIGHBOR_WORDS, id + 1);
+  return (next < 0) ? NEIGHBOR_END : next;
+}
+
 #endif
@@ -0,0 +1,184 @@
+/**
+ * @file include/board/SuperKo.hpp
+ * @author Yuki Kobayashi
+ * @~english
+ * @brief Hash set of positions for positional super ko.
+ * @~japanese
+ * @brief 超劫判定のための局面のハッシュ集合
+ */
+#ifndef _SUPER_KO_HPP_
+#define _SUPER_KO_HPP_
+
+#include <cstring>
+
+#include "board/Constant.hpp"
+
+
+/**
+ * @~english
+ * @brief Calculate the smallest power of 2 which is larger than or equal to n.
+ * @param[in] n Lower bound.
+ * @param[in] size Candidate value.
+ * @return Power of 2.
+ * @~japanese
+ * @brief n以上の最小の2の冪の計算
+ * @param[in] n 下限値
+ * @param[in] size 候補の値
+ * @return 2の冪
+ */
+constexpr int
+SuperKoTableSize( const int n, const int size = 1 )
+{
+  return (size >= n) ? size : SuperKoTableSize(n, size * 2);
+}
+
+/**
+ * @~english
+ * @brief Size of the position hash table. It keeps the load factor under 0.5.
+ * @~japanese
+ * @brief 局面のハッシュ表の大きさ (使用率を0.5未満に保つ)
+ */
+constexpr int SUPERKO_TABLE_SIZE = SuperKoTableSize(2 * (MAX_RECORDS + 1));
+
+/**
+ * @~english
+ * @brief Mask for the index of the position hash table.
+ * @~japanese
+ * @brief 局面のハッシュ表のインデックスのマスク
+ */
+constexpr int SUPERKO_TABLE_MASK = SUPERKO_TABLE_SIZE - 1;
+
+
+/**
+ * @struct superko_table_t
+ * @~english
+ * @brief Hash set of positions which appeared in the game. Entries are removed in reverse order of insertion.
+ * @~japanese
+ * @brief 対局中に現れた局面のハッシュ集合. 要素は追加と逆順にだけ取り除く
+ */
+struct superko_table_t {
+  /**
+   * @~english
+   * @brief Positional hash values.
+   * @~japanese
+   * @brief 局面のハッシュ値
+   */
+  unsigned long long hash[SUPERKO_TABLE_SIZE];
+
+  /**
+   * @~english
+   * @brief Flags whether the slot is used.
+   * @~japanese
+   * @brief 使用中のスロットのフラグ
+   */
+  bool used[SUPERKO_TABLE_SIZE];
+
+  /**
+   * @~english
+   * @brief Slot indexes in order of insertion.
+   * @~japanese
+   * @brief 追加した順のスロットのインデックス
+   */
+  int slot[MAX_RECORDS + 1];
+
+  /**
+   * @~english
+   * @brief The number of stored positions.
+   * @~japanese
+   * @brief 記録した局面の個数
+   */
+  int num;
+};
+
+
+/**
+ * @~english
+ * @brief Clear the position hash set.
+ * @param[out] table Position hash set.
+ * @~japanese
+ * @brief 局面のハッシュ集合の初期化
+ * @param[out] table 局面のハッシュ集合
+ */
+inline void
+ClearSuperKoTable( superko_table_t *table )
+{
+  memset(table->used, 0, sizeof(table->used));
+  table->num = 0;
+}
+
+
+/**
+ * @~english
+ * @brief Add a position to the hash set.
+ * @param[in, out] table Position hash set.
+ * @param[in] hash Positional hash value.
+ * @~japanese
+ * @brief 局面のハッシュ集合への追加
+ * @param[in, out] table 局面のハッシュ集合
+ * @param[in] hash 局面のハッシュ値
+ */
+inline void
+AddSuperKoHash( superko_table_t *table, const unsigned long long hash )
+{
+  if (table->num > MAX_RECORDS) return;
+
+  int index = static_cast<int>(hash & SUPERKO_TABLE_MASK);
+
+  // 同じ局面でも別のスロットに入れて, 取り除く時に追加と1対1に対応させる
+  while (table->used[index]) {
+    index = (index + 1) & SUPERKO_TABLE_MASK;
+  }
+
+  table->hash[index] = hash;
+  table->used[index] = true;
+  table->slot[table->num++] = index;
+}
+
+
+/**
+ * @~english
+ * @brief Check whether the position is in the hash set.
+ * @param[in] table Position hash set.
+ * @param[in] hash Positional hash value.
+ * @return Position existence.
+ * @~japanese
+ * @brief 局面がハッシュ集合に含まれるかの判定
+ * @param[in] table 局面のハッシュ集合
+ * @param[in] hash 局面のハッシュ値
+ * @return 含まれていればtrue
+ */
+inline bool
+FindSuperKoHash( const superko_table_t *table, const unsigned long long hash )
+{
+  int index = static_cast<int>(hash & SUPERKO_TABLE_MASK);
+
+  while (table->used[index]) {
+    if (table->hash[index] == hash) return true;
+    index = (index + 1) & SUPERKO_TABLE_MASK;
+  }
+
+  return false;
+}
+
+
+/**
+ * @~english
+ * @brief Remove the positions added after the set had num positions.
+ * Removing in reverse order keeps linear probing sequences valid.
+ * @param[in, out] table Position hash set.
+ * @param[in] num The number of positions to keep.
+ * @~japanese
+ * @brief 局面がnum個だった時点以降に追加された局面を取り除く
+ * 追加と逆順に取り除くので, 線形探索の列は壊れない
+ * @param[in, out] table 局面のハッシュ集合
+ * @param[in] num 残す局面の個数
+ */
+inline void
+RewindSuperKoTable( superko_table_t *table, const int num )
+{
+  while (table->num > num) {
+    table->used[table->slot[--table->num]] = false;
+  }
+}
+
+#endif
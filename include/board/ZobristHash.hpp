@@ -9,7 +9,7 @@
 #ifndef _ZOBRISTHASH_HPP_
 #define _ZOBRISTHASH_HPP_
 
-#include <vector>
+#include <atomic>
 
 #include "board/GoBoard.hpp"
 
@@ -22,6 +22,14 @@
  */
 const unsigned int UCT_HASH_SIZE = 16384;
 
+/**
+ * @~english
+ * @brief Generation stamp of an entry which is being claimed by a thread.
+ * @~japanese
+ * @brief スレッドが確保中のエントリの世代番号
+ */
+const unsigned int HASH_CLAIMING = 0xffffffff;
+
 
 /**
  * @enum hash
@@ -64,11 +72,11 @@ enum hash {
 struct node_hash_t {
   /**
    * @~english
-   * @brief Hash value.
+   * @brief Hash value. It is stored after color and moves, so they are valid once the hash value matches.
    * @~japanese
-   * @brief 局面のハッシュ値
+   * @brief 局面のハッシュ値 (colorとmovesの後に書き込むので, 一致すればそれらも読める)
    */
-  unsigned long long hash;
+  std::atomic<unsigned long long> hash;
 
   /**
    * @~english
@@ -88,11 +96,14 @@ struct node_hash_t {
 
   /**
    * @~english
-   * @brief Use flag.
+   * @brief Generation stamp. An entry is used only when it matches the current generation,
+   * so all entries are cleared by advancing the generation.
+   * An entry is claimed by changing a stale stamp to HASH_CLAIMING.
    * @~japanese
-   * @brief 使用の有無のフラグ
+   * @brief 世代番号 (現在の世代と一致するエントリだけが使用中なので, 世代を進めれば全エントリが消える)
+   * 古い世代の番号をHASH_CLAIMINGに書き換えたスレッドがエントリを得る
    */
-  bool flag;
+  std::atomic<unsigned int> generation;
 };
 
 
@@ -124,19 +135,28 @@ void InitializeUctHash( void );
 //  UCTノードのハッシュ情報のクリア
 void ClearUctHash( void );
 
-//  古いデータの削除
-void DeleteOldHash( const game_info_t *game );
-
 //  未使用のインデックスを探す
 unsigned int SearchEmptyIndex( const unsigned long long hash, const int color, const int moves );
 
+//  確保したエントリを他のスレッドから引けるようにする
+void PublishHashIndex( const unsigned int index );
+
 //  ハッシュ値に対応するインデックスを返す
 unsigned int FindSameHashIndex( const unsigned long long hash, const int color, const int moves );
 
 //  ハッシュ表が埋まっていないか確認
 bool CheckRemainingHashSize( void );
 
-//  現局面から到達しないノードを削除
-void ClearNotDescendentNodes( std::vector<int> &indexes );
+//  エントリが現在の世代で使用中か確認
+bool IsUsedHashIndex( const unsigned int index );
+
+//  前の世代のエントリを現在の世代に残す
+bool RetainHashIndex( const unsigned int index );
+
+//  前の世代から残したエントリの数を確定する
+void FinishRetainingHash( void );
+
+//  使用中のエントリの数
+unsigned int GetUsedHashSize( void );
 
 #endif
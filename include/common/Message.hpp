@@ -55,6 +55,15 @@ void PrintPlayoutLimits( const double time_limit, const int playout_limit );
 //  再利用した探索回数の出力
 void PrintReuseCount( const int count );
 
+//  NUMAノードごとの探索速度の出力
+void PrintNodePlayoutSpeed( const int node, const int thread_num, const int po_speed );
+
+//  探索木を再利用した時のノード数と時間の出力
+void PrintTreeRetention( const int before, const int after, const double time );
+
+//  探索中に回収したノード数と時間の出力
+void PrintGarbageCollection( const int before, const int after, const double time );
+
 void PrintResignThresholdIsTooLarge( const double threshold );
 
 void PrintResignThresholdIsTooSmall( const double threshold );
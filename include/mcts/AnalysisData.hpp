@@ -97,7 +97,7 @@ public:
 
     int index = child.index;
 
-    while (pv.size() < pv_depth_limit && index != NOT_EXPANDED) {
+    while (pv.size() < pv_depth_limit && IsExpandedIndex(index)) {
       const uct_node_t &node = GetNode(index);
       const child_node_t *children = node.child;
       const int num_children = node.child_num;
@@ -252,9 +252,11 @@ public:
         }
       }
       std::sort(pv_data.begin(), pv_data.end(), std::greater<PrincipalVariationData>());
+      double root_ownership[PURE_BOARD_MAX];
+      CalculateOwnership(root, root_ownership);
       ownership = "";
       for (int i = 0; i < pure_board_max; i++) {
-        const double owner = static_cast<double>(root.ownership[onboard_pos[i]]) / root.move_count;
+        const double owner = (root.ownership_count > 0) ? root_ownership[i] / root.ownership_count : 0.5;
         const int owner_index = static_cast<int>(owner * 62);
         ownership += owner_char[owner_index];
       }
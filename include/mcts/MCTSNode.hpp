@@ -13,6 +13,7 @@
 #include "board/GoBoard.hpp"
 
 #include <atomic>
+#include <cstddef>
 #include <mutex>
 
 
@@ -32,6 +33,30 @@ constexpr int UCT_CHILD_MAX = PURE_BOARD_MAX + 1;
  */
 constexpr int NOT_EXPANDED = -1;
 
+/**
+ * @~english
+ * @brief Index for a node which is being expanded by another thread.
+ * @~japanese
+ * @brief 他のスレッドが展開中のノードのインデックス
+ */
+constexpr int NODE_EXPANDING = -2;
+
+/**
+ * @~english
+ * @brief The number of bit planes of bit-sliced ownership counters.
+ * @~japanese
+ * @brief Ownershipのビットスライスカウンタのビット平面の数
+ */
+constexpr int OWNERSHIP_PLANES = 8;
+
+/**
+ * @~english
+ * @brief The number of playouts kept in ownership counters before they are added to ownership.
+ * @~japanese
+ * @brief Ownershipに加算するまでにカウンタに溜めるプレイアウトの回数
+ */
+constexpr int OWNERSHIP_FLUSH_COUNT = (1 << OWNERSHIP_PLANES) - 1;
+
 /**
  * @~english
  * @brief Index for pass.
@@ -98,11 +123,13 @@ struct child_node_t {
 
   /**
    * @~english
-   * @brief Index to child node.
+   * @brief Index to child node. It changes from NOT_EXPANDED to NODE_EXPANDING,
+   * and then to the index of the node once the node is built.
    * @~japanese
    * @brief 子ノードのインデックス
+   * NOT_EXPANDEDからNODE_EXPANDINGに変わり, ノードを作り終えるとそのインデックスになる
    */
-  int index;
+  std::atomic<int> index;
 
   /**
    * @~english
@@ -118,7 +145,7 @@ struct child_node_t {
    * @~japanese
    * @brief Progressive Wideningで展開されたフラグ
    */
-  bool pw;
+  std::atomic<bool> pw;
 
   /**
    * @~english
@@ -126,7 +153,7 @@ struct child_node_t {
    * @~japanese
    * @brief 強制的に手を読むフラグ
    */
-  bool open;
+  std::atomic<bool> open;
 
   /**
    * @~english
@@ -192,7 +219,23 @@ struct uct_node_t {
    * @~japanese
    * @brief 探索する手の幅
    */
-  int width;
+  std::atomic<int> width;
+
+  /**
+   * @~english
+   * @brief Search count when search candidates were re-ranked last time.
+   * @~japanese
+   * @brief 最後に探索候補を並べ直した時の探索回数
+   */
+  std::atomic<int> rank_count;
+
+  /**
+   * @~english
+   * @brief Node construction completed flag. Threads which reach the node from another parent wait for it.
+   * @~japanese
+   * @brief ノードを作り終えたかのフラグ (別の親から辿り着いたスレッドはtrueになるまで待つ)
+   */
+  std::atomic<bool> expanded;
 
   /**
    * @~english
@@ -204,31 +247,90 @@ struct uct_node_t {
 
   /**
    * @~english
-   * @brief Children node information.
+   * @brief Children node information (child_num elements in the node arena).
+   * @~japanese
+   * @brief 子ノードの情報 (ノード用のメモリ領域にあるchild_num個の要素)
+   */
+  child_node_t *child;
+
+  /**
+   * @~english
+   * @brief Ownership of Monte-Carlo simulation indexed by onboard_index (in the node arena).
+   * @~japanese
+   * @brief Ownership (onboard_indexで指定, ノード用のメモリ領域に配置)
+   */
+  double *ownership;
+
+  /**
+   * @~english
+   * @brief Bit-sliced counters of territory which are not added to ownership yet (in the node arena).
+   * Counters for own territory and for neither territory have OWNERSHIP_PLANES bitboards each.
+   * @~japanese
+   * @brief Ownershipにまだ加算していない領域のビットスライスカウンタ (ノード用のメモリ領域に配置)
+   * 手番の色の領域とどちらの領域でもない点のカウンタがそれぞれOWNERSHIP_PLANES枚のビットボードを持つ
+   */
+  unsigned long long *ownership_bits;
+
+  /**
+   * @~english
+   * @brief The number of playouts kept in ownership_bits.
+   * @~japanese
+   * @brief ownership_bitsに溜めたプレイアウトの回数
+   */
+  int ownership_pending;
+
+  /**
+   * @~english
+   * @brief The number of playouts counted in ownership. Playouts cut off by the mercy rule are not counted.
+   * @~japanese
+   * @brief Ownershipに数えたプレイアウトの回数 (取った石の差で打ち切ったプレイアウトは数えない)
+   */
+  int ownership_count;
+
+  /**
+   * @~english
+   * @brief Size of the block in the node arena.
    * @~japanese
-   * @brief 子ノードの情報
+   * @brief ノード用のメモリ領域のブロックの大きさ
    */
-  child_node_t child[UCT_CHILD_MAX];
+  size_t block_size;
 
   /**
    * @~english
-   * @brief Seki point.
+   * @brief Generation of the node arena when the block was allocated.
    * @~japanese
-   * @brief セキの評価結果
+   * @brief ブロックを割り当てた時のノード用のメモリ領域の世代
    */
-  bool seki[BOARD_MAX];
+  unsigned int block_generation;
 
   /**
    * @~english
-   * @brief Ownership of Monte-Carlo simulation.
+   * @brief Bitset of seki points indexed by onboard_index.
    * @~japanese
-   * @brief Ownership
+   * @brief セキの評価結果のビット集合 (onboard_indexで指定)
    */
-  double ownership[BOARD_MAX];
+  unsigned long long seki[BITBOARD_WORDS];
 };
 
 
 
+/**
+ * @~english
+ * @brief Check whether a child node index refers to a built node.
+ * @param[in] index Index to child node.
+ * @return Built node flag.
+ * @~japanese
+ * @brief 子ノードのインデックスが作り終えたノードを指すかの確認
+ * @param[in] index 子ノードのインデックス
+ * @return 作り終えたノードならtrue
+ */
+inline bool
+IsExpandedIndex( const int index )
+{
+  return index >= 0;
+}
+
+
 void InitializeCandidate( child_node_t &child, int &child_num, const int pos, const bool ladder );
 
 void AddVirtualLoss( uct_node_t &node, child_node_t &child );
@@ -239,10 +341,26 @@ void ReuseRootCandidateWithoutLadderMove( uct_node_t &node, const bool ladder[]
 
 void InitializeNode( uct_node_t &node, const int pm1, const int pm2 );
 
+size_t CalculateNodeBlockSize( const int child_num );
+
+void *AllocateNodeBlock( const int child_num, size_t &size );
+
+void SetNodeBlock( uct_node_t &node, const int child_num, void *block, const size_t size );
+
+void ReleaseNodeBlock( uct_node_t &node );
+
+bool HasNodeBlock( const uct_node_t &node );
+
+void SetSekiBits( uct_node_t &node, const bool seki[] );
+
+void CopySekiFlags( const uct_node_t &node, bool seki[] );
+
 double CalculatePassWinningPercentage( const uct_node_t &node );
 
 double CalculateWinningRate( const child_node_t &child );
 
-void UpdateOwnership( uct_node_t &node, game_info_t *game, const int current_color );
+void UpdateOwnership( uct_node_t &node, const unsigned long long own_bits[], const unsigned long long neutral_bits[] );
+
+void CalculateOwnership( const uct_node_t &node, double ownership[] );
 
 #endif
@@ -0,0 +1,51 @@
+/**
+ * @file include/mcts/NodeArena.hpp
+ * @author Yuki Kobayashi
+ * @~english
+ * @brief Memory arena for variable size data of MCTS nodes.
+ * @~japanese
+ * @brief MCTSノードの可変長データ用のメモリ領域
+ */
+#ifndef _NODE_ARENA_HPP_
+#define _NODE_ARENA_HPP_
+
+#include <cstddef>
+
+
+/**
+ * @~english
+ * @brief Allocation unit of the arena (cache line size).
+ * @~japanese
+ * @brief メモリ領域の割り当て単位 (キャッシュラインの大きさ)
+ */
+constexpr size_t NODE_ARENA_LINE_SIZE = 64;
+
+
+//  メモリ領域の確保
+void InitializeNodeArena( const size_t size );
+
+//  メモリ領域を全NUMAノードに交互に配置
+void InterleaveNodeArena( void );
+
+//  全ブロックの解放
+void ClearNodeArena( void );
+
+//  ブロックの割り当て
+void *AllocateNodeArena( size_t &size );
+
+//  ブロックの解放
+void FreeNodeArena( void *block, const size_t size );
+
+//  メモリ領域が埋まっていないか確認
+bool CheckRemainingNodeArena( void );
+
+//  メモリ領域の大きさ
+size_t GetNodeArenaSize( void );
+
+//  使用中のメモリ量
+size_t GetNodeArenaUsedSize( void );
+
+//  メモリ領域の世代
+unsigned int GetNodeArenaGeneration( void );
+
+#endif
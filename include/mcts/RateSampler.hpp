@@ -0,0 +1,114 @@
+/**
+ * @file include/mcts/RateSampler.hpp
+ * @author Yuki Kobayashi
+ * @~english
+ * @brief Weighted move sampler for Monte-Carlo simulation.
+ * @~japanese
+ * @brief モンテカルロ・シミュレーションのレートに比例した着手の選択
+ */
+#ifndef _RATE_SAMPLER_HPP_
+#define _RATE_SAMPLER_HPP_
+
+#include "board/GoBoard.hpp"
+
+
+/**
+ * @~english
+ * @brief Add a rate value to the sums of the rate tree.
+ * The tree has 3 levels with 8 children for each node: coordinates,
+ * groups of 8 coordinates, and blocks of 8 groups.
+ * @param[in, out] sum_rate Total rate value.
+ * @param[in, out] sum_rate_tree Sums of rate values in the rate tree.
+ * @param[in] pos Coordinate.
+ * @param[in] delta Rate value to add.
+ * @~japanese
+ * @brief レートの木の合計値へのレートの加算
+ * 木は各節が8個の子を持つ3段の構造 (座標, 8座標ごとのグループ, 8グループごとのブロック)
+ * @param[in, out] sum_rate レートの合計値
+ * @param[in, out] sum_rate_tree レートの木の合計値
+ * @param[in] pos 座標
+ * @param[in] delta 加算するレート
+ */
+inline void
+AddRateToTree( long long *sum_rate, long long sum_rate_tree[], const int pos, const long long delta )
+{
+  *sum_rate += delta;
+  sum_rate_tree[pos >> RATE_FANOUT_SHIFT] += delta;
+  sum_rate_tree[RATE_GROUP_MAX + (pos >> (2 * RATE_FANOUT_SHIFT))] += delta;
+}
+
+
+/**
+ * @~english
+ * @brief Update rate value of a coordinate.
+ * @param[in, out] sum_rate Total rate value.
+ * @param[in, out] sum_rate_tree Sums of rate values in the rate tree.
+ * @param[in, out] rate Rate value for each coordinates.
+ * @param[in] pos Coordinate.
+ * @param[in] value New rate value.
+ * @~japanese
+ * @brief 座標のレートの更新
+ * @param[in, out] sum_rate レートの合計値
+ * @param[in, out] sum_rate_tree レートの木の合計値
+ * @param[in, out] rate 各座標のレート
+ * @param[in] pos 座標
+ * @param[in] value 新しいレート
+ */
+inline void
+UpdateRate( long long *sum_rate, long long sum_rate_tree[], long long rate[], const int pos, const long long value )
+{
+  const long long delta = value - rate[pos];
+
+  rate[pos] = value;
+  AddRateToTree(sum_rate, sum_rate_tree, pos, delta);
+}
+
+
+/**
+ * @~english
+ * @brief Find the first coordinate whose cumulative rate reaches rand_num.
+ * Updates are far more frequent than sampling in a simulation, so the tree is kept shallow
+ * and an update touches only 3 sums. A draw scans the RATE_BLOCK_MAX block sums linearly,
+ * and then at most 8 contiguous sums on each of the two lower levels.
+ * Coordinates are visited in the same order as rows and columns of the board.
+ * @param[in] sum_rate_tree Sums of rate values in the rate tree.
+ * @param[in] rate Rate value for each coordinates.
+ * @param[in] rand_num Random number (1 to total rate value).
+ * @return Selected coordinate.
+ * @~japanese
+ * @brief 累積のレートがrand_numに達する最初の座標の探索
+ * シミュレーションでは選択よりもレートの更新の方がはるかに多いので, 木を浅くして更新は3つの合計値だけで済ませる
+ * 選択はRATE_BLOCK_MAX個のブロックの合計値を順に見た後, 下の2段で高々8個ずつの連続した合計値を見る
+ * 座標は盤の行と列の順に辿る
+ * @param[in] sum_rate_tree レートの木の合計値
+ * @param[in] rate 各座標のレート
+ * @param[in] rand_num 乱数 (1以上レートの合計値以下)
+ * @return 選ばれた座標
+ */
+inline int
+SampleRate( const long long sum_rate_tree[], const long long rate[], long long rand_num )
+{
+  const long long *sum_rate_block = &sum_rate_tree[RATE_GROUP_MAX];
+  int block = 0;
+
+  // ブロックを求める
+  while (rand_num > sum_rate_block[block]) {
+    rand_num -= sum_rate_block[block++];
+  }
+
+  // ブロックの中のグループを求める
+  int group = block << RATE_FANOUT_SHIFT;
+  while (rand_num > sum_rate_tree[group]) {
+    rand_num -= sum_rate_tree[group++];
+  }
+
+  // グループの中の座標を求める
+  int pos = group << RATE_FANOUT_SHIFT;
+  while (rand_num > rate[pos]) {
+    rand_num -= rate[pos++];
+  }
+
+  return pos;
+}
+
+#endif
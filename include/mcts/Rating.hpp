@@ -58,10 +58,10 @@ void InitializeRating( void );
 int RatingMove( game_info_t *game, int color, std::mt19937_64 &mt );
 
 //  レーティング 
-void Rating( game_info_t *game, int color, long long *sum_rate, long long *sum_rate_row, long long *rate );
+void Rating( game_info_t *game, int color, long long *sum_rate, long long *sum_rate_tree, long long *rate );
 
 //  レーティング 
-void PartialRating( game_info_t *game, int color, long long *sum_rate, long long *sum_rate_row, long long *rate );
+void PartialRating( game_info_t *game, int color, long long *sum_rate, long long *sum_rate_tree, long long *rate );
 
 //  現局面の評価値
 void AnalyzePoRating( game_info_t *game, int color, double rate[] );
@@ -14,7 +14,13 @@
 #include "board/GoBoard.hpp"
 
 
+// シミュレーションを打ち切るアゲハマの差の設定
+void SetMercyThreshold( const int threshold );
+
+// 探索開始局面のレートの計算
+void SetSimulationRoot( const game_info_t *game );
+
 // 対局のシミュレーション(知識あり)
-void Simulation( game_info_t *game, int color, std::mt19937_64 &mt );
+int Simulation( game_info_t *game, int color, std::mt19937_64 &mt, bool &mercy );
 
 #endif
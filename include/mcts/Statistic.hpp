@@ -11,6 +11,9 @@
 
 #include <atomic>
 
+#include "board/Color.hpp"
+#include "board/Constant.hpp"
+
 
 /**
  * @enum StatisticInformation
@@ -96,6 +99,74 @@ struct statistic_t {
     }
     return *this;
   }
+
+  /**
+   * @~english
+   * @brief Increment a counter. Only the owner thread of the statistic information can call it,
+   * so a plain load and store is enough instead of an atomic read-modify-write.
+   * @param[in] index Counter index.
+   * @~japanese
+   * @brief カウンタの加算
+   * 統計情報を持つスレッドしか呼び出さないので, 不可分な加算ではなく読み出しと書き込みで足りる
+   * @param[in] index カウンタのインデックス
+   */
+  void
+  increment( const int index )
+  {
+    colors[index].store(colors[index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+};
+
+
+/**
+ * @struct statistic_shard_t
+ * @~english
+ * @brief Statistic information collected by one search thread.
+ * @~japanese
+ * @brief 1つの探索スレッドが収集する統計情報
+ */
+struct alignas(64) statistic_shard_t {
+  /**
+   * @~english
+   * @brief Statistic information of each coordinate.
+   * @~japanese
+   * @brief 各座標の統計情報
+   */
+  statistic_t point[BOARD_MAX];
+
+  /**
+   * @~english
+   * @brief The number of collected simulations.
+   * @~japanese
+   * @brief 統計情報を収集した回数
+   */
+  std::atomic<int> count;
+
+  /**
+   * @~english
+   * @brief The number of collected simulations won by each color.
+   * @~japanese
+   * @brief 統計情報を収集したシミュレーションで各色が勝った回数
+   */
+  std::atomic<int> win[S_OB];
+
+  /**
+   * @~english
+   * @brief Clear statistic information.
+   * @~japanese
+   * @brief 統計情報のクリア
+   */
+  void
+  clear( void )
+  {
+    for (int i = 0; i < BOARD_MAX; i++) {
+      point[i].clear();
+    }
+    count = 0;
+    for (int i = 0; i < S_OB; i++) {
+      win[i] = 0;
+    }
+  }
 };
 
 #endif
@@ -32,6 +32,14 @@ constexpr int BTFM_DIMENSION = 5;
  */
 constexpr int LARGE_PAT_MAX = 1000000;
 
+/**
+ * @~english
+ * @brief Maximum number of active features of a move.
+ * @~japanese
+ * @brief 1つの着手で有効な特徴の個数の最大値
+ */
+constexpr int UCT_FEATURE_SLOT_MAX = 16;
+
 // Ownerは
 // 0-5% 6-15% 16-25% 26-35% 36-45% 46-55%
 // 56-65% 66-75% 76-85% 86-95% 96-100%
@@ -130,6 +138,9 @@ void InitializeUctRating( void );
 //  戦術的特徴のレートの計算
 double CalculateMoveScoreWithBTFM( const game_info_t *game, const int pos, const unsigned int *tactical_features, const int distance_index );
 
+//  複数の着手のレートの一括計算
+void CalculateMoveScoresWithBTFM( const game_info_t *game, const int num, const int pos[], const unsigned int *tactical_features, const int distance_index, double score[] );
+
 //  現局面の評価
 void AnalyzeUctRating( game_info_t *game, int color, double rate[] );
 
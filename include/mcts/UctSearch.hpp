@@ -107,6 +107,14 @@ struct thread_arg_t {
    * @brief lz-analyzeコマンドの表示間隔
    */
   int lz_analysis_cs;
+
+  /**
+   * @~english
+   * @brief Search time can be extended or not.
+   * @~japanese
+   * @brief 探索時間を延長できるかどうか
+   */
+  bool time_extension;
 };
 
 
@@ -136,6 +144,109 @@ struct rate_order_t {
 };
 
 
+/**
+ * @~english
+ * @brief The number of playouts whose ownership updates are kept before they are added to nodes.
+ * @~japanese
+ * @brief ノードのOwnershipに加算するまでに溜めるプレイアウトの回数
+ */
+constexpr int OWNERSHIP_BATCH_PLAYOUTS = 16;
+
+/**
+ * @~english
+ * @brief Maximum number of ownership updates kept before they are added to nodes.
+ * @~japanese
+ * @brief ノードのOwnershipに加算するまでに溜める更新の最大数
+ */
+constexpr int OWNERSHIP_BATCH_ENTRIES = 1024;
+
+
+/**
+ * @struct ownership_update_t
+ * @~english
+ * @brief Ownership update of a node kept in a batch.
+ * @~japanese
+ * @brief まとめて加算するノードのOwnershipの更新
+ */
+struct ownership_update_t {
+  /**
+   * @~english
+   * @brief UCT node index.
+   * @~japanese
+   * @brief ノードのインデックス
+   */
+  int node;
+
+  /**
+   * @~english
+   * @brief Index of the playout in the batch.
+   * @~japanese
+   * @brief まとめたプレイアウトのインデックス
+   */
+  short playout;
+
+  /**
+   * @~english
+   * @brief Color whose territory is counted.
+   * @~japanese
+   * @brief 領域を数える色
+   */
+  short color;
+};
+
+
+/**
+ * @struct ownership_batch_t
+ * @~english
+ * @brief Ownership updates of a search thread which are not added to nodes yet.
+ * Updates are grouped by node when they are added, so that each node is locked once per batch.
+ * @~japanese
+ * @brief 探索スレッドのまだノードに加算していないOwnershipの更新
+ * 加算する時にノードごとにまとめて, 1回の加算でノードのロックを1度だけ取る
+ */
+struct ownership_batch_t {
+  /**
+   * @~english
+   * @brief Bitboards of each player's territory and of neither territory at the end of each playout.
+   * @~japanese
+   * @brief 各プレイアウトの終局時の各色の領域とどちらの領域でもない点のビットボード
+   */
+  unsigned long long area[OWNERSHIP_BATCH_PLAYOUTS][S_OB][BITBOARD_WORDS];
+
+  /**
+   * @~english
+   * @brief The number of playouts in the batch.
+   * @~japanese
+   * @brief まとめたプレイアウトの回数
+   */
+  int playout_num;
+
+  /**
+   * @~english
+   * @brief Whether the territory of the last playout is counted (false if it finished by the mercy rule).
+   * @~japanese
+   * @brief 直前のプレイアウトの領域を数えるか (取った石の差で打ち切った時はfalse)
+   */
+  bool counted;
+
+  /**
+   * @~english
+   * @brief Ownership updates of nodes.
+   * @~japanese
+   * @brief ノードのOwnershipの更新
+   */
+  ownership_update_t update[OWNERSHIP_BATCH_ENTRIES];
+
+  /**
+   * @~english
+   * @brief The number of ownership updates.
+   * @~japanese
+   * @brief Ownershipの更新の数
+   */
+  int update_num;
+};
+
+
 // UCTのノード
 extern uct_node_t *uct_node;
 
@@ -155,6 +266,9 @@ void SetPonderingMode( const bool flag );
 // 使用するスレッド数の指定
 void SetThread( const int new_threads );
 
+// NUMAモードの設定
+void SetNumaMode( bool flag );
+
 // パラメータの設定
 void SetParameter( void );
 
@@ -187,6 +301,9 @@ int UctSearchGenmoveCleanUp( game_info_t *game, int color );
 // 探索の再利用の設定
 void SetReuseSubtree( bool flag );
 
+// 局面の合流の設定
+void SetTranspositionMode( bool flag );
+
 // 指定したインデックスのノードを取得
 uct_node_t& GetNode( const int index );
 
@@ -51,9 +51,9 @@ constexpr double UCB_COEFFICIENT = 0.60;
 double CalculateUCB1Value( const child_node_t &child, const int total_visits );
 
 // UCB1-Tuned値の計算
-double CalculateUCB1TunedValue( const child_node_t &child, const int total_visits );
+double CalculateUCB1TunedValue( const child_node_t &child, const double win, const int total_visits );
 
 // UCB1値が最大の手を取得
-int SelectBestChildIndexByUCB1( const uct_node_t &node, std::mt19937_64 &mt );
+int SelectBestChildIndexByUCB1( const uct_node_t &node, std::mt19937_64 &mt, const uct_node_t *nodes = nullptr );
 
 #endif
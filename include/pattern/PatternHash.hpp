@@ -9,6 +9,10 @@
 #ifndef _PATTERNHASH_HPP_
 #define _PATTERNHASH_HPP_
 
+#if defined (_WIN32)
+#include <xmmintrin.h>
+#endif
+
 #include "board/GoBoard.hpp"
 #include "pattern/Pattern.hpp"
 
@@ -29,6 +33,22 @@ constexpr int HASH_MAX = 1048576; // 2^20
  */
 constexpr int BIT_MAX = 60;
 
+/**
+ * @~english
+ * @brief The number of entries in a bucket of pattern index.
+ * @~japanese
+ * @brief パターンのインデックスのバケットに入る要素数
+ */
+constexpr int PATTERN_BUCKET_SIZE = 5;
+
+/**
+ * @~english
+ * @brief Maximum number of buckets of pattern index (2^18).
+ * @~japanese
+ * @brief パターンのインデックスのバケット数の上限 (2^18)
+ */
+constexpr int PATTERN_BUCKET_MAX = 262144;
+
 
 /**
  * @~english
@@ -71,6 +91,64 @@ struct index_hash_t {
 };
 
 
+/**
+ * @~english
+ * @brief Bucket of pattern index. A bucket fits in a cache line.
+ * @~japanese
+ * @brief パターンのインデックスのバケット (1つのキャッシュラインに収まる)
+ */
+struct alignas(64) pattern_bucket_t {
+  /**
+   * @~english
+   * @brief Hash values.
+   * @~japanese
+   * @brief ハッシュ値
+   */
+  unsigned long long hash[PATTERN_BUCKET_SIZE];
+
+  /**
+   * @~english
+   * @brief Indexes of parameters.
+   * @~japanese
+   * @brief パラメータのインデックス
+   */
+  int index[PATTERN_BUCKET_SIZE];
+
+  /**
+   * @~english
+   * @brief The number of used entries.
+   * @~japanese
+   * @brief 使用中の要素数
+   */
+  int num;
+};
+
+
+/**
+ * @~english
+ * @brief Read-only pattern index. Entries overflowing from a full bucket go to the next bucket.
+ * @~japanese
+ * @brief 読み込み専用のパターンのインデックス. 満杯のバケットから溢れた要素は次のバケットに入れる
+ */
+struct pattern_index_t {
+  /**
+   * @~english
+   * @brief Buckets.
+   * @~japanese
+   * @brief バケット
+   */
+  pattern_bucket_t bucket[PATTERN_BUCKET_MAX];
+
+  /**
+   * @~english
+   * @brief Bit mask for bucket index.
+   * @~japanese
+   * @brief バケットのインデックスのマスク
+   */
+  unsigned int mask;
+};
+
+
 /**
  * @~english
  * @brief Return 24-bit compressed zobrist hash value.
@@ -105,10 +183,65 @@ TransHash20( const unsigned long long hash )
 }
 
 
+/**
+ * @~english
+ * @brief Prefetch the bucket which may have the hash value.
+ * @param[in] table Pattern index.
+ * @param[in] hash Hash value.
+ * @~japanese
+ * @brief ハッシュ値が入っている可能性のあるバケットの先読み
+ * @param[in] table パターンのインデックス
+ * @param[in] hash ハッシュ値
+ */
+inline void
+PrefetchPatternIndex( const pattern_index_t *table, const unsigned long long hash )
+{
+  const pattern_bucket_t *bucket = &table->bucket[TransHash20(hash) & table->mask];
+
+#if defined (_WIN32)
+  _mm_prefetch(reinterpret_cast<const char *>(bucket), _MM_HINT_T0);
+#else
+  __builtin_prefetch(bucket);
+#endif
+}
+
+
+/**
+ * @~english
+ * @brief Return the index with the same hash value.
+ * @param[in] table Pattern index.
+ * @param[in] hash Hash value.
+ * @return Index with hash hit, or -1 if not found.
+ * @~japanese
+ * @brief 同じハッシュ値を持つインデックスの取得
+ * @param[in] table パターンのインデックス
+ * @param[in] hash ハッシュ値
+ * @return ハッシュヒットしたインデックス (見つからなければ-1)
+ */
+inline int
+FindPatternIndex( const pattern_index_t *table, const unsigned long long hash )
+{
+  unsigned int key = TransHash20(hash) & table->mask;
+
+  while (true) {
+    const pattern_bucket_t &bucket = table->bucket[key];
+    for (int i = 0; i < bucket.num; i++) {
+      if (bucket.hash[i] == hash) return bucket.index[i];
+    }
+    // 満杯でなければ次のバケットに溢れた要素は無い
+    if (bucket.num < PATTERN_BUCKET_SIZE) return -1;
+    key = (key + 1) & table->mask;
+  }
+}
+
+
 //  パターンのハッシュ関数
 void PatternHash( const pattern_t *pat, pattern_hash_t *hash_pat );
 
 //  インデックスを探索
 int SearchIndex( const index_hash_t *index, const unsigned long long hash );
 
+//  インデックスのハッシュテーブルからパターンのインデックスを作成
+void BuildPatternIndex( pattern_index_t *table, const index_hash_t index[] );
+
 #endif
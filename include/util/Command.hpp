@@ -41,6 +41,12 @@
  * Specifying winning ratio of resignation.
  * @var COMMAND_CGOS_MODE
  * Activating all capturing dead stones mode.
+ * @var COMMAND_TRANSPOSITION
+ * Activating transposition of positions in MCTS.
+ * @var COMMAND_NUMA
+ * Activating thread pinning and NUMA-aware tree placement.
+ * @var COMMAND_MERCY
+ * Specifying difference of captured stones to finish a simulation.
  * @var COMMAND_MAX
  * Sentinel.
  * @~japanese
@@ -73,6 +79,12 @@
  * 投了する勝率の閾値の指定
  * @var COMMAND_CGOS_MODE
  * 全ての石を打ち上げるモードの有効化
+ * @var COMMAND_TRANSPOSITION
+ * 探索木での局面の合流の有効化
+ * @var COMMAND_NUMA
+ * 探索スレッドの固定とNUMAを考慮した探索木の配置の有効化
+ * @var COMMAND_MERCY
+ * シミュレーションを打ち切るアゲハマの差の指定
  * @var COMMAND_MAX
  * 番兵
  */
@@ -91,6 +103,9 @@ enum COMMAND {
   COMMAND_SUPERKO,
   COMMAND_RESIGN_THRESHOLD,
   COMMAND_CGOS_MODE,
+  COMMAND_TRANSPOSITION,
+  COMMAND_NUMA,
+  COMMAND_MERCY,
   COMMAND_MAX,
 };
 
@@ -0,0 +1,30 @@
+/**
+ * @file include/util/Numa.hpp
+ * @author Yuki Kobayashi
+ * @~english
+ * @brief Thread pinning and memory placement for NUMA systems.
+ * @~japanese
+ * @brief NUMA環境でのスレッドの固定とメモリの配置
+ */
+#ifndef _NUMA_HPP_
+#define _NUMA_HPP_
+
+#include <cstddef>
+
+
+//  NUMAノードとCPUの対応の読み込み
+void InitializeNumaTopology( void );
+
+//  NUMAノードの個数
+int GetNumaNodeNum( void );
+
+//  探索スレッドを割り当てるNUMAノード
+int GetThreadNumaNode( const int thread_id );
+
+//  呼び出したスレッドをCPUに固定
+bool PinCurrentThread( const int thread_id );
+
+//  メモリ領域を全NUMAノードに交互に配置
+void InterleaveMemory( void *address, const size_t size );
+
+#endif
@@ -0,0 +1,227 @@
+/**
+ * @file src/board/BitBoard.cpp
+ * @author Yuki Kobayashi
+ * @~english
+ * @brief Bitboard operations.
+ * @~japanese
+ * @brief ビットボードの操作
+ */
+#include <algorithm>
+
+#include "board/BitBoard.hpp"
+#include "board/GoBoard.hpp"
+
+
+/**
+ * @~english
+ * @brief Bitboard of all intersections on a board.
+ * @~japanese
+ * @brief 盤上の全ての交点のビットボード
+ */
+unsigned long long board_bits[BITBOARD_WORDS];
+
+/**
+ * @~english
+ * @brief The number of words used for current board size.
+ * @~japanese
+ * @brief 現在の盤の大きさで使うワード数
+ */
+int bitboard_words = BITBOARD_WORDS;
+
+/**
+ * @~english
+ * @brief Bitboard of the top row.
+ * @~japanese
+ * @brief 盤の上端の行のビットボード
+ */
+static unsigned long long top_edge_bits[BITBOARD_WORDS];
+
+/**
+ * @~english
+ * @brief Bitboard of the bottom row.
+ * @~japanese
+ * @brief 盤の下端の行のビットボード
+ */
+static unsigned long long bottom_edge_bits[BITBOARD_WORDS];
+
+/**
+ * @~english
+ * @brief Bitboard of the left column.
+ * @~japanese
+ * @brief 盤の左端の列のビットボード
+ */
+static unsigned long long left_edge_bits[BITBOARD_WORDS];
+
+/**
+ * @~english
+ * @brief Bitboard of the right column.
+ * @~japanese
+ * @brief 盤の右端の列のビットボード
+ */
+static unsigned long long right_edge_bits[BITBOARD_WORDS];
+
+
+// ビットボードの上位方向へのシフト
+static void ShiftUpperBits( const unsigned long long src[], unsigned long long dst[], const int shift );
+
+// ビットボードの下位方向へのシフト
+static void ShiftLowerBits( const unsigned long long src[], unsigned long long dst[], const int shift );
+
+// 4近傍が全て同じ色の石か盤外である空点の計算
+static void SurroundedBits( const unsigned long long stones[], const unsigned long long empty[], unsigned long long area[] );
+
+
+/**
+ * @~english
+ * @brief Set a bit of the bitboard.
+ * @param[in, out] bits Bitboard.
+ * @param[in] index Bit index.
+ * @~japanese
+ * @brief ビットボードのビットを立てる
+ * @param[in, out] bits ビットボード
+ * @param[in] index ビットの位置
+ */
+static inline void
+SetBit( unsigned long long bits[], const int index )
+{
+  bits[index >> 6] |= 1ULL << (index & 63);
+}
+
+
+/**
+ * @~english
+ * @brief Initialize bitboard masks for current board size.
+ * @~japanese
+ * @brief 現在の盤の大きさに合わせたビットボードのマスクの初期化
+ */
+void
+InitializeBitBoard( void )
+{
+  bitboard_words = (pure_board_max + 63) / 64;
+
+  std::fill_n(board_bits, BITBOARD_WORDS, 0ULL);
+  std::fill_n(top_edge_bits, BITBOARD_WORDS, 0ULL);
+  std::fill_n(bottom_edge_bits, BITBOARD_WORDS, 0ULL);
+  std::fill_n(left_edge_bits, BITBOARD_WORDS, 0ULL);
+  std::fill_n(right_edge_bits, BITBOARD_WORDS, 0ULL);
+
+  for (int y = 0; y < pure_board_size; y++) {
+    for (int x = 0; x < pure_board_size; x++) {
+      const int index = y * pure_board_size + x;
+      SetBit(board_bits, index);
+      if (y == 0) SetBit(top_edge_bits, index);
+      if (y == pure_board_size - 1) SetBit(bottom_edge_bits, index);
+      if (x == 0) SetBit(left_edge_bits, index);
+      if (x == pure_board_size - 1) SetBit(right_edge_bits, index);
+    }
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Shift bitboard toward upper bits.
+ * @param[in] src Source bitboard.
+ * @param[out] dst Shifted bitboard.
+ * @param[in] shift Shift width (1 to 63).
+ * @~japanese
+ * @brief ビットボードを上位ビット方向へシフト
+ * @param[in] src シフト元のビットボード
+ * @param[out] dst シフトしたビットボード
+ * @param[in] shift シフト幅 (1以上63以下)
+ */
+static void
+ShiftUpperBits( const unsigned long long src[], unsigned long long dst[], const int shift )
+{
+  dst[0] = src[0] << shift;
+  for (int i = 1; i < bitboard_words; i++) {
+    dst[i] = (src[i] << shift) | (src[i - 1] >> (64 - shift));
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Shift bitboard toward lower bits.
+ * @param[in] src Source bitboard.
+ * @param[out] dst Shifted bitboard.
+ * @param[in] shift Shift width (1 to 63).
+ * @~japanese
+ * @brief ビットボードを下位ビット方向へシフト
+ * @param[in] src シフト元のビットボード
+ * @param[out] dst シフトしたビットボード
+ * @param[in] shift シフト幅 (1以上63以下)
+ */
+static void
+ShiftLowerBits( const unsigned long long src[], unsigned long long dst[], const int shift )
+{
+  const int last = bitboard_words - 1;
+
+  for (int i = 0; i < last; i++) {
+    dst[i] = (src[i] >> shift) | (src[i + 1] << (64 - shift));
+  }
+  dst[last] = src[last] >> shift;
+}
+
+
+/**
+ * @~english
+ * @brief Calculate empty intersections whose 4 neighbors are all given stones or out of board.
+ * @param[in] stones Bitboard of stones.
+ * @param[in] empty Bitboard of empty intersections.
+ * @param[out] area Bitboard of stones and surrounded empty intersections.
+ * @~japanese
+ * @brief 4近傍が全て指定した石か盤外である空点の計算
+ * @param[in] stones 石のビットボード
+ * @param[in] empty 空点のビットボード
+ * @param[out] area 石と囲まれた空点のビットボード
+ */
+static void
+SurroundedBits( const unsigned long long stones[], const unsigned long long empty[], unsigned long long area[] )
+{
+  unsigned long long up[BITBOARD_WORDS], down[BITBOARD_WORDS], left[BITBOARD_WORDS], right[BITBOARD_WORDS];
+
+  // 各点から見て上下左右の点の石を重ねる
+  ShiftUpperBits(stones, up, pure_board_size);
+  ShiftLowerBits(stones, down, pure_board_size);
+  ShiftUpperBits(stones, left, 1);
+  ShiftLowerBits(stones, right, 1);
+
+  // 盤端の方向は盤外として扱うので, 行をまたいだビットはマスクで上書きされる
+  for (int i = 0; i < bitboard_words; i++) {
+    area[i] = stones[i] |
+      (empty[i] &
+       (up[i] | top_edge_bits[i]) &
+       (down[i] | bottom_edge_bits[i]) &
+       (left[i] | left_edge_bits[i]) &
+       (right[i] | right_edge_bits[i]));
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Calculate area of each color (stones and empty intersections surrounded by the same color).
+ * @param[in] game Board position data.
+ * @param[out] black_area Bitboard of black area.
+ * @param[out] white_area Bitboard of white area.
+ * @~japanese
+ * @brief 各色の領域 (石と4近傍が同色の空点) の計算
+ * @param[in] game 局面情報
+ * @param[out] black_area 黒の領域のビットボード
+ * @param[out] white_area 白の領域のビットボード
+ */
+void
+CalculateAreaBits( const game_info_t *game, unsigned long long black_area[], unsigned long long white_area[] )
+{
+  const unsigned long long *black = game->stone_bits[S_BLACK];
+  const unsigned long long *white = game->stone_bits[S_WHITE];
+  unsigned long long empty[BITBOARD_WORDS];
+
+  for (int i = 0; i < bitboard_words; i++) {
+    empty[i] = board_bits[i] & ~(black[i] | white[i]);
+  }
+
+  SurroundedBits(black, empty, black_area);
+  SurroundedBits(white, empty, white_area);
+}
@@ -6,16 +6,19 @@
  * @~japanese
  * @brief 盤面の処理
  */
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 
+#include "board/BitBoard.hpp"
 #include "board/GoBoard.hpp"
 #include "board/String.hpp"
 #include "board/ZobristHash.hpp"
 #include "feature/Semeai.hpp"
 #include "feature/SimulationFeature.hpp"
+#include "mcts/RateSampler.hpp"
 #include "mcts/UctRating.hpp"
 
 
@@ -195,6 +198,14 @@ int move_dis[PURE_BOARD_SIZE][PURE_BOARD_SIZE];
  */
 int onboard_pos[PURE_BOARD_MAX];
 
+/**
+ * @~english
+ * @brief Indices of intersections, which is inverse of onboard_pos.
+ * @~japanese
+ * @brief 盤上の位置の通し番号 (onboard_posの逆引き)
+ */
+int onboard_index[BOARD_MAX];
+
 /**
  * @~english
  * @brief Candidates for first move.
@@ -248,6 +259,9 @@ static void InitializeTerritory( void );
 //  盤端での処理
 static bool IsFalseEyeConnection( const game_info_t *game, const int pos, const int color );
 
+//  変更履歴の消去
+static void ClearJournal( game_info_t *game );
+
 
 /**
  * @~english
@@ -264,6 +278,21 @@ SetSuperKo( const bool flag )
 }
 
 
+/**
+ * @~english
+ * @brief Get super ko setting.
+ * @return Super ko activation flag.
+ * @~japanese
+ * @brief 超劫の設定の取得
+ * @return 超劫の有効フラグ
+ */
+bool
+GetSuperKo( void )
+{
+  return check_superko;
+}
+
+
 /**
  * @~english
  * @brief Set board size.
@@ -288,12 +317,15 @@ SetBoardSize( const int size )
   i = 0;
   for (int y = board_start; y <= board_end; y++) {
     for (int x = board_start; x <= board_end; x++) {
+      onboard_index[POS(x, y)] = i;
       onboard_pos[i++] = POS(x, y);
       board_x[POS(x, y)] = x;
       board_y[POS(x, y)] = y;
     }
   }
 
+  InitializeBitBoard();
+
   for (int y = board_start; y <= board_end; y++) {
     for (int x = board_start; x <= (board_start + pure_board_size / 2); x++) {
       border_dis_x[POS(x, y)] = x - (OB_SIZE - 1);
@@ -438,9 +470,11 @@ InitializeBoard( game_info_t *game )
   memset(game->pat,    0, sizeof(pattern_t) * board_max);
 
   std::fill_n(game->board, board_max, 0);
+  std::fill(game->stone_bits[0], game->stone_bits[S_MAX], 0ULL);
   std::fill_n(game->update_num, 2, 0);
   std::fill_n(game->capture_num, 2, 0);
   std::fill_n(game->capture_dir, 2, 0);
+  std::fill_n(game->dirty_num, 2, 0);
   std::fill(game->update_pos[0], game->update_pos[2], 0);
   std::fill(game->capture_pos[0], game->capture_pos[2], 0);
   std::fill_n(game->tactical_features, board_max * ALL_MAX, 0);
@@ -453,6 +487,10 @@ InitializeBoard( game_info_t *game )
   game->positional_hash = 0;
   game->move_hash = 0;
 
+  // 初期局面も超劫の対象とする
+  ClearSuperKoTable(&game->superko_table);
+  AddSuperKoHash(&game->superko_table, game->positional_hash);
+
   SetKomi(default_komi);
 
   game->moves = 1;
@@ -461,12 +499,12 @@ InitializeBoard( game_info_t *game )
 
   std::fill_n(game->candidates, BOARD_MAX, false);
 
-  for (int y = 0; y < board_size; y++){
+  for (int y = 0; y < BOARD_STRIDE; y++){
     for (int x = 0; x < OB_SIZE; x++) {
       game->board[POS(x, y)] = S_OB;
       game->board[POS(y, x)] = S_OB;
-      game->board[POS(y, board_size - 1 - x)] = S_OB;
-      game->board[POS(board_size - 1 - x, y)] = S_OB;
+      game->board[POS(y, BOARD_STRIDE - 1 - x)] = S_OB;
+      game->board[POS(BOARD_STRIDE - 1 - x, y)] = S_OB;
     }
   }
 
@@ -482,6 +520,14 @@ InitializeBoard( game_info_t *game )
 
   ClearPattern(game->pat);
 
+  // 初期局面では全ての交点が候補手
+  for (int i = 0; i < 2; i++) {
+    std::copy_n(board_bits, BITBOARD_WORDS, game->legal_bits[i]);
+    std::copy_n(board_bits, BITBOARD_WORDS, game->meaningful_bits[i]);
+  }
+
+  ClearJournal(game);
+
   InitializeNeighbor();
   InitializeEye();
 }
@@ -511,6 +557,7 @@ CopyGame( game_info_t *dst, const game_info_t *src )
   memcpy(dst->capture_dir,        src->capture_dir,        sizeof(int) * 2);
   memcpy(dst->capture_pos,        src->capture_pos,        sizeof(int) * 2 * CAPTURE_MAX);
   memcpy(dst->update_num,         src->update_num,         sizeof(int) * 2);
+  memcpy(&dst->superko_table,     &src->superko_table,     sizeof(superko_table_t));
 
   std::fill_n(dst->tactical_features, board_max * ALL_MAX, 0);
 
@@ -530,12 +577,268 @@ CopyGame( game_info_t *dst, const game_info_t *src )
 
   dst->pass_count = src->pass_count;
 
+  memcpy(dst->stone_bits, src->stone_bits, sizeof(dst->stone_bits));
+  memcpy(dst->legal_bits, src->legal_bits, sizeof(dst->legal_bits));
+  memcpy(dst->meaningful_bits, src->meaningful_bits, sizeof(dst->meaningful_bits));
+
+  dst->moves = src->moves;
+  dst->ko_move = src->ko_move;
+  dst->ko_pos = src->ko_pos;
+
+  ClearJournal(dst);
+}
+
+
+/**
+ * @~english
+ * @brief Restore board position data copied by CopyGame. Only coordinates and strings recorded
+ * in the undo journal are rolled back, so the cost depends on the number of moves played after the copy.
+ * @param[in, out] dst Board position data which has been copied from src by CopyGame.
+ * @param[in] src Board position data source, which must be unchanged since the copy.
+ * @~japanese
+ * @brief CopyGameでコピーした局面情報の復元
+ * 変更履歴に記録された座標と連だけを巻き戻すので, コピー後に進めた手数に応じたコストで済む
+ * @param[in, out] dst CopyGameでsrcからコピーされた局面情報
+ * @param[in] src コピー元の局面情報 (コピー後に変更されていないこと)
+ */
+void
+RestoreGame( game_info_t *dst, const game_info_t *src )
+{
+  // 変化した連の情報を戻す
+  for (int i = 0; i < dst->journal_string_num; i++) {
+    const int id = dst->journal_string[i];
+    dst->journal_string_flag[id] = false;
+    if (src->string[id].flag) {
+      memcpy(&dst->string[id], &src->string[id], sizeof(string_t));
+      int pos = src->string[id].origin;
+      while (pos != STRING_END) {
+        dst->string_id[pos] = id;
+        dst->string_next[pos] = src->string_next[pos];
+        pos = src->string_next[pos];
+      }
+    } else {
+      dst->string[id].flag = false;
+    }
+  }
+
+  // 石が変化した座標を戻す
+  // プレイアウト中はMD2しか更新しないので, パターンは一度消してから置き直す
+  for (int i = 0; i < dst->journal_pos_num; i++) {
+    const int pos = dst->journal_pos[i];
+    dst->journal_pos_flag[pos] = false;
+    UpdatePatternEmpty(dst->pat, pos);
+    dst->board[pos] = src->board[pos];
+    dst->string_id[pos] = src->string_id[pos];
+    dst->string_next[pos] = src->string_next[pos];
+    if (src->board[pos] != S_EMPTY) {
+      UpdatePatternStone(dst->pat, src->board[pos], pos);
+    }
+  }
+
+  dst->journal_pos_num = 0;
+  dst->journal_string_num = 0;
+
+  // 探索木を降りる間に追加された局面を取り除く
+  RewindSuperKoTable(&dst->superko_table, src->superko_table.num);
+
+  // 戦術的特徴はシミュレーション開始時のRatingで全て消去されるので戻さない
+  memcpy(dst->prisoner,    src->prisoner,    sizeof(int) * S_MAX);
+  memcpy(dst->candidates,  src->candidates,  sizeof(bool) * board_max);
+  memcpy(dst->capture_num, src->capture_num, sizeof(int) * 2);
+  memcpy(dst->capture_dir, src->capture_dir, sizeof(int) * 2);
+  memcpy(dst->capture_pos, src->capture_pos, sizeof(int) * 2 * CAPTURE_MAX);
+  memcpy(dst->update_num,  src->update_num,  sizeof(int) * 2);
+
+  dst->current_hash = src->current_hash;
+  dst->previous1_hash = src->previous1_hash;
+  dst->previous2_hash = src->previous2_hash;
+  dst->positional_hash = src->positional_hash;
+  dst->move_hash = src->move_hash;
+
+  dst->pass_count = src->pass_count;
+
+  memcpy(dst->stone_bits, src->stone_bits, sizeof(dst->stone_bits));
+
   dst->moves = src->moves;
   dst->ko_move = src->ko_move;
   dst->ko_pos = src->ko_pos;
 }
 
 
+/**
+ * @~english
+ * @brief Clear the undo journal.
+ * @param[in, out] game Board position data.
+ * @~japanese
+ * @brief 変更履歴の消去
+ * @param[in, out] game 局面情報
+ */
+static void
+ClearJournal( game_info_t *game )
+{
+  std::fill_n(game->journal_pos_flag, BOARD_MAX, false);
+  std::fill_n(game->journal_string_flag, MAX_STRING, false);
+  game->journal_pos_num = 0;
+  game->journal_string_num = 0;
+}
+
+
+/**
+ * @~english
+ * @brief Check whether a move is a legal and meaningful move candidate, ignoring ko.
+ * @param[in] game Board position data.
+ * @param[in] pos Move coordinate.
+ * @param[in] color Player's color.
+ * @param[out] legal Whether the move is empty and not suicide.
+ * @param[out] meaningful Whether the move is not meaningless self atari.
+ * @~japanese
+ * @brief 劫を除いて合法かつ意味のある候補手かの判定
+ * @param[in] game 局面情報
+ * @param[in] pos 着手する座標
+ * @param[in] color 手番の色
+ * @param[out] legal 空点かつ自殺手でなければtrue
+ * @param[out] meaningful 意味のない自己アタリでなければtrue
+ */
+static void
+CheckMoveCandidate( const game_info_t *game, const int pos, const int color, bool &legal, bool &meaningful )
+{
+  legal = game->board[pos] == S_EMPTY &&
+    (nb4_empty[Pat3(game->pat, pos)] != 0 || !IsSuicide(game, game->string, color, pos));
+  meaningful = legal && IsMeaningfulSelfAtari(game, color, pos);
+}
+
+
+/**
+ * @~english
+ * @brief Calculate move candidate bitboards of all intersections for both colors,
+ * and clear the undo journal so that later moves can be applied to them.
+ * @param[in, out] game Board position data.
+ * @~japanese
+ * @brief 両手番の全ての交点の候補手のビットボードを計算し,
+ * 以降の着手を反映できるように変更履歴を消去する
+ * @param[in, out] game 局面情報
+ */
+void
+SetMoveCandidateBits( game_info_t *game )
+{
+  bool legal, meaningful;
+
+  std::fill(game->legal_bits[0], game->legal_bits[2], 0ULL);
+  std::fill(game->meaningful_bits[0], game->meaningful_bits[2], 0ULL);
+
+  for (int i = 0; i < pure_board_max; i++) {
+    const int pos = onboard_pos[i];
+    for (int color = S_BLACK; color <= S_WHITE; color++) {
+      CheckMoveCandidate(game, pos, color, legal, meaningful);
+      if (legal) game->legal_bits[color - 1][i >> 6] |= 1ULL << (i & 63);
+      if (meaningful) game->meaningful_bits[color - 1][i >> 6] |= 1ULL << (i & 63);
+    }
+  }
+
+  ClearJournal(game);
+}
+
+
+/**
+ * @~english
+ * @brief Get legal and meaningful move candidates. Only intersections around moves recorded in
+ * the undo journal since SetMoveCandidateBits are checked again.
+ * The result is the same as checking IsLegal and IsMeaningfulSelfAtari for all intersections.
+ * @param[in] game Board position data.
+ * @param[in] color Player's color.
+ * @param[out] bits Bitboard of move candidates.
+ * @~japanese
+ * @brief 合法かつ意味のある候補手の取得
+ * SetMoveCandidateBits以降に変更履歴に記録された着手の周囲だけを判定し直す
+ * 全ての交点をIsLegalとIsMeaningfulSelfAtariで判定するのと同じ結果になる
+ * @param[in] game 局面情報
+ * @param[in] color 手番の色
+ * @param[out] bits 候補手のビットボード
+ */
+void
+GetMoveCandidateBits( const game_info_t *game, const int color, unsigned long long bits[] )
+{
+  const string_t *string = game->string;
+  const int *string_id = game->string_id;
+  unsigned long long legal[BITBOARD_WORDS], meaningful[BITBOARD_WORDS], dirty[BITBOARD_WORDS] = { 0 };
+  int neighbor4[4];
+
+  memcpy(legal, game->legal_bits[color - 1], sizeof(legal));
+  memcpy(meaningful, game->meaningful_bits[color - 1], sizeof(meaningful));
+
+  // 石が変化した座標と, その周囲で判定が変わりうる座標に印を付ける
+  for (int i = 0; i < game->journal_pos_num; i++) {
+    const int pos = game->journal_pos[i];
+    for (int y = -1; y <= 1; y++) {
+      for (int x = -1; x <= 1; x++) {
+        const int around = pos + y * board_size + x;
+        if (game->board[around] == S_OB) continue;
+        // 上下左右は空点の形が変わる
+        if (x == 0 || y == 0) {
+          const int index = onboard_index[around];
+          dirty[index >> 6] |= 1ULL << (index & 63);
+        }
+        // 呼吸点が2の連の呼吸点の周囲の形は自己アタリの判定に使われる
+        if (game->board[around] == S_EMPTY) {
+          GetNeighbor4(neighbor4, around);
+          for (int j = 0; j < 4; j++) {
+            const int id = string_id[neighbor4[j]];
+            if (game->board[neighbor4[j]] != S_EMPTY && game->board[neighbor4[j]] != S_OB &&
+                string[id].libs == 2) {
+              for (int k = 0; k < bitboard_words; k++) dirty[k] |= string[id].lib_bits[k];
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // 呼吸点が変化した連の呼吸点
+  for (int i = 0; i < game->journal_string_num; i++) {
+    const string_t *changed = &string[game->journal_string[i]];
+    if (changed->flag) {
+      for (int k = 0; k < bitboard_words; k++) dirty[k] |= changed->lib_bits[k];
+    }
+  }
+
+  // 印を付けた座標だけ判定し直す
+  for (int i = 0; i < bitboard_words; i++) {
+    unsigned long long rest = dirty[i];
+    while (rest != 0) {
+      const int index = (i << 6) + LowestBit(rest);
+      const unsigned long long bit = 1ULL << (index & 63);
+      bool is_legal, is_meaningful;
+      rest &= rest - 1;
+      CheckMoveCandidate(game, onboard_pos[index], color, is_legal, is_meaningful);
+      legal[i] = is_legal ? (legal[i] | bit) : (legal[i] & ~bit);
+      meaningful[i] = is_meaningful ? (meaningful[i] | bit) : (meaningful[i] & ~bit);
+    }
+  }
+
+  for (int i = 0; i < bitboard_words; i++) {
+    bits[i] = legal[i] & meaningful[i];
+  }
+
+  // 劫と超劫は着手ごとに変わるので最後に除外する
+  if (game->ko_move == game->moves - 1 && game->board[game->ko_pos] == S_EMPTY) {
+    const int index = onboard_index[game->ko_pos];
+    bits[index >> 6] &= ~(1ULL << (index & 63));
+  }
+  if (check_superko) {
+    for (int i = 0; i < bitboard_words; i++) {
+      unsigned long long rest = bits[i];
+      while (rest != 0) {
+        const int index = (i << 6) + LowestBit(rest);
+        rest &= rest - 1;
+        if (!IsLegal(game, onboard_pos[index], color)) {
+          bits[i] &= ~(1ULL << (index & 63));
+        }
+      }
+    }
+  }
+}
+
+
 /**
  * @~english
  * @brief Initialize constant values.
@@ -554,12 +857,15 @@ InitializeConst( void )
   i = 0;
   for (int y = board_start; y <= board_end; y++) {
     for (int x = board_start; x <= board_end; x++) {
+      onboard_index[POS(x, y)] = i;
       onboard_pos[i++] = POS(x, y);
       board_x[POS(x, y)] = x;
       board_y[POS(x, y)] = y;
     }
   }
 
+  InitializeBitBoard();
+
   for (int y = board_start; y <= board_end; y++) {
     for (int x = board_start; x <= (board_start + pure_board_size / 2); x++) {
       border_dis_x[POS(x, y)] = x - (OB_SIZE - 1);
@@ -867,52 +1173,78 @@ IsLegal( const game_info_t *game, const int pos, const int color )
 
   // 超劫である
   if (check_superko &&
-      pos != PASS) {
-    const int other = GetOppositeColor(color);
-    const string_t *string = game->string;
-    const int *string_id = game->string_id;
-    const int *string_next = game->string_next;
-    unsigned long long hash = game->positional_hash;
-    int neighbor4[4], check[4], checked = 0, id, str_pos;
-    bool flag;
-
-    GetNeighbor4(neighbor4, pos);
-
-    // この1手で石を取れる時の処理
-    for (int i = 0; i < 4; i++) {
-      if (game->board[neighbor4[i]] == other) {
-        id = string_id[neighbor4[i]];
-        if (string[id].libs == 1) {
-          flag = false;
-          for (int j = 0; j < checked; j++) {
-            if (check[j] == id) {
-              flag = true;
-            }
-          }
-          if (flag) {
-            continue;
+      pos != PASS &&
+      IsSuperKoMove(game->board, game->string, game->string_id, game->string_next,
+                    game->positional_hash, &game->superko_table, pos, color)) {
+    return false;
+  }
+  
+  return true;
+}
+
+
+/**
+ * @~english
+ * @brief Check whether a move repeats a previous position. It is shared by game_info_t and search_game_info_t.
+ * @param[in] board Board.
+ * @param[in] string String data.
+ * @param[in] string_id String IDs.
+ * @param[in] string_next Next stone coordinates of strings.
+ * @param[in] hash Positional hash value of the current position.
+ * @param[in] table Hash values of previous positions.
+ * @param[in] pos Move coordinate.
+ * @param[in] color Player's color.
+ * @return Positional superko flag.
+ * @~japanese
+ * @brief 超劫になる着手かの判定 (game_info_tとsearch_game_info_tで共通)
+ * @param[in] board 盤面
+ * @param[in] string 連の情報
+ * @param[in] string_id 連のID
+ * @param[in] string_next 連を構成する次の石の座標
+ * @param[in] hash 現局面の盤面のハッシュ値
+ * @param[in] table これまでの局面のハッシュ値
+ * @param[in] pos 着手する座標
+ * @param[in] color 手番の色
+ * @return 超劫ならばtrue
+ */
+bool
+IsSuperKoMove( const char *board, const string_t *string, const int *string_id, const int *string_next,
+               unsigned long long hash, const superko_table_t *table, const int pos, const int color )
+{
+  const int other = GetOppositeColor(color);
+  int neighbor4[4], check[4], checked = 0, id, str_pos;
+  bool flag;
+
+  GetNeighbor4(neighbor4, pos);
+
+  // この1手で石を取れる時の処理
+  for (int i = 0; i < 4; i++) {
+    if (board[neighbor4[i]] == other) {
+      id = string_id[neighbor4[i]];
+      if (string[id].libs == 1) {
+        flag = false;
+        for (int j = 0; j < checked; j++) {
+          if (check[j] == id) {
+            flag = true;
           }
-          str_pos = string[id].origin;
-          do {
-            hash ^= hash_bit[str_pos][other];
-            str_pos = string_next[str_pos];
-          } while (str_pos != STRING_END);
         }
-        check[checked++] = id;
-      }
-    }
-
-    // posにcolorを置いたと仮定
-    hash ^= hash_bit[pos][color];
-    
-    for (int i = 0; i < game->moves; i++) {
-      if (game->record[i].hash == hash) {
-        return false;
+        if (flag) {
+          continue;
+        }
+        str_pos = string[id].origin;
+        do {
+          hash ^= hash_bit[str_pos][other];
+          str_pos = string_next[str_pos];
+        } while (str_pos != STRING_END);
       }
+      check[checked++] = id;
     }
   }
-  
-  return true;
+
+  // posにcolorを置いたと仮定
+  hash ^= hash_bit[pos][color];
+
+  return FindSuperKoHash(table, hash);
 }
 
 
@@ -994,8 +1326,8 @@ IsFalseEyeConnection( const game_info_t *game, const int pos, const int color )
     if (board[neighbor4[i]] == color) {
       id = string_id[neighbor4[i]];
       if (string[id].libs == 2) {
-        lib = string[id].lib[0];
-        if (lib == pos) lib = string[id].lib[lib];
+        lib = FirstLiberty(&string[id]);
+        if (lib == pos) lib = NextLiberty(&string[id], lib);
         if (IsSelfAtari(game, color, lib)) return true;
       }
       already_checked = false;
@@ -1006,7 +1338,7 @@ IsFalseEyeConnection( const game_info_t *game, const int pos, const int color )
         }
       }
       if (already_checked) continue;
-      lib = string[id].lib[0];
+      lib = FirstLiberty(&string[id]);
       count = 0;
       while (lib != LIBERTY_END) {
         if (lib != pos) {
@@ -1022,7 +1354,7 @@ IsFalseEyeConnection( const game_info_t *game, const int pos, const int color )
             count++;
           }
         }
-        lib = string[id].lib[lib];
+        lib = NextLiberty(&string[id], lib);
       }
       libs += count;
       string_liberties[strings] = string[id].libs;
@@ -1035,13 +1367,13 @@ IsFalseEyeConnection( const game_info_t *game, const int pos, const int color )
     lib_sum += string_liberties[i] - 1;
   }
 
-  neighbor = string[checked_string[0]].neighbor[0];
+  neighbor = FirstNeighbor(&string[checked_string[0]]);
   while (neighbor != NEIGHBOR_END) {
     if (string[neighbor].libs == 1 &&
-        string[checked_string[1]].neighbor[neighbor] != 0) {
+        IsNeighbor(&string[checked_string[1]], neighbor)) {
       return false;
     }
-    neighbor = string[checked_string[0]].neighbor[neighbor];
+    neighbor = NextNeighbor(&string[checked_string[0]], neighbor);
   }
 
   // 隣接する連が一続きなら眼なのでfalseを返す
@@ -1229,6 +1561,7 @@ PutStone( game_info_t *game, const int pos, const int color )
   if (pos == PASS) {
     if (game->moves < MAX_RECORDS) {
       game->record[game->moves].hash = game->positional_hash;
+      AddSuperKoHash(&game->superko_table, game->positional_hash);
     }
     game->current_hash ^= hash_bit[game->pass_count++][HASH_PASS];
     if (game->pass_count >= BOARD_MAX) { 
@@ -1240,6 +1573,8 @@ PutStone( game_info_t *game, const int pos, const int color )
 
   // 石を置く
   board[pos] = static_cast<char>(color);
+  SetStoneBit(game, pos, color);
+  RecordJournalPosition(game, pos);
 
   // 候補手から除外
   game->candidates[pos] = false;
@@ -1258,9 +1593,11 @@ PutStone( game_info_t *game, const int pos, const int color )
   // 敵の連であれば, その連の呼吸点を1つ減らし, 呼吸点が0になったら取り除く
   for (int i = 0; i < 4; i++) {
     if (board[neighbor[i]] == color) {
+      RecordJournalString(game, string_id[neighbor[i]]);
       RemoveLiberty(game, &string[string_id[neighbor[i]]], pos);
       connect[connection++] = string_id[neighbor[i]];
     } else if (board[neighbor[i]] == other) {
+      RecordJournalString(game, string_id[neighbor[i]]);
       RemoveLiberty(game, &string[string_id[neighbor[i]]], pos);
       if (string[string_id[neighbor[i]]].libs == 0) {
         prisoner += RemoveString(game, &string[string_id[neighbor[i]]], color);
@@ -1280,7 +1617,7 @@ PutStone( game_info_t *game, const int pos, const int color )
     if (prisoner == 1 &&
         string[string_id[pos]].libs == 1) {
       game->ko_move = game->moves;
-      game->ko_pos = string[string_id[pos]].lib[0];
+      game->ko_pos = FirstLiberty(&string[string_id[pos]]);
       game->current_hash ^= hash_bit[game->ko_pos][HASH_KO];
     }
   } else if (connection == 1) {
@@ -1288,10 +1625,12 @@ PutStone( game_info_t *game, const int pos, const int color )
   } else {
     ConnectString(game, pos, color, connection, connect);
   }
+  RecordJournalString(game, string_id[pos]);
 
   // ハッシュ値の記録
   if (game->moves < MAX_RECORDS) {
     game->record[game->moves].hash = game->positional_hash;
+    AddSuperKoHash(&game->superko_table, game->positional_hash);
   }
   
   // 手数を1つだけ進める
@@ -1322,6 +1661,15 @@ PoPutStone( game_info_t *game, const int pos, const int color )
   int neighbor[4], connect[4] = { 0 };
   int *update_pos = game->update_pos[color - 1];
   int &update_num = game->update_num[color - 1];
+  int *capture_pos = game->capture_pos[color - 1];
+
+  // 前回の着手で打ち上げた石の記録を消す
+  int tmp = capture_pos[0];
+  while (tmp < CAPTURE_END) {
+    const int next = capture_pos[tmp];
+    capture_pos[tmp] = 0;
+    tmp = next;
+  }
 
   // この手番の着手で打ち上げた石の数を0にする
   game->capture_pos[color - 1][0] = CAPTURE_END;
@@ -1342,17 +1690,15 @@ PoPutStone( game_info_t *game, const int pos, const int color )
 
   // 碁盤に石を置く
   board[pos] = static_cast<char>(color);
+  SetStoneBit(game, pos, color);
+  RecordJournalPosition(game, pos);
 
   // 候補酒から除外
   game->candidates[pos] = false;
 
   // 着手箇所のレートを0に戻す
-  game->sum_rate[0] -= game->rate[0][pos];
-  game->sum_rate_row[0][board_y[pos]] -= game->rate[0][pos];
-  game->rate[0][pos] = 0;
-  game->sum_rate[1] -= game->rate[1][pos];
-  game->sum_rate_row[1][board_y[pos]] -= game->rate[1][pos];
-  game->rate[1][pos] = 0;
+  UpdateRate(&game->sum_rate[0], game->sum_rate_tree[0], game->rate[0], pos, 0);
+  UpdateRate(&game->sum_rate[1], game->sum_rate_tree[1], game->rate[1], pos, 0);
 
   // 着手箇所の戦術的特徴を全て消す
   ClearTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
@@ -1368,9 +1714,11 @@ PoPutStone( game_info_t *game, const int pos, const int color )
   // 敵の連であれば, その連の呼吸点を1つ減らし, 呼吸点が0になったら取り除く  
   for (int i = 0; i < 4; i++) {
     if (board[neighbor[i]] == color) {
+      RecordJournalString(game, string_id[neighbor[i]]);
       PoRemoveLiberty(game, &string[string_id[neighbor[i]]], pos, color);
       connect[connection++] = string_id[neighbor[i]];
     } else if (board[neighbor[i]] == other) {
+      RecordJournalString(game, string_id[neighbor[i]]);
       PoRemoveLiberty(game, &string[string_id[neighbor[i]]], pos, color);
       if (string[string_id[neighbor[i]]].libs == 0) {
         prisoner += PoRemoveString(game, &string[string_id[neighbor[i]]], color);
@@ -1389,22 +1737,33 @@ PoPutStone( game_info_t *game, const int pos, const int color )
     if (prisoner == 1 &&
         string[string_id[pos]].libs == 1) {
       game->ko_move = game->moves;
-      game->ko_pos = string[string_id[pos]].lib[0];
+      game->ko_pos = FirstLiberty(&string[string_id[pos]]);
     }
   } else if (connection == 1) {
     AddStone(game, pos, color, connect[0]);
   } else {
     ConnectString(game, pos, color, connection, connect);
   }
+  RecordJournalString(game, string_id[pos]);
 
   if (string[string_id[pos]].libs < 3) {
-    int lib = string[string_id[pos]].lib[0];
+    int lib = FirstLiberty(&string[string_id[pos]]);
     while (lib != LIBERTY_END) {
       update_pos[update_num++] = lib;
-      lib = string[string_id[pos]].lib[lib];
+      lib = NextLiberty(&string[string_id[pos]], lib);
     }
   }
 
+  // 着手箇所と打ち上げた石の座標を両方の手番のレート更新対象に加える
+  RecordDirtyPosition(game, S_BLACK, pos);
+  RecordDirtyPosition(game, S_WHITE, pos);
+  tmp = capture_pos[0];
+  while (tmp < CAPTURE_END) {
+    RecordDirtyPosition(game, S_BLACK, tmp);
+    RecordDirtyPosition(game, S_WHITE, tmp);
+    tmp = capture_pos[tmp];
+  }
+
   // 手数を進める
   game->moves++;
 }
@@ -1435,29 +1794,36 @@ CheckBentFourInTheCorner( game_info_t *game )
         string[id].libs == 2 &&
         string[id].neighbors == 1) {
       const int color = string[id].color;
-      const int lib1 = string[id].lib[0];
-      const int lib2 = string[id].lib[lib1];
+      const int lib1 = FirstLiberty(&string[id]);
+      const int lib2 = NextLiberty(&string[id], lib1);
       if ((board[corner_neighbor[i][0]] == S_EMPTY ||
           board[corner_neighbor[i][0]] == color) &&
           (board[corner_neighbor[i][1]] == S_EMPTY ||
           board[corner_neighbor[i][1]] == color)) {
-        neighbor = string[id].neighbor[0];
+        neighbor = FirstNeighbor(&string[id]);
         if (string[neighbor].libs == 2 &&
             string[neighbor].size > 6) {
           // 呼吸点を共有しているかの確認
-          const int neighbor_lib1 = string[neighbor].lib[0];
-          const int neighbor_lib2 = string[neighbor].lib[neighbor_lib1];
+          const int neighbor_lib1 = FirstLiberty(&string[neighbor]);
+          const int neighbor_lib2 = NextLiberty(&string[neighbor], neighbor_lib1);
           if ((neighbor_lib1 == lib1 && neighbor_lib2 == lib2) ||
               (neighbor_lib1 == lib2 && neighbor_lib2 == lib1)) {
             pos = string[neighbor].origin;
             while (pos != STRING_END) {
+              ClearStoneBit(game, pos, board[pos]);
               board[pos] = static_cast<char>(color);
+              SetStoneBit(game, pos, color);
+              RecordJournalPosition(game, pos);
               pos = string_next[pos];
             }
-            pos = string[neighbor].lib[0];
+            pos = FirstLiberty(&string[neighbor]);
             board[pos] = static_cast<char>(color);
-            pos = string[neighbor].lib[pos];
+            SetStoneBit(game, pos, color);
+            RecordJournalPosition(game, pos);
+            pos = NextLiberty(&string[neighbor], pos);
             board[pos] = static_cast<char>(color);
+            SetStoneBit(game, pos, color);
+            RecordJournalPosition(game, pos);
           }
         }
       }
@@ -1479,18 +1845,11 @@ CheckBentFourInTheCorner( game_info_t *game )
 int
 CalculateScore( game_info_t *game )
 {
-  const char *board = game->board;
-  int color;
-  int scores[S_MAX] = { 0 };
+  unsigned long long black_area[BITBOARD_WORDS], white_area[BITBOARD_WORDS];
 
-  // 地の数え上げ
-  for (int i = 0; i < pure_board_max; i++) {
-    const int pos = onboard_pos[i];
-    color = board[pos];
-    if (color == S_EMPTY) color = territory[Pat3(game->pat, pos)];
-    scores[color]++;
-  }
+  // 地の数え上げ (石と4近傍が同色の空点)
+  CalculateAreaBits(game, black_area, white_area);
 
   //  黒−白を返す(コミなし)
-  return (scores[S_BLACK] - scores[S_WHITE]);
+  return (CountBits(black_area) - CountBits(white_area));
 }
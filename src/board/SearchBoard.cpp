@@ -13,10 +13,12 @@
 #include <iostream>
 
 #include "board/SearchBoard.hpp"
+#include "board/String.hpp"
+#include "board/ZobristHash.hpp"
 
 
 //  呼吸点の追加 
-static int AddLiberty( string_t *string, const int pos, const int head );
+static void AddLiberty( string_t *string, const int pos );
 
 //  隣接する敵連のIDの追加
 static void AddNeighbor( string_t *string, const int id );
@@ -90,10 +92,20 @@ search_game_info_t::search_game_info_t( const game_info_t *src )
   moves = src->moves;
   ko_move = src->ko_move;
   ko_pos = src->ko_pos;
+  positional_hash = src->positional_hash;
+
+  // 超劫が有効な時だけ局面のハッシュ集合をコピーする
+  if (GetSuperKo()) {
+    memcpy(&superko_table, &src->superko_table, sizeof(superko_table_t));
+  } else {
+    superko_table.num = 0;
+  }
 
   memset(&undo[moves], 0, sizeof(undo_record_t));
   undo[moves].ko_move_record = ko_move;
   undo[moves].ko_pos_record = ko_pos;
+  undo[moves].positional_hash_record = positional_hash;
+  undo[moves].superko_record = superko_table.num;
 }
 
 
@@ -131,6 +143,14 @@ IsLegalForSearch( const search_game_info_t *game, const int pos, const int color
     return false;
   }
 
+  // 超劫である
+  if (GetSuperKo() &&
+      pos != PASS &&
+      IsSuperKoMove(game->board, game->string, game->string_id, game->string_next,
+                    game->positional_hash, &game->superko_table, pos, color)) {
+    return false;
+  }
+
   return true;
 }
 
@@ -206,6 +226,7 @@ PutStoneForSearch( search_game_info_t *game, const int pos, const int color )
 
   // 石を置く
   board[pos] = (char)color;
+  game->positional_hash ^= hash_bit[pos][color];
 
   // 候補手から除外
   game->candidates[pos] = false;
@@ -243,7 +264,7 @@ PutStoneForSearch( search_game_info_t *game, const int pos, const int color )
     if (prisoner == 1 &&
         string[string_id[pos]].libs == 1) {
       game->ko_move = game->moves;
-      game->ko_pos = string[string_id[pos]].lib[0];
+      game->ko_pos = FirstLiberty(&string[string_id[pos]]);
     }
   } else if (connection == 1) {
     RecordString(game, connect[0]);
@@ -252,11 +273,18 @@ PutStoneForSearch( search_game_info_t *game, const int pos, const int color )
     ConnectString(game, pos, color, connection, connect);
   }
 
+  // 超劫判定のために局面を記録
+  if (GetSuperKo()) {
+    AddSuperKoHash(&game->superko_table, game->positional_hash);
+  }
+
   // 手数を1つだけ進める
   game->moves++;
   memset(&game->undo[game->moves], 0, sizeof(undo_record_t));
   game->undo[game->moves].ko_move_record = game->ko_move;
   game->undo[game->moves].ko_pos_record = game->ko_pos;
+  game->undo[game->moves].positional_hash_record = game->positional_hash;
+  game->undo[game->moves].superko_record = game->superko_table.num;
 
 }
 
@@ -264,42 +292,27 @@ PutStoneForSearch( search_game_info_t *game, const int pos, const int color )
 /**
  * @~english
  * @brief Process to add a liberty.
- * @param[in, out] string String data.
+ * @param[in, out] string String will be updated.
  * @param[in] pos Liberty coordinate.
- * @param[in] head Search index.
- * @return Liberty intersection.
  * @~japanese
  * @brief 呼吸点の追加
  * @param[in, out] string 呼吸点を追加する対象の連
  * @param[in] pos 追加する呼吸点の座標
- * @param[in] head 探索対象の先頭のインデックス
- * @return 追加した呼吸点の座標
  */
-static int
-AddLiberty( string_t *string, const int pos, const int head )
+static void
+AddLiberty( string_t *string, const int pos )
 {
-  int lib;
-  
-  // 既に追加されている場合は何もしない
-  if (string->lib[pos] != 0) return pos;
-
-  // 探索対象の先頭のインデックスを代入
-  lib = head;
+  const int index = onboard_index[pos];
+  const unsigned long long bit = 1ULL << (index & 63);
 
-  // 追加する場所を見つけるまで進める
-  while (string->lib[lib] < pos) {
-    lib = string->lib[lib];
-  }
+  // 既に追加されている場合は何もしない
+  if (string->lib_bits[index >> 6] & bit) return;
 
   // 呼吸点の座標を追加する
-  string->lib[pos] = string->lib[lib];
-  string->lib[lib] = (short)pos;
+  string->lib_bits[index >> 6] |= bit;
 
   // 呼吸点の数を1つ増やす
   string->libs++;
-
-  // 追加した呼吸点の座標を返す
-  return pos;
 }
 
 
@@ -316,19 +329,13 @@ AddLiberty( string_t *string, const int pos, const int head )
 static void
 AddNeighbor( string_t *string, const int id )
 {
-  int neighbor = 0;
+  const unsigned long long bit = 1ULL << (id & 63);
 
   // 既に追加されている場合は何もしない
-  if (string->neighbor[id] != 0) return;
-
-  // 追加場所を見つけるまで進める
-  while (string->neighbor[neighbor] < id) {
-    neighbor = string->neighbor[neighbor];
-  }
+  if (string->neighbor_bits[id >> 6] & bit) return;
 
   // 隣接する連IDを追加する
-  string->neighbor[id] = string->neighbor[neighbor];
-  string->neighbor[neighbor] = (short)id;
+  string->neighbor_bits[id >> 6] |= bit;
 
   // 隣接する連の数を1つ増やす
   string->neighbors++;
@@ -393,7 +400,6 @@ AddStone( search_game_info_t *game, const int pos, const int color, const int id
   string_t *string = game->string;
   string_t *add_str;
   int *string_id = game->string_id;
-  int lib_add = 0;
   int other = GetOppositeColor(color);
   int neighbor, neighbor4[4];
 
@@ -413,7 +419,7 @@ AddStone( search_game_info_t *game, const int pos, const int color, const int id
   // 敵の石があれば隣接する敵連の情報を更新
   for (int i = 0; i < 4; i++) {
     if (board[neighbor4[i]] == S_EMPTY) {
-      lib_add = AddLiberty(add_str, neighbor4[i], lib_add);
+      AddLiberty(add_str, neighbor4[i]);
     } else if (board[neighbor4[i]] == other) {
       neighbor = string_id[neighbor4[i]];
       AddNeighbor(&string[neighbor], id);
@@ -549,7 +555,6 @@ MakeString( search_game_info_t *game, const int pos, const int color )
   char *board = game->board;
   int *string_id = game->string_id;
   int id = 1;
-  int lib_add = 0;
   int other = GetOppositeColor(color);
   int neighbor, neighbor4[4];
 
@@ -560,11 +565,9 @@ MakeString( search_game_info_t *game, const int pos, const int color )
   new_string = &game->string[id];
 
   // 連のデータの初期化
-  std::fill_n(new_string->lib, STRING_LIB_MAX, 0);
-  std::fill_n(new_string->neighbor, MAX_NEIGHBOR, 0);
+  std::fill_n(new_string->lib_bits, LIBERTY_WORDS, 0ULL);
+  std::fill_n(new_string->neighbor_bits, NEIGHBOR_WORDS, 0ULL);
   new_string->color = static_cast<char>(color);
-  new_string->lib[0] = LIBERTY_END;
-  new_string->neighbor[0] = NEIGHBOR_END;
   new_string->libs = 0;
   new_string->origin = pos;
   new_string->size = 1;
@@ -580,7 +583,7 @@ MakeString( search_game_info_t *game, const int pos, const int color )
   // 敵の連ならば, 隣接する連をお互いに追加する
   for (int i = 0; i < 4; i++) {
     if (board[neighbor4[i]] == S_EMPTY) {
-      lib_add = AddLiberty(new_string, neighbor4[i], lib_add);
+      AddLiberty(new_string, neighbor4[i]);
     } else if (board[neighbor4[i]] == other) {
       neighbor = string_id[neighbor4[i]];
       AddNeighbor(&string[neighbor], id);
@@ -606,22 +609,11 @@ MakeString( search_game_info_t *game, const int pos, const int color )
 static void
 MergeLiberty( string_t *dst, string_t *src )
 {
-  int dst_lib = 0, src_lib = 0;
-
-  while (src_lib != LIBERTY_END) {
-    // 既に呼吸点に含まれていれば次の座標へ
-    if (dst->lib[src_lib] == 0) {
-      // 該当する場所を見つけるまで進める
-      while (dst->lib[dst_lib] < src_lib) {
-        dst_lib = dst->lib[dst_lib];
-      }
-      // 呼吸点の座標を挿入する
-      dst->lib[src_lib] = dst->lib[dst_lib];
-      dst->lib[dst_lib] = src_lib;
-      // 呼吸点を1つ増やす
-      dst->libs++;
-    }
-    src_lib = src->lib[src_lib];
+  // 呼吸点の集合の和をとり, 呼吸点の数を数え直す
+  dst->libs = 0;
+  for (int i = 0; i < LIBERTY_WORDS; i++) {
+    dst->lib_bits[i] |= src->lib_bits[i];
+    dst->libs += PopCount(dst->lib_bits[i]);
   }
 }
 
@@ -733,26 +725,21 @@ MergeString( search_game_info_t *game, string_t *dst, string_t *src[3], const in
 static void
 RemoveLiberty( search_game_info_t *game, string_t *string, const int pos )
 {
-  int lib = 0;
+  const int index = onboard_index[pos];
+  const unsigned long long bit = 1ULL << (index & 63);
 
   // 既に取り除かれている場合は何もしない
-  if (string->lib[pos] == 0) return;
-
-  // 取り除く呼吸点の座標を見つけるまで進める
-  while (string->lib[lib] != pos) {
-    lib = string->lib[lib];
-  }
+  if (!(string->lib_bits[index >> 6] & bit)) return;
 
   // 呼吸点の座標の情報を取り除く
-  string->lib[lib] = string->lib[string->lib[lib]];
-  string->lib[pos] = static_cast<short>(0);
+  string->lib_bits[index >> 6] &= ~bit;
 
   // 連の呼吸点の数を1つ減らす
   string->libs--;
 
   // 呼吸点が1つならば, その連の呼吸点を候補手に追加
   if (string->libs == 1) {
-    game->candidates[string->lib[0]] = true;
+    game->candidates[FirstLiberty(string)] = true;
   }
 }
 
@@ -776,23 +763,13 @@ RemoveLiberty( search_game_info_t *game, string_t *string, const int pos )
 static void
 MergeNeighbor( string_t *string, string_t *dst, string_t *src, const int id, const int rm_id )
 {
-  int src_neighbor = 0, dst_neighbor = 0;
-  int neighbor = src->neighbor[0];
-
-  while (src_neighbor != NEIGHBOR_END) {
-    // 既に隣接する敵連のIDが含まれていれば次の座標へ
-    if (dst->neighbor[src_neighbor] == 0) {
-      // 該当する場所を見つけるまで進める
-      while (dst->neighbor[dst_neighbor] < src_neighbor) {
-        dst_neighbor = dst->neighbor[dst_neighbor];
-      }
-      // 隣接する敵連のIDを挿入する
-      dst->neighbor[src_neighbor] = dst->neighbor[dst_neighbor];
-      dst->neighbor[dst_neighbor] = src_neighbor;
-      // 隣接する敵連の個数を1つ増やす
-      dst->neighbors++;
-    }
-    src_neighbor = src->neighbor[src_neighbor];
+  int neighbor = FirstNeighbor(src);
+
+  // 隣接する敵連のIDの集合の和をとり, 個数を数え直す
+  dst->neighbors = 0;
+  for (int i = 0; i < NEIGHBOR_WORDS; i++) {
+    dst->neighbor_bits[i] |= src->neighbor_bits[i];
+    dst->neighbors += PopCount(dst->neighbor_bits[i]);
   }
 
   // 元あった連srcに隣接する敵連の
@@ -800,7 +777,7 @@ MergeNeighbor( string_t *string, string_t *dst, string_t *src, const int id, con
   while (neighbor != NEIGHBOR_END) {
     RemoveNeighborString(&string[neighbor], rm_id);
     AddNeighbor(&string[neighbor], id);
-    neighbor = src->neighbor[neighbor];
+    neighbor = NextNeighbor(src, neighbor);
   }
 }
 
@@ -818,19 +795,13 @@ MergeNeighbor( string_t *string, string_t *dst, string_t *src, const int id, con
 static void
 RemoveNeighborString( string_t *string, const int id )
 {
-  int neighbor = 0;
+  const unsigned long long bit = 1ULL << (id & 63);
 
   // 既に除外されていれば何もしない
-  if (string->neighbor[id] == 0) return;
-
-  // 取り除く隣接する連IDを見つけるまで進める
-  while (string->neighbor[neighbor] != id) {
-    neighbor = string->neighbor[neighbor];
-  }
+  if (!(string->neighbor_bits[id >> 6] & bit)) return;
 
   // 隣接する連IDを取り除く
-  string->neighbor[neighbor] = string->neighbor[string->neighbor[neighbor]];
-  string->neighbor[id] = 0;
+  string->neighbor_bits[id >> 6] &= ~bit;
 
   // 隣接する連の数を1つ減らす
   string->neighbors--;
@@ -863,6 +834,7 @@ RemoveString( search_game_info_t *game, string_t *string )
   do {
     // 空点に戻す
     board[pos] = S_EMPTY;
+    game->positional_hash ^= hash_bit[pos][static_cast<int>(string->color)];
 
     // 候補手に追加する
     candidates[pos] = true;
@@ -872,10 +844,10 @@ RemoveString( search_game_info_t *game, string_t *string )
 
     // 上下左右を確認する
     // 隣接する連があれば呼吸点を追加する
-    if (str[string_id[NORTH(pos)]].flag) AddLiberty(&str[string_id[NORTH(pos)]], pos, 0);
-    if (str[string_id[ WEST(pos)]].flag) AddLiberty(&str[string_id[ WEST(pos)]], pos, 0);
-    if (str[string_id[ EAST(pos)]].flag) AddLiberty(&str[string_id[ EAST(pos)]], pos, 0);
-    if (str[string_id[SOUTH(pos)]].flag) AddLiberty(&str[string_id[SOUTH(pos)]], pos, 0);
+    if (str[string_id[NORTH(pos)]].flag) AddLiberty(&str[string_id[NORTH(pos)]], pos);
+    if (str[string_id[ WEST(pos)]].flag) AddLiberty(&str[string_id[ WEST(pos)]], pos);
+    if (str[string_id[ EAST(pos)]].flag) AddLiberty(&str[string_id[ EAST(pos)]], pos);
+    if (str[string_id[SOUTH(pos)]].flag) AddLiberty(&str[string_id[SOUTH(pos)]], pos);
 
     // 連を構成する次の石の座標を記録
     next = string_next[pos];
@@ -890,10 +862,10 @@ RemoveString( search_game_info_t *game, string_t *string )
   } while (pos != STRING_END);
 
   // 取り除いた連に隣接する連から隣接情報を取り除く
-  neighbor = string->neighbor[0];
+  neighbor = FirstNeighbor(string);
   while (neighbor != NEIGHBOR_END) {
     RemoveNeighborString(&str[neighbor], rm_id);
-    neighbor = string->neighbor[neighbor];
+    neighbor = NextNeighbor(string, neighbor);
   }
 
   // 連の存在フラグをオフ
@@ -927,7 +899,6 @@ RestoreChain( search_game_info_t *game, const int id, const int stone[], const i
   string_t *new_string;
   char *board = game->board;
   int *string_id = game->string_id;
-  int lib_add = 0;
   const int other = GetOppositeColor(color);
   int neighbor, neighbor4[4];
   int pos;
@@ -936,11 +907,9 @@ RestoreChain( search_game_info_t *game, const int id, const int stone[], const i
   new_string = &game->string[id];
 
   // 連の初期化
-  std::fill_n(new_string->lib, STRING_LIB_MAX, 0);
-  std::fill_n(new_string->neighbor, MAX_NEIGHBOR, 0);
+  std::fill_n(new_string->lib_bits, LIBERTY_WORDS, 0ULL);
+  std::fill_n(new_string->neighbor_bits, NEIGHBOR_WORDS, 0ULL);
   new_string->color = static_cast<char>(color);
-  new_string->lib[0] = LIBERTY_END;
-  new_string->neighbor[0] = NEIGHBOR_END;
   new_string->libs = 0;
   new_string->origin = stone[0];
   new_string->size = stones;
@@ -967,7 +936,7 @@ RestoreChain( search_game_info_t *game, const int id, const int stone[], const i
     // 敵の連ならば, 隣接する連をお互いに追加する
     for (int j = 0; j < 4; j++) {
       if (board[neighbor4[j]] == S_EMPTY) {
-        AddLiberty(new_string, neighbor4[j], lib_add);
+        AddLiberty(new_string, neighbor4[j]);
       } else if (board[neighbor4[j]] == other) {
         neighbor = string_id[neighbor4[j]];
         RemoveLiberty(game, &string[neighbor], pos);
@@ -1017,6 +986,8 @@ Undo( search_game_info_t *game )
 
   game->ko_move = rec->ko_move_record;
   game->ko_pos = rec->ko_pos_record;
+  game->positional_hash = rec->positional_hash_record;
+  RewindSuperKoTable(&game->superko_table, rec->superko_record);
 
   game->moves--;
 }
@@ -6,16 +6,18 @@
  * @~japanese
  * @brief 連の管理
  */
+#include <algorithm>
+
 #include "board/GoBoard.hpp"
 #include "board/String.hpp"
 #include "board/ZobristHash.hpp"
 
 
 // 呼吸点を連に追加
-static int AddLiberty( string_t *string, const int pos, const int head );
+static void AddLiberty( string_t *string, const int pos );
 
 // 隣接する連IDの追加
-static void AddNeighbor( string_t *string, const int id, const int head );
+static void AddNeighbor( string_t *string, const int id );
 
 // 連に石を追加
 static void AddStoneToString( game_info_t *game, string_t *string, const int pos, const int head );
@@ -50,7 +52,7 @@ MakeString( game_info_t *game, const int pos, const int color )
   string_t *string = game->string;
   string_t *new_string;
   int *string_id = game->string_id;
-  int id = 1, lib_add = 0, neighbor, neighbor4[4];
+  int id = 1, neighbor, neighbor4[4];
 
   // 未使用の連のインデックスを見つける
   while (string[id].flag) { id++; }
@@ -59,10 +61,8 @@ MakeString( game_info_t *game, const int pos, const int color )
   new_string = &game->string[id];
 
   // 連のデータの初期化
-  std::fill_n(new_string->lib, STRING_LIB_MAX, 0);
-  std::fill_n(new_string->neighbor, MAX_NEIGHBOR, 0);
-  new_string->lib[0] = LIBERTY_END;
-  new_string->neighbor[0] = NEIGHBOR_END;
+  std::fill_n(new_string->lib_bits, LIBERTY_WORDS, 0ULL);
+  std::fill_n(new_string->neighbor_bits, NEIGHBOR_WORDS, 0ULL);
   new_string->libs = 0;
   new_string->color = static_cast<char>(color);
   new_string->origin = pos;
@@ -79,11 +79,11 @@ MakeString( game_info_t *game, const int pos, const int color )
   // 敵の連ならば, 隣接する連をお互いに追加する
   for (int i = 0; i < 4; i++) {
     if (board[neighbor4[i]] == S_EMPTY) {
-      lib_add = AddLiberty(new_string, neighbor4[i], lib_add);
+      AddLiberty(new_string, neighbor4[i]);
     } else if (board[neighbor4[i]] == other) {
       neighbor = string_id[neighbor4[i]];
-      AddNeighbor(&string[neighbor], id, 0);
-      AddNeighbor(&string[id], neighbor, 0);
+      AddNeighbor(&string[neighbor], id);
+      AddNeighbor(&string[id], neighbor);
     }
   }
 
@@ -157,7 +157,6 @@ AddStone( game_info_t *game, const int pos, const int color, const int id )
   string_t *add_str;
   char *board = game->board;
   int *string_id = game->string_id;
-  int lib_add = 0;
   int neighbor, neighbor4[4];
 
   // IDを更新
@@ -176,11 +175,11 @@ AddStone( game_info_t *game, const int pos, const int color, const int id )
   // 敵の石があれば隣接する敵連の情報を更新
   for (int i = 0; i < 4; i++) {
     if (board[neighbor4[i]] == S_EMPTY) {
-      lib_add = AddLiberty(add_str, neighbor4[i], lib_add);
+      AddLiberty(add_str, neighbor4[i]);
     } else if (board[neighbor4[i]] == other) {
       neighbor = string_id[neighbor4[i]];
-      AddNeighbor(&string[neighbor], id, 0);
-      AddNeighbor(&string[id], neighbor, 0);
+      AddNeighbor(&string[neighbor], id);
+      AddNeighbor(&string[id], neighbor);
     }
   }
 }
@@ -269,11 +268,8 @@ MergeString( game_info_t *game, string_t *dst, string_t *src[3], const int n )
     rm_id = string_id[src[i]->origin];
 
     // 呼吸点をマージ
-    prev = 0;
-    pos = src[i]->lib[0];
-    while (pos != LIBERTY_END) {
-      prev = AddLiberty(dst, pos, prev);
-      pos = src[i]->lib[pos];
+    for (int j = 0; j < LIBERTY_WORDS; j++) {
+      dst->lib_bits[j] |= src[i]->lib_bits[j];
     }
 
     // 連のIDを更新
@@ -288,19 +284,24 @@ MergeString( game_info_t *game, string_t *dst, string_t *src[3], const int n )
     }
 
     // 隣接する敵連の情報をマージ
-    prev = 0;
-    neighbor = src[i]->neighbor[0];
+    neighbor = FirstNeighbor(src[i]);
     while (neighbor != NEIGHBOR_END) {
+      RecordJournalString(game, neighbor);
       RemoveNeighborString(&string[neighbor], rm_id);
-      AddNeighbor(dst, neighbor, prev);
-      AddNeighbor(&string[neighbor], id, prev);
-      prev = neighbor;
-      neighbor = src[i]->neighbor[neighbor];
+      AddNeighbor(dst, neighbor);
+      AddNeighbor(&string[neighbor], id);
+      neighbor = NextNeighbor(src[i], neighbor);
     }
 
     // 使用済みフラグをオフ
     src[i]->flag = false;
   }
+
+  // 呼吸点の数を数え直す
+  dst->libs = 0;
+  for (int i = 0; i < LIBERTY_WORDS; i++) {
+    dst->libs += PopCount(dst->lib_bits[i]);
+  }
 }
 
 
@@ -309,40 +310,25 @@ MergeString( game_info_t *game, string_t *dst, string_t *src[3], const int n )
  * @brief Process to add a liberty.
  * @param[in, out] string String will be updated.
  * @param[in] pos Liberty coordinate.
- * @param[in] head Search index.
- * @return Liberty intersection. 
  * @~japanese
  * @brief 呼吸点の追加
  * @param[in, out] string 呼吸点を追加する対象の連
  * @param[in] pos 追加する呼吸点の座標
- * @param[in] head 探索対象の先頭のインデックス
- * @return 追加した呼吸点の座標
  */
-static int
-AddLiberty( string_t *string, const int pos, const int head )
+static void
+AddLiberty( string_t *string, const int pos )
 {
-  int lib;
+  const int index = onboard_index[pos];
+  const unsigned long long bit = 1ULL << (index & 63);
 
   // 既に追加されている場合は何もしない
-  if (string->lib[pos] != 0) return pos;
-
-  // 探索対象の先頭のインデックスを代入
-  lib = head;
-
-  // 追加する場所を見つけるまで進める
-  while (string->lib[lib] < pos) {
-    lib = string->lib[lib];
-  }
+  if (string->lib_bits[index >> 6] & bit) return;
 
   // 呼吸点の座標を追加する
-  string->lib[pos] = string->lib[lib];
-  string->lib[lib] = static_cast<short>(pos);
+  string->lib_bits[index >> 6] |= bit;
 
   // 呼吸点の数を1つ増やす
   string->libs++;
-
-  // 追加した呼吸点の座標を返す
-  return pos;
 }
 
 
@@ -361,26 +347,21 @@ AddLiberty( string_t *string, const int pos, const int head )
 void
 RemoveLiberty( game_info_t *game, string_t *string, const int pos )
 {
-  int lib = 0;
+  const int index = onboard_index[pos];
+  const unsigned long long bit = 1ULL << (index & 63);
 
   // 既に取り除かれている場合は何もしない
-  if (string->lib[pos] == 0) return;
-
-  // 取り除く呼吸点の座標を見つけるまで進める
-  while (string->lib[lib] != pos) {
-    lib = string->lib[lib];
-  }
+  if (!(string->lib_bits[index >> 6] & bit)) return;
 
   // 呼吸点の座標の情報を取り除く
-  string->lib[lib] = string->lib[string->lib[lib]];
-  string->lib[pos] = static_cast<short>(0);
+  string->lib_bits[index >> 6] &= ~bit;
 
   // 連の呼吸点の数を1つ減らす
   string->libs--;
 
   // 呼吸点が1つならば, その連の呼吸点を候補手に追加
   if (string->libs == 1) {
-    game->candidates[string->lib[0]] = true;
+    game->candidates[FirstLiberty(string)] = true;
   }
 }
 
@@ -402,19 +383,14 @@ RemoveLiberty( game_info_t *game, string_t *string, const int pos )
 void
 PoRemoveLiberty( game_info_t *game, string_t *string, const int pos, const int color )
 {
-  int lib = 0;
+  const int index = onboard_index[pos];
+  const unsigned long long bit = 1ULL << (index & 63);
 
   // 既に取り除かれている場合は何もしない
-  if (string->lib[pos] == 0) return;
-
-  // 取り除く呼吸点の座標を見つけるまで進める
-  while (string->lib[lib] != pos) {
-    lib = string->lib[lib];
-  }
+  if (!(string->lib_bits[index >> 6] & bit)) return;
 
   // 呼吸点の座標の情報を取り除く
-  string->lib[lib] = string->lib[string->lib[lib]];
-  string->lib[pos] = 0;
+  string->lib_bits[index >> 6] &= ~bit;
 
   // 呼吸点の数を1つ減らす
   string->libs--;
@@ -423,9 +399,10 @@ PoRemoveLiberty( game_info_t *game, string_t *string, const int pos, const int c
   // 呼吸点が1つならば, その呼吸点を候補手に戻して, レートの更新対象に加える
   // 呼吸点が2つならば, レートの更新対象に加える
   if (string->libs == 1) {
-    game->candidates[string->lib[0]] = true;
-    game->update_pos[color - 1][game->update_num[color - 1]++] = string->lib[0];
-    game->seki[string->lib[0]] = false;
+    const int lib = FirstLiberty(string);
+    game->candidates[lib] = true;
+    game->update_pos[color - 1][game->update_num[color - 1]++] = lib;
+    game->seki[lib] = false;
   }
 }
 
@@ -462,6 +439,8 @@ RemoveString( game_info_t *game, string_t *string, const int color )
   do {
     // 空点に戻す
     board[pos] = S_EMPTY;
+    ClearStoneBit(game, pos, string->color);
+    RecordJournalPosition(game, pos);
 
     // 候補手に追加する
     candidates[pos] = true;
@@ -477,10 +456,10 @@ RemoveString( game_info_t *game, string_t *string, const int color )
 
     // 上下左右を確認する
     // 隣接する連があれば呼吸点を追加する
-    if (str[string_id[NORTH(pos)]].flag) AddLiberty(&str[string_id[NORTH(pos)]], pos, 0);
-    if (str[string_id[ WEST(pos)]].flag) AddLiberty(&str[string_id[ WEST(pos)]], pos, 0);
-    if (str[string_id[ EAST(pos)]].flag) AddLiberty(&str[string_id[ EAST(pos)]], pos, 0);
-    if (str[string_id[SOUTH(pos)]].flag) AddLiberty(&str[string_id[SOUTH(pos)]], pos, 0);
+    if (str[string_id[NORTH(pos)]].flag) AddLiberty(&str[string_id[NORTH(pos)]], pos);
+    if (str[string_id[ WEST(pos)]].flag) AddLiberty(&str[string_id[ WEST(pos)]], pos);
+    if (str[string_id[ EAST(pos)]].flag) AddLiberty(&str[string_id[ EAST(pos)]], pos);
+    if (str[string_id[SOUTH(pos)]].flag) AddLiberty(&str[string_id[SOUTH(pos)]], pos);
 
     // 連を構成する次の石の座標を記録
     next = string_next[pos];
@@ -495,10 +474,12 @@ RemoveString( game_info_t *game, string_t *string, const int color )
   } while (pos != STRING_END);
 
   // 取り除いた連に隣接する連から隣接情報を取り除く
-  neighbor = string->neighbor[0];
+  RecordJournalString(game, rm_id);
+  neighbor = FirstNeighbor(string);
   while (neighbor != NEIGHBOR_END) {
+    RecordJournalString(game, neighbor);
     RemoveNeighborString(&str[neighbor], rm_id);
-    neighbor = string->neighbor[neighbor];
+    neighbor = NextNeighbor(string, neighbor);
   }
 
   capture_num += string->size;
@@ -542,22 +523,24 @@ PoRemoveString( game_info_t *game, string_t *string, const int color )
   int lib, head = 0;
 
   // 隣接する連の呼吸点を更新の対象に加える
-  neighbor = string->neighbor[0];
+  neighbor = FirstNeighbor(string);
   while (neighbor != NEIGHBOR_END) {
     if (str[neighbor].libs < 3) {
-      lib = str[neighbor].lib[0];
+      lib = FirstLiberty(&str[neighbor]);
       while (lib != LIBERTY_END) {
         update_pos[update_num++] = lib;
         game->seki[lib] = false;
-        lib = str[neighbor].lib[lib];
+        lib = NextLiberty(&str[neighbor], lib);
       }
     }
-    neighbor = string->neighbor[neighbor];
+    neighbor = NextNeighbor(string, neighbor);
   }
 
   do {
     // 空点に戻す
     board[pos] = S_EMPTY;
+    ClearStoneBit(game, pos, string->color);
+    RecordJournalPosition(game, pos);
     // 候補手に追加する
     candidates[pos] = true;
 
@@ -569,10 +552,10 @@ PoRemoveString( game_info_t *game, string_t *string, const int color )
 
     // 上下左右を確認する
     // 隣接する連があれば呼吸点を追加する
-    if (str[string_id[NORTH(pos)]].flag) AddLiberty(&str[string_id[NORTH(pos)]], pos, 0);
-    if (str[string_id[ WEST(pos)]].flag) AddLiberty(&str[string_id[ WEST(pos)]], pos, 0);
-    if (str[string_id[ EAST(pos)]].flag) AddLiberty(&str[string_id[ EAST(pos)]], pos, 0);
-    if (str[string_id[SOUTH(pos)]].flag) AddLiberty(&str[string_id[SOUTH(pos)]], pos, 0);
+    if (str[string_id[NORTH(pos)]].flag) AddLiberty(&str[string_id[NORTH(pos)]], pos);
+    if (str[string_id[ WEST(pos)]].flag) AddLiberty(&str[string_id[ WEST(pos)]], pos);
+    if (str[string_id[ EAST(pos)]].flag) AddLiberty(&str[string_id[ EAST(pos)]], pos);
+    if (str[string_id[SOUTH(pos)]].flag) AddLiberty(&str[string_id[SOUTH(pos)]], pos);
 
     // 連を構成する次の石の座標を記録
     next = string_next[pos];
@@ -587,10 +570,12 @@ PoRemoveString( game_info_t *game, string_t *string, const int color )
   } while (pos != STRING_END);
 
   // 取り除いた連に隣接する連から隣接情報を取り除く
-  neighbor = string->neighbor[0];
+  RecordJournalString(game, rm_id);
+  neighbor = FirstNeighbor(string);
   while (neighbor != NEIGHBOR_END) {
+    RecordJournalString(game, neighbor);
     RemoveNeighborString(&str[neighbor], rm_id);
-    neighbor = string->neighbor[neighbor];
+    neighbor = NextNeighbor(string, neighbor);
   }
 
   capture_num += string->size;
@@ -608,32 +593,21 @@ PoRemoveString( game_info_t *game, string_t *string, const int color )
  * @brief Add neighbor string ID with duplication check.
  * @param[in, out] string String must be updated.
  * @param[in] id Neighbor string ID.
- * @param[in] head Starting index.
  * @~japanese
  * @brief 隣接する連IDの追加(重複確認)
  * @param[in, out] string 隣接情報を追加する連
  * @param[in] id 追加する連ID
- * @param[in] head 開始点のインデックス
  */
 static void
-AddNeighbor( string_t *string, const int id, const int head )
+AddNeighbor( string_t *string, const int id )
 {
-  int neighbor = 0;
+  const unsigned long long bit = 1ULL << (id & 63);
 
   // 既に追加されている場合は何もしない
-  if (string->neighbor[id] != 0) return;
-
-  // 探索対象の先頭のインデックスを代入
-  neighbor = head;
-
-  // 追加場所を見つけるまで進める
-  while (string->neighbor[neighbor] < id) {
-    neighbor = string->neighbor[neighbor];
-  }
+  if (string->neighbor_bits[id >> 6] & bit) return;
 
   // 隣接する連IDを追加する
-  string->neighbor[id] = string->neighbor[neighbor];
-  string->neighbor[neighbor] = static_cast<short>(id);
+  string->neighbor_bits[id >> 6] |= bit;
 
   // 隣接する連の数を1つ増やす
   string->neighbors++;
@@ -653,19 +627,13 @@ AddNeighbor( string_t *string, const int id, const int head )
 static void
 RemoveNeighborString( string_t *string, const int id )
 {
-  int neighbor = 0;
+  const unsigned long long bit = 1ULL << (id & 63);
 
   // 既に除外されていれば何もしない
-  if (string->neighbor[id] == 0) return;
-
-  // 取り除く隣接する連IDを見つけるまで進める
-  while (string->neighbor[neighbor] != id) {
-    neighbor = string->neighbor[neighbor];
-  }
+  if (!(string->neighbor_bits[id >> 6] & bit)) return;
 
   // 隣接する連IDを取り除く
-  string->neighbor[neighbor] = string->neighbor[string->neighbor[neighbor]];
-  string->neighbor[id] = 0;
+  string->neighbor_bits[id >> 6] &= ~bit;
 
   // 隣接する連の数を1つ減らす
   string->neighbors--;
@@ -6,6 +6,7 @@
  * @~japanese
  * @brief モンテカルロ木探索用のハッシュ表
  */
+#include <atomic>
 #include <cstdlib>
 #include <iostream>
 #include <iterator>
@@ -54,15 +55,15 @@ node_hash_t *node_hash;
  * @~japanese
  * @brief ハッシュエントリの個数
  */
-static unsigned int used;
+static std::atomic<unsigned int> used;
 
 /**
  * @~english
- * @brief Oldest move in hash entries.
+ * @brief Current generation of hash entries (HASH_CLAIMING is not used, and 0 means an entry which has never been used).
  * @~japanese
- * @brief ハッシュ表にある最も古いデータが持つ手数
+ * @brief ハッシュ表の現在の世代 (HASH_CLAIMINGは使わず, 0は一度も使われていないエントリを表す)
  */
-static int oldest_move;
+static unsigned int hash_generation = 1;
 
 /**
  * @~english
@@ -86,7 +87,7 @@ unsigned int uct_hash_limit = UCT_HASH_SIZE * 9 / 10;
  * @~japanese
  * @brief ハッシュ表に余裕があるかどうかを表すフラグ
  */
-bool enough_size;
+std::atomic<bool> enough_size;
 
 
 /**
@@ -184,21 +185,24 @@ InitializeUctHash( void )
 {
   used = 0;
   enough_size = true;
-  oldest_move = 1;
+  hash_generation = 1;
   
   for (unsigned int i = 0; i < uct_hash_size; i++) {
-    node_hash[i].flag = false;
+    node_hash[i].generation = 0;
     node_hash[i].hash = 0;
     node_hash[i].color = 0;
+    node_hash[i].moves = 0;
   }
 }
 
 
 /**
  * @~english
- * @brief Clear hash table entries.
+ * @brief Clear hash table entries. All entries become stale by advancing the generation,
+ * and entries of the previous generation can be kept by RetainHashIndex.
  * @~japanese
  * @brief ハッシュ表のクリア
+ * 世代を進めて全エントリを古くする (前の世代のエントリはRetainHashIndexで残せる)
  */
 void
 ClearUctHash( void )
@@ -206,81 +210,66 @@ ClearUctHash( void )
   used = 0;
   enough_size = true;
 
-  for (unsigned int i = 0; i < uct_hash_size; i++) {
-    node_hash[i].flag = false;
-    node_hash[i].hash = 0;
-    node_hash[i].color = 0;
-    node_hash[i].moves = 0;
+  // 世代番号が一周する時だけ, 前の世代を1, それ以外を0に振り直す
+  if (hash_generation + 1 == HASH_CLAIMING) {
+    for (unsigned int i = 0; i < uct_hash_size; i++) {
+      node_hash[i].generation = (node_hash[i].generation == hash_generation) ? 1 : 0;
+    }
+    hash_generation = 1;
   }
+
+  hash_generation++;
 }
 
 
 /**
  * @~english
- * @brief Clear all not descendent nodes.
- * @param[in] indexes Indexes of not descendent nodes.
+ * @brief Keep an entry of the previous generation in the current generation.
+ * It can be called from multiple threads, and only one of them succeeds for each entry.
+ * @param[in] index Index of the entry.
+ * @return Whether the entry is kept by this call.
  * @~japanese
- * @brief 現局面の子孫ではないノードの削除
- * @param[in] indexes 子孫ではないノードのインデックス
+ * @brief 前の世代のエントリを現在の世代に残す
+ * 複数のスレッドから呼び出せて, 1つのエントリにつき1回だけ成功する
+ * @param[in] index エントリのインデックス
+ * @return この呼び出しで残したらtrue
  */
-void
-ClearNotDescendentNodes( std::vector<int> &indexes )
+bool
+RetainHashIndex( const unsigned int index )
 {
-  auto iter = indexes.begin();
-
-  for (int i = 0; i < (int)uct_hash_size; i++) {
-    if (*iter == i) {
-      iter++;
-    } else if (node_hash[i].flag) {
-      node_hash[i].flag = false;
-      node_hash[i].hash = 0;
-      node_hash[i].color = 0;
-      node_hash[i].moves = 0;
-      used--;
-    }
-  }
+  unsigned int expected = hash_generation - 1;
 
-  enough_size = true;
+  if (node_hash[index].generation.compare_exchange_strong(expected, hash_generation)) {
+    used++;
+    return true;
+  } else {
+    return false;
+  }
 }
 
 
 /**
  * @~english
- * @brief Delete old hash entries.
- * @param[in] game Board position data.
+ * @brief Finish keeping entries of the previous generation.
  * @~japanese
- * @brief 古いエントリーを削除
- * @param[in] game 局面情報
+ * @brief 前の世代のエントリを残し終えた時の処理
  */
 void
-DeleteOldHash( const game_info_t *game )
+FinishRetainingHash( void )
 {
-  while (oldest_move < game->moves) {
-    for (unsigned int i = 0; i < uct_hash_size; i++) {
-      if (node_hash[i].flag && node_hash[i].moves == oldest_move) {
-        node_hash[i].flag = false;
-        node_hash[i].hash = 0;
-        node_hash[i].color = 0;
-        node_hash[i].moves = 0;
-        used--;
-      }
-    }
-    oldest_move++;
-  }
-
-  enough_size = true;
+  enough_size = (used <= uct_hash_limit);
 }
 
 
 /**
  * @~english
- * @brief Search empty index on hash table.
+ * @brief Search empty index on hash table. It can be called from multiple threads.
  * @param[in] hash Hash value of current position.
  * @param[in] color Player's color.
  * @param[in] moves The number of move count.
  * @return Unused hash table's index.
  * @~japanese
- * @brief 未使用のインデックスを探して返す
+ * @brief 未使用のインデックスを探して返す (複数のスレッドから呼び出せる)
  * @param[in] hash 現局面のハッシュ値
  * @param[in] color 手番の色
  * @param[in] moves 着手数
@@ -293,13 +282,14 @@ SearchEmptyIndex( const unsigned long long hash, const int color, const int move
   unsigned int i = key;
 
   do {
-    if (!node_hash[i].flag) {
-      node_hash[i].flag = true;
-      node_hash[i].hash = hash;
+    unsigned int expected = node_hash[i].generation.load(std::memory_order_acquire);
+    // 複数のスレッドが同じエントリを取らないように, 古い世代から確保中に書き換えられた時だけ使う
+    if (expected != hash_generation && expected != HASH_CLAIMING &&
+        node_hash[i].generation.compare_exchange_strong(expected, HASH_CLAIMING)) {
       node_hash[i].moves = moves;
       node_hash[i].color = color;
-      used++;
-      if (used > uct_hash_limit) enough_size = false;
+      node_hash[i].hash.store(hash, std::memory_order_relaxed);
+      if (++used > uct_hash_limit) enough_size = false;
       return i;
     }
     i++;
@@ -312,13 +302,30 @@ SearchEmptyIndex( const unsigned long long hash, const int color, const int move
 
 /**
  * @~english
- * @brief Search element which has same hash value.
+ * @brief Make a claimed entry visible to other threads. The caller must reset data
+ * left by the previous generation before it.
+ * @param[in] index Index returned by SearchEmptyIndex.
+ * @~japanese
+ * @brief 確保したエントリを他のスレッドから引けるようにする
+ * 前の世代が残したデータは呼び出し側がこれより前に初期化しておく
+ * @param[in] index SearchEmptyIndexが返したインデックス
+ */
+void
+PublishHashIndex( const unsigned int index )
+{
+  node_hash[index].generation.store(hash_generation, std::memory_order_release);
+}
+
+
+/**
+ * @~english
+ * @brief Search element which has same hash value. It can be called while other threads add entries.
  * @param[in] hash Hash value of current position.
  * @param[in] color Player's color.
  * @param[in] moves The number of move count.
  * @return Index on hash table.
  * @~japanese
- * @brief ハッシュ値に対応するインデックスを返す
+ * @brief ハッシュ値に対応するインデックスを返す (他のスレッドがエントリを追加中でも呼び出せる)
  * @param[in] hash 局面のハッシュ値
  * @param[in] color 手番の色
  * @param[in] moves 着手数
@@ -331,12 +338,16 @@ FindSameHashIndex( const unsigned long long hash, const int color, const int mov
   unsigned int i = key;
 
   do {
-    if (!node_hash[i].flag) {
+    const unsigned int generation = node_hash[i].generation.load(std::memory_order_acquire);
+    // 確保中のエントリは飛ばして探し続ける
+    if (generation == hash_generation) {
+      if (node_hash[i].hash.load(std::memory_order_relaxed) == hash &&
+          node_hash[i].color == color &&
+          node_hash[i].moves == moves) {
+        return i;
+      }
+    } else if (generation != HASH_CLAIMING) {
       return uct_hash_size;
-    } else if (node_hash[i].hash == hash &&
-               node_hash[i].color == color &&
-               node_hash[i].moves == moves) {
-      return i;
     }
     i++;
     if (i >= uct_hash_size) i = 0;
@@ -360,3 +371,34 @@ CheckRemainingHashSize( void )
   return enough_size;
 }
 
+
+/**
+ * @~english
+ * @brief Check whether an entry is used in the current generation.
+ * @param[in] index Index of the entry.
+ * @return Check result.
+ * @~japanese
+ * @brief エントリが現在の世代で使用中か判定
+ * @param[in] index エントリのインデックス
+ * @return 判定結果
+ */
+bool
+IsUsedHashIndex( const unsigned int index )
+{
+  return node_hash[index].generation == hash_generation;
+}
+
+
+/**
+ * @~english
+ * @brief Get the number of used entries.
+ * @return The number of used entries.
+ * @~japanese
+ * @brief 使用中のエントリの数の取得
+ * @return 使用中のエントリの数
+ */
+unsigned int
+GetUsedHashSize( void )
+{
+  return used;
+}
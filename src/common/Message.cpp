@@ -17,6 +17,7 @@
 
 
 #include "board/Point.hpp"
+#include "board/String.hpp"
 #include "common/Message.hpp"
 #include "mcts/UctSearch.hpp"
 
@@ -121,13 +122,13 @@ PrintString( const game_info_t *game )
         std::cerr << "White String   ";
       }
       std::cerr << "ID : " << i << " (libs : " << string[i].libs << ", size : " << string[i].size << ")" << std::endl;
-      pos = string[i].lib[0];
+      pos = FirstLiberty(&string[i]);
 
       std::cerr << "  Liberty : " << std::endl;
       std::cerr << "  ";
       while (pos != STRING_END) {
         std::cerr << GOGUI_X(pos) << GOGUI_Y(pos) << " ";
-        pos = string[i].lib[pos];
+        pos = NextLiberty(&string[i], pos);
       }
       std::cerr << std::endl;
 
@@ -141,13 +142,13 @@ PrintString( const game_info_t *game )
       }
       std::cerr << std::endl;
 
-      neighbor = string[i].neighbor[0];
+      neighbor = FirstNeighbor(&string[i]);
       if (neighbor == 0) getchar();
       std::cerr << "  Neighbor : " << std::endl;
       std::cerr << "    ";
       while (neighbor < NEIGHBOR_END) {
         std::cerr << neighbor << " ";
-        neighbor = string[i].neighbor[neighbor];
+        neighbor = NextNeighbor(&string[i], neighbor);
       }
       std::cerr << std::endl;
     }
@@ -367,7 +368,7 @@ PrintBestSequence( const game_info_t *game, const uct_node_t *uct_node, const in
 
   current = uct_child[index].index;
   
-  while (current != NOT_EXPANDED) {
+  while (IsExpandedIndex(current)) {
     uct_child = uct_node[current].child;
     child_num = uct_node[current].child_num;
 
@@ -530,6 +531,69 @@ PrintReuseCount( const int count )
 }
 
 
+/**
+ * @~english
+ * @brief Print playout speed of a NUMA node.
+ * @param[in] node Index of the NUMA node.
+ * @param[in] thread_num The number of search threads on the NUMA node.
+ * @param[in] po_speed Playout speed of the NUMA node.
+ * @~japanese
+ * @brief NUMAノードの探索速度の出力
+ * @param[in] node NUMAノードの番号
+ * @param[in] thread_num NUMAノードで動かした探索スレッド数
+ * @param[in] po_speed NUMAノードの探索速度
+ */
+void
+PrintNodePlayoutSpeed( const int node, const int thread_num, const int po_speed )
+{
+  if (!debug_message) return ;
+
+  std::cerr << "NUMA node " << node << " (" << thread_num << " threads) : " << po_speed << " PO/s" << std::endl;
+}
+
+
+/**
+ * @~english
+ * @brief Print the number of nodes before and after reusing the search tree, and the time spent.
+ * @param[in] before The number of nodes before reusing the search tree.
+ * @param[in] after The number of reused nodes.
+ * @param[in] time Time spent.
+ * @~japanese
+ * @brief 探索木の再利用前後のノード数とかかった時間の出力
+ * @param[in] before 再利用前のノード数
+ * @param[in] after 再利用したノード数
+ * @param[in] time かかった時間
+ */
+void
+PrintTreeRetention( const int before, const int after, const double time )
+{
+  if (!debug_message) return ;
+
+  std::cerr << "Reuse tree : " << before << " -> " << after << " Nodes (" << time << " Sec)" << std::endl;
+}
+
+
+/**
+ * @~english
+ * @brief Print the number of nodes before and after garbage collection during search, and the time spent.
+ * @param[in] before The number of nodes before garbage collection.
+ * @param[in] after The number of nodes after garbage collection.
+ * @param[in] time Time spent.
+ * @~japanese
+ * @brief 探索中のノードの回収前後のノード数とかかった時間の出力
+ * @param[in] before 回収前のノード数
+ * @param[in] after 回収後のノード数
+ * @param[in] time かかった時間
+ */
+void
+PrintGarbageCollection( const int before, const int after, const double time )
+{
+  if (!debug_message) return ;
+
+  std::cerr << "Garbage collection : " << before << " -> " << after << " Nodes (" << time << " Sec)" << std::endl;
+}
+
+
 /**
  * @~english
  * @brief Print too large resign threshold message.
@@ -639,7 +703,7 @@ PrintLeelaZeroAnalyze( const uct_node_t *root )
     int child_num;
     const child_node_t *uct_child;
 
-    while (current != NOT_EXPANDED) {
+    while (IsExpandedIndex(current)) {
       uct_child = uct_node[current].child;
       child_num = uct_node[current].child_num;
 
@@ -689,7 +753,11 @@ PrintRate( const game_info_t *game, const int color )
   oss << "Sum : " << game->sum_rate[color - 1] << "\n";
 
   for (int y = board_start; y <= board_end; y++) {
-    oss << std::setw(6) << game->sum_rate_row[color - 1][y] << " | ";
+    long long sum_rate_row = 0;
+    for (int x = board_start; x <= board_end; x++) {
+      sum_rate_row += game->rate[color - 1][POS(x, y)];
+    }
+    oss << std::setw(6) << sum_rate_row << " | ";
     for (int x = board_start; x <= board_end; x++) {
       const int pos = POS(x, y);
       oss << std::setw(5) << game->rate[color - 1][pos] << " ";
@@ -6,11 +6,16 @@
  * @~japanese
  * @brief シチョウの確認
  */
+#include <algorithm>
 #include <iostream>
 #include <memory>
+#include <mutex>
 
+#include "board/BitBoard.hpp"
 #include "board/Point.hpp"
 #include "board/SearchBoard.hpp"
+#include "board/String.hpp"
+#include "board/ZobristHash.hpp"
 #include "common/Message.hpp"
 #include "feature/Ladder.hpp"
 
@@ -31,9 +36,145 @@ constexpr bool ALIVE = true;
  */
 constexpr bool DEAD = false;
 
+/**
+ * @~english
+ * @brief Maximum depth of ladder search.
+ * @~japanese
+ * @brief シチョウ探索の最大の深さ
+ */
+constexpr int LADDER_DEPTH_MAX = 100;
+
+/**
+ * @~english
+ * @brief The number of sets of the ladder cache.
+ * @~japanese
+ * @brief シチョウの探索結果のキャッシュの組の数
+ */
+constexpr int LADDER_CACHE_SETS = 1 << 14;
+
+/**
+ * @~english
+ * @brief The number of entries in a set of the ladder cache.
+ * @~japanese
+ * @brief シチョウの探索結果のキャッシュの1組のエントリ数
+ */
+constexpr int LADDER_CACHE_WAYS = 4;
+
+/**
+ * @~english
+ * @brief The number of locks for the ladder cache.
+ * @~japanese
+ * @brief シチョウの探索結果のキャッシュのロックの数
+ */
+constexpr int LADDER_CACHE_LOCKS = 256;
+
+
+/**
+ * @~english
+ * @brief Entry of the ladder cache. A ladder search only reads intersections in the area,
+ * so the result is valid while stones in the area are unchanged.
+ * @~japanese
+ * @brief シチョウの探索結果のキャッシュのエントリ
+ * シチョウ探索は領域内の交点しか参照しないので, 領域内の石が変わらない限り結果は変わらない
+ */
+struct ladder_cache_entry_t {
+  /**
+   * @~english
+   * @brief Hash value of stones in the area.
+   * @~japanese
+   * @brief 領域内の石の配置のハッシュ値
+   */
+  unsigned long long hash;
+
+  /**
+   * @~english
+   * @brief Area read by the search, indexed by onboard_index.
+   * @~japanese
+   * @brief 探索で参照した領域 (onboard_indexで指定)
+   */
+  unsigned long long area[BITBOARD_WORDS];
+
+  /**
+   * @~english
+   * @brief Board size.
+   * @~japanese
+   * @brief 盤の大きさ
+   */
+  int size;
+
+  /**
+   * @~english
+   * @brief First move of the escaping player.
+   * @~japanese
+   * @brief 逃げる側の最初の着手
+   */
+  int pos;
+
+  /**
+   * @~english
+   * @brief Coordinate of the escaping string.
+   * @~japanese
+   * @brief 逃げる連の座標
+   */
+  int ren_xy;
+
+  /**
+   * @~english
+   * @brief Color of the escaping player.
+   * @~japanese
+   * @brief 逃げる側の色
+   */
+  int color;
+
+  /**
+   * @~english
+   * @brief Coordinate where a stone can not be put by the ko rule, or 0 if there is no ko.
+   * @~japanese
+   * @brief 劫で着手できない座標 (劫がなければ0)
+   */
+  int ko_pos;
+
+  /**
+   * @~english
+   * @brief Search result.
+   * @~japanese
+   * @brief 探索結果
+   */
+  bool result;
+};
+
+
+/**
+ * @~english
+ * @brief Ladder cache shared by all threads.
+ * @~japanese
+ * @brief 全てのスレッドで共有するシチョウの探索結果のキャッシュ
+ */
+static ladder_cache_entry_t ladder_cache[LADDER_CACHE_SETS][LADDER_CACHE_WAYS];
+
+/**
+ * @~english
+ * @brief Locks for the ladder cache.
+ * @~japanese
+ * @brief シチョウの探索結果のキャッシュのロック
+ */
+static std::mutex mutex_ladder_cache[LADDER_CACHE_LOCKS];
+
 
 // シチョウ探索
-static bool IsLadderCaptured( const int depth, search_game_info_t *game, const int ren_xy, const int turn_color );
+static bool IsLadderCaptured( const int depth, search_game_info_t *game, const int ren_xy, const int turn_color, unsigned long long played[] );
+
+// 着手してからのシチョウ探索 (キャッシュを使う)
+static bool IsLadderCapturedAfterMove( const game_info_t *game, std::unique_ptr<search_game_info_t> &search_game, const int pos, const int color, const int ren_xy );
+
+// シチョウ探索で参照する領域の計算
+static void GetLadderArea( const game_info_t *game, const int ren_xy, const unsigned long long played[], unsigned long long area[] );
+
+// 領域内の石の配置のハッシュ値の計算
+static unsigned long long GetAreaHash( const game_info_t *game, const unsigned long long area[] );
+
+// 座標をビットボードに追加
+static void AddAreaPoint( unsigned long long area[], const int pos );
 
 
 /**
@@ -61,43 +202,36 @@ LadderExtension( game_info_t *game, int color, bool *ladder_pos )
       continue;
     }
     // アタリから逃げる着手箇所
-    int ladder = string[i].lib[0];
+    int ladder = FirstLiberty(&string[i]);
 
     bool flag = false;
 
     // アタリを逃げる手で未探索のものを確認
     if (!checked[ladder] && string[i].libs == 1) {
-      if (!search_game)
-        search_game.reset(new search_game_info_t(game));
-      search_game_info_t *ladder_game = search_game.get();
       // 隣接する敵連を取って助かるかを確認
-      int neighbor = string[i].neighbor[0];
+      int neighbor = FirstNeighbor(&string[i]);
       while (neighbor != NEIGHBOR_END && !flag) {
         if (string[neighbor].libs == 1) {
-          if (IsLegal(game, string[neighbor].lib[0], color)) {
-            PutStoneForSearch(ladder_game, string[neighbor].lib[0], color);
-            if (IsLadderCaptured(0, ladder_game, string[i].origin, GetOppositeColor(color)) == DEAD) {
+          const int capture = FirstLiberty(&string[neighbor]);
+          if (IsLegal(game, capture, color)) {
+            if (IsLadderCapturedAfterMove(game, search_game, capture, color, string[i].origin) == DEAD) {
               if (string[i].size >= 2) {
-                ladder_pos[string[neighbor].lib[0]] = true;
+                ladder_pos[capture] = true;
               }
             } else {
               flag = true;
             }
-            Undo(ladder_game);
           }
         }
-        neighbor = string[i].neighbor[neighbor];
+        neighbor = NextNeighbor(&string[i], neighbor);
       }
 
       // 取って助からない時は逃げてみる
       if (!flag) {
-        if (IsLegal(game, ladder, color)) {
-          PutStoneForSearch(ladder_game, ladder, color);
-          if (string[i].size >= 2 &&
-              IsLadderCaptured(0, ladder_game, ladder, GetOppositeColor(color)) == DEAD) {
-            ladder_pos[ladder] = true;
-          }
-          Undo(ladder_game);
+        if (string[i].size >= 2 &&
+            IsLegal(game, ladder, color) &&
+            IsLadderCapturedAfterMove(game, search_game, ladder, color, ladder) == DEAD) {
+          ladder_pos[ladder] = true;
         }
       }
       checked[ladder] = true;
@@ -106,6 +240,213 @@ LadderExtension( game_info_t *game, int color, bool *ladder_pos )
 }
 
 
+/**
+ * @~english
+ * @brief Ladder search after a move of the escaping player. The result is shared by all threads
+ * through the ladder cache, and it is reused while stones in the area read by the search and the ko are unchanged.
+ * The cache is not used with positional superko because legality depends on the game history.
+ * @param[in] game Board position data.
+ * @param[in, out] search_game Fast board position data. It is allocated if necessary.
+ * @param[in] pos First move of the escaping player.
+ * @param[in] color Color of the escaping player.
+ * @param[in] ren_xy Coordinate of the escaping string.
+ * @return Ladder capturable flag.
+ * @~japanese
+ * @brief 逃げる側が着手してからのシチョウ探索
+ * 探索結果は全てのスレッドでキャッシュを共有し, 探索で参照した領域の石と劫が変わらない限り使い回す
+ * 超劫を考慮する時は合法手の判定が棋譜に依存するのでキャッシュを使わない
+ * @param[in] game 局面情報
+ * @param[in, out] search_game 高速な局面情報 (必要になった時に確保する)
+ * @param[in] pos 逃げる側の最初の着手
+ * @param[in] color 逃げる側の色
+ * @param[in] ren_xy 逃げる連の座標
+ * @return シチョウで取られるか否かのフラグ
+ */
+static bool
+IsLadderCapturedAfterMove( const game_info_t *game, std::unique_ptr<search_game_info_t> &search_game, const int pos, const int color, const int ren_xy )
+{
+  const bool use_cache = !GetSuperKo() && game->moves + LADDER_DEPTH_MAX + 2 < MAX_RECORDS;
+  const int ko_pos = (game->ko_move == game->moves - 1) ? game->ko_pos : 0;
+  const unsigned long long key = ((static_cast<unsigned long long>(pos) * BOARD_MAX + ren_xy) * S_MAX + color) * BOARD_MAX + ko_pos;
+  const int set = static_cast<int>((key * 0x9E3779B97F4A7C15ULL) >> 32) & (LADDER_CACHE_SETS - 1);
+  unsigned long long played[BITBOARD_WORDS] = { 0 }, area[BITBOARD_WORDS];
+
+  // 同じ着手と連と劫で, 参照した領域の石が変わっていない探索結果があればそれを返す
+  if (use_cache) {
+    std::lock_guard<std::mutex> lock(mutex_ladder_cache[set % LADDER_CACHE_LOCKS]);
+    for (const ladder_cache_entry_t &entry : ladder_cache[set]) {
+      if (entry.size == pure_board_size &&
+          entry.pos == pos &&
+          entry.ren_xy == ren_xy &&
+          entry.color == color &&
+          entry.ko_pos == ko_pos &&
+          entry.hash == GetAreaHash(game, entry.area)) {
+        return entry.result;
+      }
+    }
+  }
+
+  if (!search_game) {
+    search_game.reset(new search_game_info_t(game));
+  }
+
+  AddAreaPoint(played, pos);
+  PutStoneForSearch(search_game.get(), pos, color);
+  const bool result = IsLadderCaptured(0, search_game.get(), ren_xy, GetOppositeColor(color), played);
+  Undo(search_game.get());
+
+  if (use_cache) {
+    GetLadderArea(game, ren_xy, played, area);
+    const unsigned long long hash = GetAreaHash(game, area);
+    std::lock_guard<std::mutex> lock(mutex_ladder_cache[set % LADDER_CACHE_LOCKS]);
+    ladder_cache_entry_t &entry = ladder_cache[set][hash % LADDER_CACHE_WAYS];
+    entry.hash = hash;
+    std::copy_n(area, BITBOARD_WORDS, entry.area);
+    entry.size = pure_board_size;
+    entry.pos = pos;
+    entry.ren_xy = ren_xy;
+    entry.color = color;
+    entry.ko_pos = ko_pos;
+    entry.result = result;
+  }
+
+  return result;
+}
+
+
+/**
+ * @~english
+ * @brief Calculate the area read by a ladder search.
+ * The search reads the strings next to the played intersections, their neighbor strings,
+ * and the intersections around the stones of them.
+ * @param[in] game Board position data before the search.
+ * @param[in] ren_xy Coordinate of the escaping string.
+ * @param[in] played Intersections played in the search.
+ * @param[out] area Area read by the search.
+ * @~japanese
+ * @brief シチョウ探索で参照する領域の計算
+ * 探索は着手した交点に接する連とその敵連, それらの石の上下左右しか参照しない
+ * @param[in] game 探索前の局面情報
+ * @param[in] ren_xy 逃げる連の座標
+ * @param[in] played 探索で着手した交点
+ * @param[out] area 探索で参照する領域
+ */
+static void
+GetLadderArea( const game_info_t *game, const int ren_xy, const unsigned long long played[], unsigned long long area[] )
+{
+  const char *board = game->board;
+  const string_t *string = game->string;
+  const int *string_id = game->string_id;
+  const int *string_next = game->string_next;
+  bool added[MAX_STRING] = { false };
+  int id[MAX_STRING], id_num = 0;
+  int neighbor4[4];
+
+  std::copy_n(played, BITBOARD_WORDS, area);
+
+  // 着手した交点の上下左右と, そこにある連
+  for (int i = 0; i < bitboard_words; i++) {
+    unsigned long long rest = played[i];
+    while (rest != 0) {
+      GetNeighbor4(neighbor4, onboard_pos[(i << 6) + LowestBit(rest)]);
+      rest &= rest - 1;
+      for (int j = 0; j < 4; j++) {
+        if (board[neighbor4[j]] == S_OB) continue;
+        AddAreaPoint(area, neighbor4[j]);
+        if (board[neighbor4[j]] != S_EMPTY && !added[string_id[neighbor4[j]]]) {
+          added[string_id[neighbor4[j]]] = true;
+          id[id_num++] = string_id[neighbor4[j]];
+        }
+      }
+    }
+  }
+
+  // 逃げる連
+  if (board[ren_xy] != S_EMPTY && !added[string_id[ren_xy]]) {
+    added[string_id[ren_xy]] = true;
+    id[id_num++] = string_id[ren_xy];
+  }
+
+  // それらの連に隣接する敵連
+  const int adjacent_num = id_num;
+  for (int i = 0; i < adjacent_num; i++) {
+    int neighbor = FirstNeighbor(&string[id[i]]);
+    while (neighbor != NEIGHBOR_END) {
+      if (!added[neighbor]) {
+        added[neighbor] = true;
+        id[id_num++] = neighbor;
+      }
+      neighbor = NextNeighbor(&string[id[i]], neighbor);
+    }
+  }
+
+  // 連の石と上下左右 (呼吸点の数と位置が決まる)
+  for (int i = 0; i < id_num; i++) {
+    int pos = string[id[i]].origin;
+    while (pos != STRING_END) {
+      AddAreaPoint(area, pos);
+      GetNeighbor4(neighbor4, pos);
+      for (int j = 0; j < 4; j++) {
+        if (board[neighbor4[j]] != S_OB) {
+          AddAreaPoint(area, neighbor4[j]);
+        }
+      }
+      pos = string_next[pos];
+    }
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Calculate hash value of stones in the area.
+ * @param[in] game Board position data.
+ * @param[in] area Area.
+ * @return Hash value.
+ * @~japanese
+ * @brief 領域内の石の配置のハッシュ値の計算
+ * @param[in] game 局面情報
+ * @param[in] area 領域
+ * @return ハッシュ値
+ */
+static unsigned long long
+GetAreaHash( const game_info_t *game, const unsigned long long area[] )
+{
+  unsigned long long hash = 0;
+
+  for (int i = 0; i < bitboard_words; i++) {
+    unsigned long long rest = area[i];
+    while (rest != 0) {
+      const int pos = onboard_pos[(i << 6) + LowestBit(rest)];
+      rest &= rest - 1;
+      if (game->board[pos] != S_EMPTY) {
+        hash ^= hash_bit[pos][static_cast<int>(game->board[pos])];
+      }
+    }
+  }
+
+  return hash;
+}
+
+
+/**
+ * @~english
+ * @brief Add an intersection to a bitboard.
+ * @param[in, out] area Bitboard.
+ * @param[in] pos Coordinate.
+ * @~japanese
+ * @brief 座標をビットボードに追加
+ * @param[in, out] area ビットボード
+ * @param[in] pos 座標
+ */
+static void
+AddAreaPoint( unsigned long long area[], const int pos )
+{
+  const int index = onboard_index[pos];
+  area[index >> 6] |= 1ULL << (index & 63);
+}
+
+
 /**
  * @~english
  * @brief Ladder search.
@@ -113,6 +454,7 @@ LadderExtension( game_info_t *game, int color, bool *ladder_pos )
  * @param[in] game Fast board position data.
  * @param[in] ren_xy String coordinate.
  * @param[in] turn_color Player's color.
+ * @param[in, out] played Intersections played in the search.
  * @return Ladder capturable flag.
  * @~japanese
  * @brief シチョウ探索
@@ -120,10 +462,11 @@ LadderExtension( game_info_t *game, int color, bool *ladder_pos )
  * @param[in] game 局面情報
  * @param[in] ren_xy 逃げる連の座標
  * @param[in] turn_color 手番の色
+ * @param[in, out] played 探索で着手した交点
  * @return シチョウで取られるか否かのフラグ
  */
 static bool
-IsLadderCaptured( const int depth, search_game_info_t *game, const int ren_xy, const int turn_color )
+IsLadderCaptured( const int depth, search_game_info_t *game, const int ren_xy, const int turn_color, unsigned long long played[] )
 {
   const char *board = game->board;
   const string_t *string = game->string;
@@ -131,7 +474,7 @@ IsLadderCaptured( const int depth, search_game_info_t *game, const int ren_xy, c
   int escape_color, capture_color, escape_xy, capture_xy, neighbor;
   bool result;
   
-  if (depth >= 100 || game->moves >= MAX_RECORDS - 1) {
+  if (depth >= LADDER_DEPTH_MAX || game->moves >= MAX_RECORDS - 1) {
     return ALIVE;
   }
 
@@ -147,33 +490,35 @@ IsLadderCaptured( const int depth, search_game_info_t *game, const int ren_xy, c
   if (turn_color == escape_color) {
     // 周囲の敵連が取れるか確認し,
     // 取れるなら取って探索を続ける
-    neighbor = string[str].neighbor[0];
+    neighbor = FirstNeighbor(&string[str]);
     while (neighbor != NEIGHBOR_END) {
       if (string[neighbor].libs == 1) {
-        if (IsLegalForSearch(game, string[neighbor].lib[0], escape_color)) {
-          PutStoneForSearch(game, string[neighbor].lib[0], escape_color);
-          result = IsLadderCaptured(depth + 1, game, ren_xy, GetOppositeColor(turn_color));
+        AddAreaPoint(played, FirstLiberty(&string[neighbor]));
+        if (IsLegalForSearch(game, FirstLiberty(&string[neighbor]), escape_color)) {
+          PutStoneForSearch(game, FirstLiberty(&string[neighbor]), escape_color);
+          result = IsLadderCaptured(depth + 1, game, ren_xy, GetOppositeColor(turn_color), played);
           Undo(game);
           if (result == ALIVE) {
             return ALIVE;
           }
         }
       }
-      neighbor = string[str].neighbor[neighbor];
+      neighbor = NextNeighbor(&string[str], neighbor);
     }
     
     // 逃げる手を打ってみて探索を続ける
-    escape_xy = string[str].lib[0];
+    escape_xy = FirstLiberty(&string[str]);
     while (escape_xy != LIBERTY_END) {
+      AddAreaPoint(played, escape_xy);
       if (IsLegalForSearch(game, escape_xy, escape_color)) {
         PutStoneForSearch(game, escape_xy, escape_color);
-        result = IsLadderCaptured(depth + 1, game, ren_xy, GetOppositeColor(turn_color));
+        result = IsLadderCaptured(depth + 1, game, ren_xy, GetOppositeColor(turn_color), played);
         Undo(game);
         if (result == ALIVE) {
           return ALIVE;
         }
       }
-      escape_xy = string[str].lib[escape_xy];
+      escape_xy = NextLiberty(&string[str], escape_xy);
     }
     return DEAD;
   } else {
@@ -181,17 +526,18 @@ IsLadderCaptured( const int depth, search_game_info_t *game, const int ren_xy, c
       return DEAD;
     }
     // 追いかける側なのでアタリにする手を打ってみる
-    capture_xy = string[str].lib[0];
+    capture_xy = FirstLiberty(&string[str]);
     while (capture_xy != LIBERTY_END) {
+      AddAreaPoint(played, capture_xy);
       if (IsLegalForSearch(game, capture_xy, capture_color)) {
         PutStoneForSearch(game, capture_xy, capture_color);
-        result = IsLadderCaptured(depth + 1, game, ren_xy, GetOppositeColor(turn_color));
+        result = IsLadderCaptured(depth + 1, game, ren_xy, GetOppositeColor(turn_color), played);
         Undo(game);
         if (result == DEAD) {
           return DEAD;
         }
       }
-      capture_xy = string[str].lib[capture_xy];
+      capture_xy = NextLiberty(&string[str], capture_xy);
     }
   }
 
@@ -225,16 +571,14 @@ CheckLadderExtension( const game_info_t *game, const int color, const int pos )
   }
 
   const int id = string_id[pos];
-  const int ladder = string[id].lib[0];
+  const int ladder = FirstLiberty(&string[id]);
 
   if (string[id].libs == 1 &&
       IsLegal(game, ladder, color)) {
-    std::unique_ptr<search_game_info_t> search_game(new search_game_info_t(game));
-    search_game_info_t *ladder_game = search_game.get();
-    PutStoneForSearch(ladder_game, ladder, color);
-    if (IsLadderCaptured(0, ladder_game, ladder, GetOppositeColor(color)) == DEAD) {
+    std::unique_ptr<search_game_info_t> search_game;
+    if (IsLadderCapturedAfterMove(game, search_game, ladder, color, ladder) == DEAD) {
       return true;
-    } 
+    }
   }
 
   return false;
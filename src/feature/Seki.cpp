@@ -10,10 +10,34 @@
 
 #include "board/GoBoard.hpp"
 #include "board/Point.hpp"
+#include "board/String.hpp"
 #include "feature/Seki.hpp"
 #include "feature/Semeai.hpp"
 
 
+// 双方にとって自己アタリになる座標か判定
+static bool IsSekiPoint( const game_info_t *game, const int pos );
+
+
+/**
+ * @~english
+ * @brief Check whether a point is self atari for both players.
+ * @param[in] game Current board position.
+ * @param[in] pos Coordinate.
+ * @return Check result.
+ * @~japanese
+ * @brief 双方にとって自己アタリになる座標か判定
+ * @param[in] game 現在の局面情報
+ * @param[in] pos 確認する座標
+ * @return 判定結果
+ */
+static bool
+IsSekiPoint( const game_info_t *game, const int pos )
+{
+  return IsSelfAtari(game, S_BLACK, pos) && IsSelfAtari(game, S_WHITE, pos);
+}
+
+
 /**
  * @~english
  * @brief Check seki status.
@@ -34,18 +58,8 @@ CheckSeki( const game_info_t *game, bool seki[] )
   int lib1_id[4], lib2_id[4], lib1_ids, lib2_ids;
   int neighbor1_lib, neighbor2_lib;
   int neighbor4[4];
-  bool seki_candidate[BOARD_MAX] = {false};
   bool already_checked;
 
-  // 双方が自己アタリになっている座標を抽出
-  for (int i = 0; i < pure_board_max; i++) {
-    const int pos = onboard_pos[i];
-    if (IsSelfAtari(game, S_BLACK, pos) &&
-        IsSelfAtari(game, S_WHITE, pos)) {
-      seki_candidate[pos] = true;
-    }
-  }
-
   for (int i = 0; i < MAX_STRING; i++) {
     // 連が存在しない,
     // または連の呼吸点数が2個でなければ次を調べる
@@ -55,11 +69,12 @@ CheckSeki( const game_info_t *game, bool seki[] )
     // 自己アタリを打たないので次を調べる
     if (string[i].size >= 6) continue;
 
-    lib1 = string[i].lib[0];
-    lib2 = string[i].lib[lib1];
+    lib1 = FirstLiberty(&string[i]);
+    lib2 = NextLiberty(&string[i], lib1);
     // 連の持つ呼吸点がともにセキの候補
-    if (seki_candidate[lib1] &&
-        seki_candidate[lib2]) {
+    // (セキの候補は呼吸点が2個の連の呼吸点でしか使わないので, 全ての交点ではなくここで判定する)
+    if (IsSekiPoint(game, lib1) &&
+        IsSekiPoint(game, lib2)) {
       // 呼吸点1の周囲の連のIDを取り出す
       GetNeighbor4(neighbor4, lib1);
       lib1_ids = 0;
@@ -104,15 +119,15 @@ CheckSeki( const game_info_t *game, bool seki[] )
       }
 
       if (lib1_ids == 1 && lib2_ids == 1) {
-        neighbor1_lib = string[lib1_id[0]].lib[0];
+        neighbor1_lib = FirstLiberty(&string[lib1_id[0]]);
         if (neighbor1_lib == lib1 ||
             neighbor1_lib == lib2) {
-          neighbor1_lib = string[lib1_id[0]].lib[neighbor1_lib];
+          neighbor1_lib = NextLiberty(&string[lib1_id[0]], neighbor1_lib);
         }
-        neighbor2_lib = string[lib2_id[0]].lib[0];
+        neighbor2_lib = FirstLiberty(&string[lib2_id[0]]);
         if (neighbor2_lib == lib1 ||
             neighbor2_lib == lib2) {
-          neighbor2_lib = string[lib2_id[0]].lib[neighbor2_lib];
+          neighbor2_lib = NextLiberty(&string[lib2_id[0]], neighbor2_lib);
         }
         if (neighbor1_lib == neighbor2_lib) {
           if (eye_condition[Pat3(game->pat, neighbor1_lib)] != E_NOT_EYE) {
@@ -11,6 +11,7 @@
 #include "board/GoBoard.hpp"
 #include "board/Point.hpp"
 #include "board/SearchBoard.hpp"
+#include "board/String.hpp"
 #include "common/Message.hpp"
 #include "feature/Nakade.hpp"
 #include "feature/Semeai.hpp"
@@ -54,19 +55,19 @@ IsCapturableAtari( const game_info_t *game, const int pos, const int color, cons
   const int id = string_id[opponent_pos];
 
   // 周囲に取り返せる石があれば安全
-  int neighbor = string[id].neighbor[0];
+  int neighbor = FirstNeighbor(&string[id]);
   while (neighbor != NEIGHBOR_END) {
     if (string[neighbor].libs == 1) {
       return false;
     }
-    neighbor = string[id].neighbor[neighbor];
+    neighbor = NextNeighbor(&string[id], neighbor);
   }
 
-  if (!IsLegalForSearch(capturable_game, string[string_id[opponent_pos]].lib[0], other)) {
+  if (!IsLegalForSearch(capturable_game, FirstLiberty(&string[string_id[opponent_pos]]), other)) {
     return true;
   }
   // 逃げるつもりでダメに打つ
-  PutStoneForSearch(capturable_game, string[string_id[opponent_pos]].lib[0], other);
+  PutStoneForSearch(capturable_game, FirstLiberty(&string[string_id[opponent_pos]]), other);
 
   // 逃げても呼吸点が1つなら捕獲可能と判定
   if (string[string_id[opponent_pos]].libs == 1) {
@@ -112,18 +113,18 @@ CheckOiotoshi( const game_info_t *game, const int pos, const int color, const in
   const int *string_id = oiotoshi_game->string_id;
   const int id = string_id[opponent_pos];
 
-  int neighbor = string[id].neighbor[0];
+  int neighbor = FirstNeighbor(&string[id]);
   while (neighbor != NEIGHBOR_END) {
     if (string[neighbor].libs == 1) {
       return -1;
     }
-    neighbor = string[id].neighbor[neighbor];
+    neighbor = NextNeighbor(&string[id], neighbor);
   }
 
-  if (!IsLegalForSearch(oiotoshi_game, string[string_id[opponent_pos]].lib[0], other)) {
+  if (!IsLegalForSearch(oiotoshi_game, FirstLiberty(&string[string_id[opponent_pos]]), other)) {
     return -1;
   }
-  PutStoneForSearch(oiotoshi_game, string[string_id[opponent_pos]].lib[0], other);
+  PutStoneForSearch(oiotoshi_game, FirstLiberty(&string[string_id[opponent_pos]]), other);
 
   if (string[string_id[opponent_pos]].libs == 1) {
     num = string[string_id[opponent_pos]].size;
@@ -149,7 +150,7 @@ int
 CapturableCandidate( const game_info_t *game, const int id )
 {
   const string_t *string = game->string;
-  int neighbor = string[id].neighbor[0];
+  int neighbor = FirstNeighbor(&string[id]);
   bool flag = false;
   int capturable_pos = -1;
 
@@ -162,11 +163,11 @@ CapturableCandidate( const game_info_t *game, const int id )
         if (flag) {
           return -1;
         }
-        capturable_pos = string[neighbor].lib[0];
+        capturable_pos = FirstLiberty(&string[neighbor]);
         flag = true;
       }
     }
-    neighbor = string[id].neighbor[neighbor];
+    neighbor = NextNeighbor(&string[id], neighbor);
   }
 
   return capturable_pos;
@@ -191,7 +192,7 @@ bool
 IsDeadlyExtension( const game_info_t *game, const int color, const int id )
 {
   const int other = GetOppositeColor(color);
-  int pos = game->string[id].lib[0];
+  int pos = FirstLiberty(&game->string[id]);
 
   if (nb4_empty[Pat3(game->pat, pos)] == 0 &&
       IsSuicide(game, game->string, other, pos)) {
@@ -327,10 +328,10 @@ IsCapturableAtariForSimulation( const game_info_t *game, const int pos, const in
   int connect_libs = 0;
   int tmp_id;
 
-  lib = string[id].lib[0];
+  lib = FirstLiberty(&string[id]);
 
   if (lib == pos) {
-    lib = string[id].lib[lib];
+    lib = NextLiberty(&string[id], lib);
   }
 
   index_distance = lib - pos;
@@ -543,7 +544,7 @@ IsSelfAtari( const game_info_t *game, const int color, const int pos )
   if (board[NORTH(pos)] == color) {
     id = string_id[NORTH(pos)];
     if (string[id].libs > 2) return false;
-    lib = string[id].lib[0];
+    lib = FirstLiberty(&string[id]);
     count = 0;
     while (lib != LIBERTY_END) {
       if (lib != pos) {
@@ -559,7 +560,7 @@ IsSelfAtari( const game_info_t *game, const int color, const int pos )
           count++;
         }
       }
-      lib = string[id].lib[lib];
+      lib = NextLiberty(&string[id], lib);
     }
     libs += count;
     already[already_num++] = id;
@@ -574,7 +575,7 @@ IsSelfAtari( const game_info_t *game, const int color, const int pos )
     id = string_id[WEST(pos)];
     if (already[0] != id) {
       if (string[id].libs > 2) return false;
-      lib = string[id].lib[0];
+      lib = FirstLiberty(&string[id]);
       count = 0;
       while (lib != LIBERTY_END) {
         if (lib != pos) {
@@ -590,7 +591,7 @@ IsSelfAtari( const game_info_t *game, const int color, const int pos )
             count++;
           }
         }
-        lib = string[id].lib[lib];
+        lib = NextLiberty(&string[id], lib);
       }
       libs += count;
       already[already_num++] = id;
@@ -606,7 +607,7 @@ IsSelfAtari( const game_info_t *game, const int color, const int pos )
     id = string_id[EAST(pos)];
     if (already[0] != id && already[1] != id) {
       if (string[id].libs > 2) return false;
-      lib = string[id].lib[0];
+      lib = FirstLiberty(&string[id]);
       count = 0;
       while (lib != LIBERTY_END) {
         if (lib != pos) {
@@ -622,7 +623,7 @@ IsSelfAtari( const game_info_t *game, const int color, const int pos )
             count++;
           }
         }
-        lib = string[id].lib[lib];
+        lib = NextLiberty(&string[id], lib);
       }
       libs += count;
       already[already_num++] = id;
@@ -639,7 +640,7 @@ IsSelfAtari( const game_info_t *game, const int color, const int pos )
     id = string_id[SOUTH(pos)];
     if (already[0] != id && already[1] != id && already[2] != id) {
       if (string[id].libs > 2) return false;
-      lib = string[id].lib[0];
+      lib = FirstLiberty(&string[id]);
       count = 0;
       while (lib != LIBERTY_END) {
         if (lib != pos) {
@@ -655,7 +656,7 @@ IsSelfAtari( const game_info_t *game, const int color, const int pos )
             count++;
           }
         }
-        lib = string[id].lib[lib];
+        lib = NextLiberty(&string[id], lib);
       }
       libs += count;
       already[already_num++] = id;
@@ -699,8 +700,8 @@ IsAlreadyCaptured( const game_info_t *game, const int id, int player_id[], int p
   if (string[id].libs == 1) {
     return true;
   } else if (string[id].libs == 2) {
-    lib1 = string[id].lib[0];
-    lib2 = string[id].lib[lib1];
+    lib1 = FirstLiberty(&string[id]);
+    lib2 = NextLiberty(&string[id], lib1);
 
     GetNeighbor4(neighbor4, lib1);
     checked = false;
@@ -782,7 +783,7 @@ IsMeaningfulSelfAtari( const game_info_t *game, const int color, const int pos )
   if (board[NORTH(pos)] == color) {
     id = string_id[NORTH(pos)];
     if (string[id].libs > 2) return true;
-    lib = string[id].lib[0];
+    lib = FirstLiberty(&string[id]);
     count = 0;
     while (lib != LIBERTY_END) {
       if (lib != pos) {
@@ -798,7 +799,7 @@ IsMeaningfulSelfAtari( const game_info_t *game, const int color, const int pos )
           count++;
         }
       }
-      lib = string[id].lib[lib];
+      lib = NextLiberty(&string[id], lib);
     }
     libs += count;
     size += string[id].size;
@@ -814,7 +815,7 @@ IsMeaningfulSelfAtari( const game_info_t *game, const int color, const int pos )
     id = string_id[WEST(pos)];
     if (already[0] != id) {
       if (string[id].libs > 2) return true;
-      lib = string[id].lib[0];
+      lib = FirstLiberty(&string[id]);
       count = 0;
       while (lib != LIBERTY_END) {
         if (lib != pos) {
@@ -830,7 +831,7 @@ IsMeaningfulSelfAtari( const game_info_t *game, const int color, const int pos )
             count++;
           }
         }
-        lib = string[id].lib[lib];
+        lib = NextLiberty(&string[id], lib);
       }
       libs += count;
       size += string[id].size;
@@ -847,7 +848,7 @@ IsMeaningfulSelfAtari( const game_info_t *game, const int color, const int pos )
     id = string_id[EAST(pos)];
     if (already[0] != id && already[1] != id) {
       if (string[id].libs > 2) return true;
-      lib = string[id].lib[0];
+      lib = FirstLiberty(&string[id]);
       count = 0;
       while (lib != LIBERTY_END) {
         if (lib != pos) {
@@ -863,7 +864,7 @@ IsMeaningfulSelfAtari( const game_info_t *game, const int color, const int pos )
             count++;
           }
         }
-        lib = string[id].lib[lib];
+        lib = NextLiberty(&string[id], lib);
       }
       libs += count;
       size += string[id].size;
@@ -879,7 +880,7 @@ IsMeaningfulSelfAtari( const game_info_t *game, const int color, const int pos )
     id = string_id[SOUTH(pos)];
     if (already[0] != id && already[1] != id && already[2] != id) {
       if (string[id].libs > 2) return true;
-      lib = string[id].lib[0];
+      lib = FirstLiberty(&string[id]);
       count = 0;
       while (lib != LIBERTY_END) {
         if (lib != pos) {
@@ -895,7 +896,7 @@ IsMeaningfulSelfAtari( const game_info_t *game, const int color, const int pos )
             count++;
           }
         }
-        lib = string[id].lib[lib];
+        lib = NextLiberty(&string[id], lib);
       }
       libs += count;
       size += string[id].size;
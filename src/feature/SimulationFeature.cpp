@@ -6,6 +6,7 @@
  * @~japanese
  * @brief モンテカルロ・シミュレーション用の特徴
  */
+#include "board/String.hpp"
 #include "feature/Nakade.hpp"
 #include "feature/Semeai.hpp"
 #include "feature/SimulationFeature.hpp"
@@ -68,12 +69,12 @@ CheckFeatureLib1ForSimulation( game_info_t *game, const int color, const int id,
   const int other = GetOppositeColor(color);
   const char *board = game->board;
   const string_t *string = game->string;
-  int neighbor = string[id].neighbor[0];
+  int neighbor = FirstNeighbor(&string[id]);
   int lib, liberty;
   bool contact = false;
 
   // 呼吸点が1つになった連の呼吸点を取り出す
-  lib = string[id].lib[0];
+  lib = FirstLiberty(&string[id]);
   liberty = lib;
 
   // 呼吸点の上下左右が敵石に接触しているか確認
@@ -110,7 +111,7 @@ CheckFeatureLib1ForSimulation( game_info_t *game, const int color, const int id,
   if (string[id].size == 1) {
     while (neighbor != NEIGHBOR_END) {
       if (string[neighbor].libs == 1) {
-        lib = string[neighbor].lib[0];
+        lib = FirstLiberty(&string[neighbor]);
         if (string[neighbor].size == 1) {
           CompareSwapFeature(game->tactical_features, lib, CAPTURE, SIM_SAVE_CAPTURE_1_1);
         } else if (string[neighbor].size == 2) {
@@ -120,12 +121,12 @@ CheckFeatureLib1ForSimulation( game_info_t *game, const int color, const int id,
         }
         update[update_num++] = lib;
       }
-      neighbor = string[id].neighbor[neighbor];
+      neighbor = NextNeighbor(&string[id], neighbor);
     }
   } else if (string[id].size == 2) {
     while (neighbor != NEIGHBOR_END) {
       if (string[neighbor].libs == 1) {
-        lib = string[neighbor].lib[0];
+        lib = FirstLiberty(&string[neighbor]);
         if (string[neighbor].size == 1) {
           if (IsSelfAtariCaptureForSimulation(game, lib, color, liberty)) {
             CompareSwapFeature(game->tactical_features, lib, CAPTURE, SIM_SAVE_CAPTURE_SELF_ATARI);
@@ -139,12 +140,12 @@ CheckFeatureLib1ForSimulation( game_info_t *game, const int color, const int id,
         }
         update[update_num++] = lib;
       }
-      neighbor = string[id].neighbor[neighbor];
+      neighbor = NextNeighbor(&string[id], neighbor);
     }
   } else if (string[id].size >= 3) {
     while (neighbor != NEIGHBOR_END) {
       if (string[neighbor].libs == 1) {
-        lib = string[neighbor].lib[0];
+        lib = FirstLiberty(&string[neighbor]);
         if (string[neighbor].size == 1) {
           if (IsSelfAtariCaptureForSimulation(game, lib, color, liberty)) {
             CompareSwapFeature(game->tactical_features, lib, CAPTURE, SIM_SAVE_CAPTURE_SELF_ATARI);
@@ -158,7 +159,7 @@ CheckFeatureLib1ForSimulation( game_info_t *game, const int color, const int id,
         }
         update[update_num++] = lib;
       }
-      neighbor = string[id].neighbor[neighbor];
+      neighbor = NextNeighbor(&string[id], neighbor);
     }
   }
 }
@@ -186,13 +187,13 @@ CheckFeatureLib2ForSimulation( game_info_t *game, const int color, const int id,
   const int *string_id = game->string_id;
   const string_t *string = game->string;
   const char *board = game->board;
-  int neighbor = string[id].neighbor[0];
+  int neighbor = FirstNeighbor(&string[id]);
   int lib1, lib2;
   bool capturable1, capturable2;
 
   // 呼吸点が2つになった連の呼吸点を取り出す
-  lib1 = string[id].lib[0];
-  lib2 = string[id].lib[lib1];
+  lib1 = FirstLiberty(&string[id]);
+  lib2 = NextLiberty(&string[id], lib1);
 
   // 呼吸点の周囲が空点3つ, または呼吸点が3つ以上の自分の連に接続できるかで特徴を判定
   if (nb4_empty[Pat3(game->pat, lib1)] == 3 ||
@@ -234,7 +235,7 @@ CheckFeatureLib2ForSimulation( game_info_t *game, const int color, const int id,
   // それぞれに対して, 特徴を判定する
   while (neighbor != NEIGHBOR_END) {
     if (string[neighbor].libs == 1) {
-      lib1 = string[neighbor].lib[0];
+      lib1 = FirstLiberty(&string[neighbor]);
       update[update_num++] = lib1;
       if (string[neighbor].size <= 2) {
         CompareSwapFeature(game->tactical_features, lib1, CAPTURE, SIM_2POINT_CAPTURE_SMALL);
@@ -242,8 +243,8 @@ CheckFeatureLib2ForSimulation( game_info_t *game, const int color, const int id,
         CompareSwapFeature(game->tactical_features, lib1, CAPTURE, SIM_2POINT_CAPTURE_LARGE);
       }
     } else if (string[neighbor].libs == 2) {
-      lib1 = string[neighbor].lib[0];
-      lib2 = string[neighbor].lib[lib1];
+      lib1 = FirstLiberty(&string[neighbor]);
+      lib2 = NextLiberty(&string[neighbor], lib1);
       update[update_num++] = lib1;
       update[update_num++] = lib2;
       capturable1 = IsCapturableAtariForSimulation(game, lib1, color, neighbor);
@@ -272,7 +273,7 @@ CheckFeatureLib2ForSimulation( game_info_t *game, const int color, const int id,
         }
       }
     }
-    neighbor = string[id].neighbor[neighbor];
+    neighbor = NextNeighbor(&string[id], neighbor);
   }
 }
 
@@ -299,14 +300,14 @@ CheckFeatureLib3ForSimulation( game_info_t *game, const int color, const int id,
   const int *string_id = game->string_id;
   const string_t *string = game->string;
   const char *board = game->board;
-  int neighbor = string[id].neighbor[0];
+  int neighbor = FirstNeighbor(&string[id]);
   int lib1, lib2, lib3;
   bool capturable1, capturable2;
 
   // 呼吸点が3つになった連の呼吸点を取り出す
-  lib1 = string[id].lib[0];
-  lib2 = string[id].lib[lib1];
-  lib3 = string[id].lib[lib2];
+  lib1 = FirstLiberty(&string[id]);
+  lib2 = NextLiberty(&string[id], lib1);
+  lib3 = NextLiberty(&string[id], lib2);
 
   // 呼吸点の周囲が空点3つ, または呼吸点が3つ以上の自分の連に接続できるかで特徴を判定
   if (nb4_empty[Pat3(game->pat, lib1)] == 3 ||
@@ -365,7 +366,7 @@ CheckFeatureLib3ForSimulation( game_info_t *game, const int color, const int id,
   // それぞれに対して, 特徴を判定する
   while (neighbor != NEIGHBOR_END) {
     if (string[neighbor].libs == 1) {
-      lib1 = string[neighbor].lib[0];
+      lib1 = FirstLiberty(&string[neighbor]);
       update[update_num++] = lib1;
       if (string[neighbor].size <= 2) {
         CompareSwapFeature(game->tactical_features, lib1, CAPTURE, SIM_3POINT_CAPTURE_SMALL);
@@ -373,8 +374,8 @@ CheckFeatureLib3ForSimulation( game_info_t *game, const int color, const int id,
         CompareSwapFeature(game->tactical_features, lib1, CAPTURE, SIM_3POINT_CAPTURE_LARGE);
       }
     } else if (string[neighbor].libs == 2) {
-      lib1 = string[neighbor].lib[0];
-      lib2 = string[neighbor].lib[lib1];
+      lib1 = FirstLiberty(&string[neighbor]);
+      lib2 = NextLiberty(&string[neighbor], lib1);
       update[update_num++] = lib1;
       update[update_num++] = lib2;
       capturable1 = IsCapturableAtariForSimulation(game, lib1, color, neighbor);
@@ -403,9 +404,9 @@ CheckFeatureLib3ForSimulation( game_info_t *game, const int color, const int id,
         }
       }
     } else if (string[neighbor].libs == 3) {
-      lib1 = string[neighbor].lib[0];
-      lib2 = string[neighbor].lib[lib1];
-      lib3 = string[neighbor].lib[lib2];
+      lib1 = FirstLiberty(&string[neighbor]);
+      lib2 = NextLiberty(&string[neighbor], lib1);
+      lib3 = NextLiberty(&string[neighbor], lib2);
       update[update_num++] = lib1;
       update[update_num++] = lib2;
       update[update_num++] = lib3;
@@ -419,7 +420,7 @@ CheckFeatureLib3ForSimulation( game_info_t *game, const int color, const int id,
         CompareSwapFeature(game->tactical_features, lib3, DAME, SIM_3POINT_DAME_LARGE);
       }
     }
-    neighbor = string[id].neighbor[neighbor];
+    neighbor = NextNeighbor(&string[id], neighbor);
   }
 }
 
@@ -542,7 +543,7 @@ CheckCaptureAfterKoForSimulation( game_info_t *game, const int color, int update
   if (board[NORTH(previous_move_2)] == other) {
     const int id = string_id[NORTH(previous_move_2)];
     if (string[id].libs == 1) {
-      const int lib = string[id].lib[0];
+      const int lib = FirstLiberty(&string[id]);
       update[update_num++] = lib;
       CompareSwapFeature(game->tactical_features, lib, CAPTURE, SIM_CAPTURE_AFTER_KO);
     }
@@ -553,7 +554,7 @@ CheckCaptureAfterKoForSimulation( game_info_t *game, const int color, int update
   if (board[EAST(previous_move_2)] == other) {
     const int id = string_id[EAST(previous_move_2)];
     if (string[id].libs == 1 && check[0] != id) {
-      const int lib = string[id].lib[0];
+      const int lib = FirstLiberty(&string[id]);
       update[update_num++] = lib;
       CompareSwapFeature(game->tactical_features, lib, CAPTURE, SIM_CAPTURE_AFTER_KO);
     }
@@ -564,7 +565,7 @@ CheckCaptureAfterKoForSimulation( game_info_t *game, const int color, int update
   if (board[SOUTH(previous_move_2)] == other) {
     const int id = string_id[SOUTH(previous_move_2)];
     if (string[id].libs == 1 && check[0] != id && check[1] != id) {
-      const int lib = string[id].lib[0];
+      const int lib = FirstLiberty(&string[id]);
       update[update_num++] = lib;
       CompareSwapFeature(game->tactical_features, lib, CAPTURE, SIM_CAPTURE_AFTER_KO);
     }
@@ -575,7 +576,7 @@ CheckCaptureAfterKoForSimulation( game_info_t *game, const int color, int update
   if (board[WEST(previous_move_2)] == other) {
     const int id = string_id[WEST(previous_move_2)];
     if (string[id].libs == 1 && check[0] != id && check[1] != id && check[2] != id) {
-      const int lib = string[id].lib[0];
+      const int lib = FirstLiberty(&string[id]);
       update[update_num++] = lib;
       CompareSwapFeature(game->tactical_features, lib, CAPTURE, SIM_CAPTURE_AFTER_KO);
     }
@@ -621,7 +622,7 @@ CheckSelfAtariForSimulation( game_info_t *game, const int color, const int pos )
   if (board[NORTH(pos)] == color) {
     id = string_id[NORTH(pos)];
     if (string[id].libs > 2) return true;
-    lib = string[id].lib[0];
+    lib = FirstLiberty(&string[id]);
     count = 0;
     while (lib != LIBERTY_END) {
       if (lib != pos) {
@@ -637,7 +638,7 @@ CheckSelfAtariForSimulation( game_info_t *game, const int color, const int pos )
           count++;
         }
       }
-      lib = string[id].lib[lib];
+      lib = NextLiberty(&string[id], lib);
     }
     libs += count;
     size += string[id].size;
@@ -653,7 +654,7 @@ CheckSelfAtariForSimulation( game_info_t *game, const int color, const int pos )
     id = string_id[WEST(pos)];
     if (already[0] != id) {
       if (string[id].libs > 2) return true;
-      lib = string[id].lib[0];
+      lib = FirstLiberty(&string[id]);
       count = 0;
       while (lib != LIBERTY_END) {
         if (lib != pos) {
@@ -669,7 +670,7 @@ CheckSelfAtariForSimulation( game_info_t *game, const int color, const int pos )
             count++;
           }
         }
-        lib = string[id].lib[lib];
+        lib = NextLiberty(&string[id], lib);
       }
       libs += count;
       size += string[id].size;
@@ -686,7 +687,7 @@ CheckSelfAtariForSimulation( game_info_t *game, const int color, const int pos )
     id = string_id[EAST(pos)];
     if (already[0] != id && already[1] != id) {
       if (string[id].libs > 2) return true;
-      lib = string[id].lib[0];
+      lib = FirstLiberty(&string[id]);
       count = 0;
       while (lib != LIBERTY_END) {
         if (lib != pos) {
@@ -702,7 +703,7 @@ CheckSelfAtariForSimulation( game_info_t *game, const int color, const int pos )
             count++;
           }
         }
-        lib = string[id].lib[lib];
+        lib = NextLiberty(&string[id], lib);
       }
       libs += count;
       size += string[id].size;
@@ -720,7 +721,7 @@ CheckSelfAtariForSimulation( game_info_t *game, const int color, const int pos )
     id = string_id[SOUTH(pos)];
     if (already[0] != id && already[1] != id && already[2] != id) {
       if (string[id].libs > 2) return true;
-      lib = string[id].lib[0];
+      lib = FirstLiberty(&string[id]);
       count = 0;
       while (lib != LIBERTY_END) {
         if (lib != pos) {
@@ -736,7 +737,7 @@ CheckSelfAtariForSimulation( game_info_t *game, const int color, const int pos )
             count++;
           }
         }
-        lib = string[id].lib[lib];
+        lib = NextLiberty(&string[id], lib);
       }
       libs += count;
       size += string[id].size;
@@ -6,6 +6,7 @@
  * @~japanese
  * @brief 木探索の着手評価用の特徴
  */
+#include "board/String.hpp"
 #include "feature/Ladder.hpp"
 #include "feature/Nakade.hpp"
 #include "feature/Semeai.hpp"
@@ -68,7 +69,7 @@ CheckFeaturesLib1ForTree( const game_info_t *game, const int color, const int id
   int lib, neighbor;
 
   // 呼吸点が1つになった連の呼吸点を取り出す
-  lib = string[id].lib[0];
+  lib = FirstLiberty(&string[id]);
 
   // シチョウを逃げる手かどうかで特徴を判定
   if (ladder) {
@@ -85,10 +86,10 @@ CheckFeaturesLib1ForTree( const game_info_t *game, const int color, const int id
 
   // 敵連を取ることによって連を助ける手の特徴の判定
   // 自分の連の大きさと敵の連の大きさで特徴を判定
-  neighbor = string[id].neighbor[0];
+  neighbor = FirstNeighbor(&string[id]);
   while (neighbor != NEIGHBOR_END) {
     if (string[neighbor].libs == 1) {
-      lib = string[neighbor].lib[0];
+      lib = FirstLiberty(&string[neighbor]);
       if (string[id].size == 1) {
         if (string[neighbor].size == 1) {
           CompareSwapFeature(tactical_features, lib, UCT_CAPTURE_INDEX, UCT_SAVE_CAPTURE_1_1);
@@ -123,7 +124,7 @@ CheckFeaturesLib1ForTree( const game_info_t *game, const int color, const int id
         }
       }
     }
-    neighbor = string[id].neighbor[neighbor];
+    neighbor = NextNeighbor(&string[id], neighbor);
   }
 }
 
@@ -149,8 +150,8 @@ CheckFeaturesLib2ForTree( const game_info_t *game, const int color, const int id
   int lib1, lib2, neighbor, lib1_state, lib2_state;
 
   // 呼吸点が2つになった連の呼吸点を取り出す
-  lib1 = string[id].lib[0];
-  lib2 = string[id].lib[lib1];
+  lib1 = FirstLiberty(&string[id]);
+  lib2 = NextLiberty(&string[id], lib1);
 
   // 呼吸点に打つ特徴
   lib1_state = CheckLibertyState(game, lib1, color, id);
@@ -188,19 +189,19 @@ CheckFeaturesLib2ForTree( const game_info_t *game, const int color, const int id
   // 2. 呼吸点が2つの敵連
   // それぞれに対して, 特徴を判定する
   // さらに2.に関しては1手で取れるかどうかも考慮する
-  neighbor = string[id].neighbor[0];
+  neighbor = FirstNeighbor(&string[id]);
   if (string[id].size <= 2) {
     while (neighbor != NEIGHBOR_END) {
       if (string[neighbor].libs == 1) {
-        lib1 = string[neighbor].lib[0];
+        lib1 = FirstLiberty(&string[neighbor]);
         if (string[neighbor].size <= 2) {
           CompareSwapFeature(tactical_features, lib1, UCT_CAPTURE_INDEX, UCT_2POINT_CAPTURE_S_S);
         } else {
           CompareSwapFeature(tactical_features, lib1, UCT_CAPTURE_INDEX, UCT_2POINT_CAPTURE_S_L);
         }
       } else if (string[neighbor].libs == 2) {
-        lib1 = string[neighbor].lib[0];
-        lib2 = string[neighbor].lib[lib1];
+        lib1 = FirstLiberty(&string[neighbor]);
+        lib2 = NextLiberty(&string[neighbor], lib1);
         if (string[neighbor].size <= 2) {
           if (IsCapturableAtari(game, lib1, color, string[neighbor].origin)) {
             CompareSwapFeature(tactical_features, lib1, UCT_ATARI_INDEX, UCT_2POINT_C_ATARI_S_S);
@@ -225,20 +226,20 @@ CheckFeaturesLib2ForTree( const game_info_t *game, const int color, const int id
           }
         }
       }
-      neighbor = string[id].neighbor[neighbor];
+      neighbor = NextNeighbor(&string[id], neighbor);
     }
   } else {
     while (neighbor != NEIGHBOR_END) {
       if (string[neighbor].libs == 1) {
-        lib1 = string[neighbor].lib[0];
+        lib1 = FirstLiberty(&string[neighbor]);
         if (string[neighbor].size <= 2) {
           CompareSwapFeature(tactical_features, lib1, UCT_CAPTURE_INDEX, UCT_2POINT_CAPTURE_L_S);
         } else {
           CompareSwapFeature(tactical_features, lib1, UCT_CAPTURE_INDEX, UCT_2POINT_CAPTURE_L_L);
         }
       } else if (string[neighbor].libs == 2) {
-        lib1 = string[neighbor].lib[0];
-        lib2 = string[neighbor].lib[lib1];
+        lib1 = FirstLiberty(&string[neighbor]);
+        lib2 = NextLiberty(&string[neighbor], lib1);
         if (string[neighbor].size <= 2) {
           if (IsCapturableAtari(game, lib1, color, string[neighbor].origin)) {
             CompareSwapFeature(tactical_features, lib1, UCT_ATARI_INDEX, UCT_2POINT_C_ATARI_L_S);
@@ -263,7 +264,7 @@ CheckFeaturesLib2ForTree( const game_info_t *game, const int color, const int id
           }
         }
       }
-      neighbor = string[id].neighbor[neighbor];
+      neighbor = NextNeighbor(&string[id], neighbor);
     }
   }
 }
@@ -290,9 +291,9 @@ CheckFeaturesLib3ForTree( const game_info_t *game, const int color, const int id
   int lib1, lib2, lib3, neighbor, lib1_state, lib2_state, lib3_state;
 
   // 呼吸点が3つになった連の呼吸点を取り出す
-  lib1 = string[id].lib[0];
-  lib2 = string[id].lib[lib1];
-  lib3 = string[id].lib[lib2];
+  lib1 = FirstLiberty(&string[id]);
+  lib2 = NextLiberty(&string[id], lib1);
+  lib3 = NextLiberty(&string[id], lib2);
 
   // 呼吸点に打つ特徴
   lib1_state = CheckLibertyState(game, lib1, color, id);
@@ -346,19 +347,19 @@ CheckFeaturesLib3ForTree( const game_info_t *game, const int color, const int id
   // それぞれに対して, 特徴を判定する
   // さらに2に関しては1手で取れるかを考慮する
 
-  neighbor = string[id].neighbor[0];
+  neighbor = FirstNeighbor(&string[id]);
   if (string[id].size <= 2) {
     while (neighbor != NEIGHBOR_END) {
       if (string[neighbor].libs == 1) {
-        lib1 = string[neighbor].lib[0];
+        lib1 = FirstLiberty(&string[neighbor]);
         if (string[neighbor].size <= 2) {
           CompareSwapFeature(tactical_features, lib1, UCT_CAPTURE_INDEX, UCT_3POINT_CAPTURE_S_S);
         } else {
           CompareSwapFeature(tactical_features, lib1, UCT_CAPTURE_INDEX, UCT_3POINT_CAPTURE_S_L);
         }
       } else if (string[neighbor].libs == 2) {
-        lib1 = string[neighbor].lib[0];
-        lib2 = string[neighbor].lib[lib1];
+        lib1 = FirstLiberty(&string[neighbor]);
+        lib2 = NextLiberty(&string[neighbor], lib1);
         if (string[neighbor].size <= 2) {
           if (IsCapturableAtari(game, lib1, color, string[neighbor].origin)) {
             CompareSwapFeature(tactical_features, lib1, UCT_ATARI_INDEX, UCT_3POINT_C_ATARI_S_S);
@@ -383,9 +384,9 @@ CheckFeaturesLib3ForTree( const game_info_t *game, const int color, const int id
           }
         }
       } else if (string[neighbor].libs == 3) {
-        lib1 = string[neighbor].lib[0];
-        lib2 = string[neighbor].lib[lib1];
-        lib3 = string[neighbor].lib[lib2];
+        lib1 = FirstLiberty(&string[neighbor]);
+        lib2 = NextLiberty(&string[neighbor], lib1);
+        lib3 = NextLiberty(&string[neighbor], lib2);
         if (string[neighbor].size <= 2) {
           CompareSwapFeature(tactical_features, lib1, UCT_DAME_INDEX, UCT_3POINT_DAME_S_S);
           CompareSwapFeature(tactical_features, lib2, UCT_DAME_INDEX, UCT_3POINT_DAME_S_S);
@@ -396,20 +397,20 @@ CheckFeaturesLib3ForTree( const game_info_t *game, const int color, const int id
           CompareSwapFeature(tactical_features, lib3, UCT_DAME_INDEX, UCT_3POINT_DAME_S_L);
         }
       }
-      neighbor = string[id].neighbor[neighbor];
+      neighbor = NextNeighbor(&string[id], neighbor);
     }
   } else {
     while (neighbor != NEIGHBOR_END) {
       if (string[neighbor].libs == 1) {
-        lib1 = string[neighbor].lib[0];
+        lib1 = FirstLiberty(&string[neighbor]);
         if (string[neighbor].size <= 2) {
           CompareSwapFeature(tactical_features, lib1, UCT_CAPTURE_INDEX, UCT_3POINT_CAPTURE_L_S);
         } else {
           CompareSwapFeature(tactical_features, lib1, UCT_CAPTURE_INDEX, UCT_3POINT_CAPTURE_L_L);
         }
       } else if (string[neighbor].libs == 2) {
-        lib1 = string[neighbor].lib[0];
-        lib2 = string[neighbor].lib[lib1];
+        lib1 = FirstLiberty(&string[neighbor]);
+        lib2 = NextLiberty(&string[neighbor], lib1);
         if (string[neighbor].size <= 2) {
           if (IsCapturableAtari(game, lib1, color, string[neighbor].origin)) {
             CompareSwapFeature(tactical_features, lib1, UCT_ATARI_INDEX, UCT_3POINT_C_ATARI_L_S);
@@ -434,9 +435,9 @@ CheckFeaturesLib3ForTree( const game_info_t *game, const int color, const int id
           }
         }
       } else if (string[neighbor].libs == 3) {
-        lib1 = string[neighbor].lib[0];
-        lib2 = string[neighbor].lib[lib1];
-        lib3 = string[neighbor].lib[lib2];
+        lib1 = FirstLiberty(&string[neighbor]);
+        lib2 = NextLiberty(&string[neighbor], lib1);
+        lib3 = NextLiberty(&string[neighbor], lib2);
         if (string[neighbor].size <= 2) {
           CompareSwapFeature(tactical_features, lib1, UCT_DAME_INDEX, UCT_3POINT_DAME_L_S);
           CompareSwapFeature(tactical_features, lib2, UCT_DAME_INDEX, UCT_3POINT_DAME_L_S);
@@ -447,7 +448,7 @@ CheckFeaturesLib3ForTree( const game_info_t *game, const int color, const int id
           CompareSwapFeature(tactical_features, lib3, UCT_DAME_INDEX, UCT_3POINT_DAME_L_L);
         }
       }
-      neighbor = string[id].neighbor[neighbor];
+      neighbor = NextNeighbor(&string[id], neighbor);
     }
   }
 }
@@ -541,7 +542,7 @@ CheckCaptureAfterKoForTree( const game_info_t *game, const int color, unsigned i
     if (board[neighbor4[i]] == other) {
       id = string_id[neighbor4[i]];
       if (string[id].libs == 1) {
-        lib = string[id].lib[0];
+        lib = FirstLiberty(&string[id]);
         CompareSwapFeature(tactical_features, lib, UCT_CAPTURE_INDEX, UCT_CAPTURE_AFTER_KO);
       }
     }
@@ -598,7 +599,7 @@ CheckSelfAtariForTree( const game_info_t *game, const int color, const int pos,
       if (already_checked) continue;
 
       if (string[id].libs > 2) return true;
-      lib = string[id].lib[0];
+      lib = FirstLiberty(&string[id]);
       count = 0;
       while (lib != LIBERTY_END) {
         if (lib != pos) {
@@ -614,7 +615,7 @@ CheckSelfAtariForTree( const game_info_t *game, const int color, const int pos,
             count++;
           }
         }
-        lib = string[id].lib[lib];
+        lib = NextLiberty(&string[id], lib);
       }
       libs += count;
       size += string[id].size;
@@ -681,13 +682,13 @@ CheckCaptureForTree( const game_info_t *game, const int color, const int pos, un
       if (string[string_id[neighbor4[i]]].libs == 1) {
         check = false;
         id = string_id[neighbor4[i]];
-        neighbor = string[id].neighbor[0];
+        neighbor = FirstNeighbor(&string[id]);
         while (neighbor != NEIGHBOR_END) {
           if (string[neighbor].libs == 1) {
             check = true;
             break;
           }
-          neighbor = string[id].neighbor[neighbor];
+          neighbor = NextNeighbor(&string[id], neighbor);
         }
         if (check) {
           CompareSwapFeature(tactical_features, pos, UCT_CAPTURE_INDEX, UCT_SEMEAI_CAPTURE);
@@ -780,7 +781,7 @@ CheckKoRecaptureForTree( const game_info_t *game, const int color, unsigned int
   if (board[pm3] == other) {
     const int id = string_id[pm3];
     if (string[id].libs == 1) {
-      const int lib = string[id].lib[0];
+      const int lib = FirstLiberty(&string[id]);
       CompareSwapFeature(tactical_features, lib, UCT_CAPTURE_INDEX, UCT_KO_RECAPTURE);
     }
   }
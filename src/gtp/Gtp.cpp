@@ -102,6 +102,14 @@ const char err_play[] = "play color point";
  */
 const char err_komi[] = "komi float";
 
+/**
+ * @~english
+ * @brief Error message for board size which cannot be played in this build.
+ * @~japanese
+ * @brief このビルドで扱えない盤の大きさに対するエラーメッセージ
+ */
+const char err_boardsize[] = "unacceptable size";
+
 /**
  * @~english
  * @brief Ray's stone color.
@@ -333,8 +341,13 @@ GTP_boardsize( void )
   snprintf(buf, 1024, " ");
 #endif
 
-  if (pure_board_size != size &&
-      size <= PURE_BOARD_SIZE && size > 0) {
+  // 盤の大きさを固定したビルドではPURE_BOARD_SIZE以外の盤は扱えない
+  if (size > PURE_BOARD_SIZE || size < MIN_PURE_BOARD_SIZE) {
+    GTP_response(err_boardsize, false);
+    return;
+  }
+
+  if (pure_board_size != size) {
     SetBoardSize(size);
     SetParameter();
     SetNeighbor();
@@ -995,7 +1008,7 @@ GTP_loadsgf( void )
 
   // 碁盤の初期化処理
   if (pure_board_size != size &&
-      size <= PURE_BOARD_SIZE && size > 0) {
+      size <= PURE_BOARD_SIZE && size >= MIN_PURE_BOARD_SIZE) {
     SetBoardSize(size);
     SetParameter();
     SetNeighbor();
@@ -8,7 +8,9 @@
  */
 #include <algorithm>
 
+#include "board/BitBoard.hpp"
 #include "mcts/MCTSNode.hpp"
+#include "mcts/NodeArena.hpp"
 
 
 /**
@@ -32,9 +34,177 @@ InitializeNode( uct_node_t &node, const int pm1, const int pm2 )
   node.win = 0;
   node.virtual_loss = 0;
   node.width = 0;
+  node.rank_count = 0;
+  node.ownership_pending = 0;
+  node.ownership_count = 0;
   node.child_num = 0;
-  std::fill_n(node.seki, BOARD_MAX, false);
-  std::fill_n(node.ownership, BOARD_MAX, 0.0);
+  std::fill_n(node.seki, BITBOARD_WORDS, 0ULL);
+}
+
+
+/**
+ * @~english
+ * @brief Calculate size of the node arena block for a node.
+ * @param[in] child_num The number of child nodes.
+ * @return Size of the block.
+ * @~japanese
+ * @brief ノード1つ分のメモリ領域のブロックの大きさの計算
+ * @param[in] child_num 子ノードの個数
+ * @return ブロックの大きさ
+ */
+size_t
+CalculateNodeBlockSize( const int child_num )
+{
+  const size_t child_size = (sizeof(child_node_t) * child_num + sizeof(double) - 1) / sizeof(double) * sizeof(double);
+
+  return child_size + sizeof(double) * pure_board_max + sizeof(unsigned long long) * 2 * OWNERSHIP_PLANES * bitboard_words;
+}
+
+
+/**
+ * @~english
+ * @brief Allocate a block for children and ownership of a node from the node arena.
+ * The tree is full when it returns nullptr, and the caller must stop expanding.
+ * @param[in] child_num The number of child nodes.
+ * @param[out] size Size of the allocated block.
+ * @return Allocated block (nullptr if the arena is full).
+ * @~japanese
+ * @brief ノードの子ノードとOwnership用のブロックのメモリ領域からの割り当て
+ * nullptrを返したら探索木が埋まっているので, 呼び出し側は展開をやめる
+ * @param[in] child_num 子ノードの個数
+ * @param[out] size 割り当てたブロックの大きさ
+ * @return 割り当てたブロック (メモリ領域が埋まっていればnullptr)
+ */
+void *
+AllocateNodeBlock( const int child_num, size_t &size )
+{
+  size = CalculateNodeBlockSize(child_num);
+
+  return AllocateNodeArena(size);
+}
+
+
+/**
+ * @~english
+ * @brief Set a block allocated by AllocateNodeBlock to a node.
+ * @param[in, out] node MCTS node.
+ * @param[in] child_num The number of child nodes.
+ * @param[in] block Block allocated by AllocateNodeBlock.
+ * @param[in] size Size of the block.
+ * @~japanese
+ * @brief AllocateNodeBlockで割り当てたブロックのノードへの設定
+ * @param[in, out] node MCTSノード
+ * @param[in] child_num 子ノードの個数
+ * @param[in] block AllocateNodeBlockで割り当てたブロック
+ * @param[in] size ブロックの大きさ
+ */
+void
+SetNodeBlock( uct_node_t &node, const int child_num, void *block, const size_t size )
+{
+  ReleaseNodeBlock(node);
+
+  // 子ノードの情報, Ownership, Ownershipのカウンタの順に置く
+  const size_t bits_num = 2 * OWNERSHIP_PLANES * bitboard_words;
+  const size_t ownership_size = sizeof(double) * pure_board_max + sizeof(unsigned long long) * bits_num;
+  const size_t child_size = CalculateNodeBlockSize(child_num) - ownership_size;
+  unsigned char *head = static_cast<unsigned char *>(block);
+
+  node.child = reinterpret_cast<child_node_t *>(head);
+  node.ownership = reinterpret_cast<double *>(head + child_size);
+  node.ownership_bits = reinterpret_cast<unsigned long long *>(node.ownership + pure_board_max);
+  node.block_size = size;
+  node.block_generation = GetNodeArenaGeneration();
+
+  std::fill_n(node.ownership, pure_board_max, 0.0);
+  std::fill_n(node.ownership_bits, bits_num, 0ULL);
+}
+
+
+/**
+ * @~english
+ * @brief Release children and ownership of a node to the node arena.
+ * @param[in, out] node MCTS node.
+ * @~japanese
+ * @brief ノードの子ノードとOwnershipのメモリ領域への返却
+ * @param[in, out] node MCTSノード
+ */
+void
+ReleaseNodeBlock( uct_node_t &node )
+{
+  // 全ブロックを解放した後の古いブロックはメモリ領域に返さない
+  if (HasNodeBlock(node)) {
+    FreeNodeArena(node.child, node.block_size);
+  }
+
+  node.child = nullptr;
+  node.ownership = nullptr;
+  node.ownership_bits = nullptr;
+  node.block_size = 0;
+}
+
+
+/**
+ * @~english
+ * @brief Check whether a node has a block of the current generation of the node arena.
+ * @param[in] node MCTS node.
+ * @return Check result.
+ * @~japanese
+ * @brief ノードがメモリ領域の現在の世代のブロックを持っているかの判定
+ * @param[in] node MCTSノード
+ * @return 判定結果
+ */
+bool
+HasNodeBlock( const uct_node_t &node )
+{
+  return node.child != nullptr && node.block_generation == GetNodeArenaGeneration();
+}
+
+
+/**
+ * @~english
+ * @brief Store seki flags as a bitset.
+ * @param[in, out] node MCTS node.
+ * @param[in] seki Seki flags.
+ * @~japanese
+ * @brief セキのフラグをビット集合で記録
+ * @param[in, out] node MCTSノード
+ * @param[in] seki セキのフラグ
+ */
+void
+SetSekiBits( uct_node_t &node, const bool seki[] )
+{
+  std::fill_n(node.seki, BITBOARD_WORDS, 0ULL);
+
+  for (int i = 0; i < pure_board_max; i++) {
+    if (seki[onboard_pos[i]]) {
+      node.seki[i >> 6] |= 1ULL << (i & 63);
+    }
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Expand the seki bitset into seki flags.
+ * @param[in] node MCTS node.
+ * @param[out] seki Seki flags.
+ * @~japanese
+ * @brief セキのビット集合をフラグに展開
+ * @param[in] node MCTSノード
+ * @param[out] seki セキのフラグ
+ */
+void
+CopySekiFlags( const uct_node_t &node, bool seki[] )
+{
+  std::fill_n(seki, BOARD_MAX, false);
+
+  for (int i = 0; i < bitboard_words; i++) {
+    unsigned long long bits = node.seki[i];
+    while (bits != 0) {
+      seki[onboard_pos[(i << 6) + LowestBit(bits)]] = true;
+      bits &= bits - 1;
+    }
+  }
 }
 
 
@@ -193,31 +363,106 @@ CalculateWinningRate( const child_node_t &child )
 
 /**
  * @~english
- * @brief Update Monte-Carlo ownership.
+ * @brief Add a bitboard to bit-sliced counters.
+ * @param[in, out] planes Bit planes of counters.
+ * @param[in] bits Bitboard to add.
+ * @~japanese
+ * @brief ビットスライスカウンタへのビットボードの加算
+ * @param[in, out] planes カウンタのビット平面
+ * @param[in] bits 加算するビットボード
+ */
+static void
+AddOwnershipBits( unsigned long long planes[], const unsigned long long bits[] )
+{
+  for (int i = 0; i < bitboard_words; i++) {
+    unsigned long long carry = bits[i];
+    // 下位の平面から繰り上がりが無くなるまで半加算する
+    for (int k = 0; k < OWNERSHIP_PLANES && carry != 0; k++) {
+      unsigned long long &plane = planes[k * bitboard_words + i];
+      const unsigned long long next = plane & carry;
+      plane ^= carry;
+      carry = next;
+    }
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Add values of bit-sliced counters to ownership.
+ * @param[in] planes Bit planes of counters.
+ * @param[in] weight Weight of a count.
+ * @param[in, out] ownership Ownership indexed by onboard_index.
+ * @~japanese
+ * @brief ビットスライスカウンタの値のOwnershipへの加算
+ * @param[in] planes カウンタのビット平面
+ * @param[in] weight 1回あたりの重み
+ * @param[in, out] ownership Ownership (onboard_indexで指定)
+ */
+static void
+AccumulateOwnershipBits( const unsigned long long planes[], const double weight, double ownership[] )
+{
+  for (int k = 0; k < OWNERSHIP_PLANES; k++) {
+    const double value = weight * (1 << k);
+    for (int i = 0; i < bitboard_words; i++) {
+      unsigned long long bits = planes[k * bitboard_words + i];
+      while (bits != 0) {
+        ownership[(i << 6) + LowestBit(bits)] += value;
+        bits &= bits - 1;
+      }
+    }
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Update Monte-Carlo ownership. Territory is counted in bit-sliced counters,
+ * and the counters are added to ownership once every OWNERSHIP_FLUSH_COUNT playouts.
  * @param[in, out] node MCTS node.
- * @param[in] game End position data.
- * @param[in] current_color Current player's color.
+ * @param[in] own_bits Bitboard of the current player's territory at the end of the playout.
+ * @param[in] neutral_bits Bitboard of intersections which are neither player's territory.
  * @~japanese
  * @brief モンテカルロ・シミュレーションのOwnershipの更新
+ * 領域はビットスライスカウンタで数え, OWNERSHIP_FLUSH_COUNT回に1回Ownershipに加算する
  * @param[in, out] node MCTSノード
- * @param[in] game 終局時の局面情報
- * @param[in] current_color 現在の手番の色
+ * @param[in] own_bits 終局時の手番の色の領域のビットボード
+ * @param[in] neutral_bits 終局時にどちらの領域でもない点のビットボード
  */
 void
-UpdateOwnership( uct_node_t &node, game_info_t *game, const int current_color )
+UpdateOwnership( uct_node_t &node, const unsigned long long own_bits[], const unsigned long long neutral_bits[] )
 {
-  const char *board = game->board;
+  unsigned long long *own_planes = node.ownership_bits;
+  unsigned long long *neutral_planes = node.ownership_bits + OWNERSHIP_PLANES * bitboard_words;
 
-  for (int i = 0; i < pure_board_max; i++) {
-    const int pos = onboard_pos[i];
-    int color = board[pos];
-
-    if (color == S_EMPTY) color = territory[Pat3(game->pat, pos)];
+  AddOwnershipBits(own_planes, own_bits);
+  AddOwnershipBits(neutral_planes, neutral_bits);
+  node.ownership_count++;
 
-    if (color == current_color) {
-      node.ownership[pos] += 1.0;
-    } else if (color == S_EMPTY) {
-      node.ownership[pos] += 0.5;
-    }
+  // カウンタが溢れる前にOwnershipに移す
+  if (++node.ownership_pending == OWNERSHIP_FLUSH_COUNT) {
+    AccumulateOwnershipBits(own_planes, 1.0, node.ownership);
+    AccumulateOwnershipBits(neutral_planes, 0.5, node.ownership);
+    std::fill_n(node.ownership_bits, 2 * OWNERSHIP_PLANES * bitboard_words, 0ULL);
+    node.ownership_pending = 0;
   }
 }
+
+
+/**
+ * @~english
+ * @brief Calculate Monte-Carlo ownership including counts not added yet.
+ * @param[in] node MCTS node.
+ * @param[out] ownership Ownership indexed by onboard_index.
+ * @~japanese
+ * @brief まだ加算していない分も含めたモンテカルロ・シミュレーションのOwnershipの計算
+ * @param[in] node MCTSノード
+ * @param[out] ownership Ownership (onboard_indexで指定)
+ */
+void
+CalculateOwnership( const uct_node_t &node, double ownership[] )
+{
+  std::copy_n(node.ownership, pure_board_max, ownership);
+  AccumulateOwnershipBits(node.ownership_bits, 1.0, ownership);
+  AccumulateOwnershipBits(node.ownership_bits + OWNERSHIP_PLANES * bitboard_words, 0.5, ownership);
+}
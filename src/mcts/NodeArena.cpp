@@ -0,0 +1,300 @@
+/**
+ * @file src/mcts/NodeArena.cpp
+ * @author Yuki Kobayashi
+ * @~english
+ * @brief Memory arena for variable size data of MCTS nodes.
+ * @~japanese
+ * @brief MCTSノードの可変長データ用のメモリ領域
+ */
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "mcts/NodeArena.hpp"
+#include "util/Numa.hpp"
+
+
+/**
+ * @~english
+ * @brief Raw memory of the arena.
+ * @~japanese
+ * @brief メモリ領域の確保したままの先頭
+ */
+static unsigned char *arena_memory = nullptr;
+
+/**
+ * @~english
+ * @brief Head of the arena aligned to cache line.
+ * @~japanese
+ * @brief キャッシュラインに揃えたメモリ領域の先頭
+ */
+static unsigned char *arena_base = nullptr;
+
+/**
+ * @~english
+ * @brief Size of the arena.
+ * @~japanese
+ * @brief メモリ領域の大きさ
+ */
+static size_t arena_size = 0;
+
+/**
+ * @~english
+ * @brief Offset of memory which has never been allocated.
+ * @~japanese
+ * @brief まだ一度も割り当てていない部分の先頭のオフセット
+ */
+static std::atomic<size_t> arena_top(0);
+
+/**
+ * @~english
+ * @brief Limitation of arena_top for searching.
+ * @~japanese
+ * @brief 探索を続けられるarena_topの上限値
+ */
+static size_t arena_limit = 0;
+
+/**
+ * @~english
+ * @brief Amount of allocated memory. It is updated under mutex_arena, and read without it.
+ * @~japanese
+ * @brief 割り当て中のメモリ量 (mutex_arenaの下で更新し, ロックを取らずに読む)
+ */
+static std::atomic<size_t> arena_used(0);
+
+/**
+ * @~english
+ * @brief Flag that an allocation failed because the arena is full.
+ * @~japanese
+ * @brief メモリ領域が埋まって割り当てに失敗したフラグ
+ */
+static std::atomic<bool> arena_exhausted(false);
+
+/**
+ * @~english
+ * @brief Generation of the arena. It is advanced whenever all blocks are released.
+ * @~japanese
+ * @brief メモリ領域の世代 (全ブロックを解放するたびに進める)
+ */
+static unsigned int arena_generation = 0;
+
+/**
+ * @~english
+ * @brief Offsets of free blocks for each block size (the number of lines).
+ * @~japanese
+ * @brief ブロックの大きさ (ライン数) ごとの空きブロックのオフセット
+ */
+static std::vector<std::vector<size_t> > free_blocks;
+
+/**
+ * @~english
+ * @brief Mutex variable for allocation and release.
+ * @~japanese
+ * @brief 割り当てと解放を排他処理するためのミューテックス変数
+ */
+static std::mutex mutex_arena;
+
+
+/**
+ * @~english
+ * @brief Allocate memory of the arena.
+ * @param[in] size Size of the arena.
+ * @~japanese
+ * @brief メモリ領域の確保
+ * @param[in] size メモリ領域の大きさ
+ */
+void
+InitializeNodeArena( const size_t size )
+{
+  delete[] arena_memory;
+
+  arena_size = (size + NODE_ARENA_LINE_SIZE - 1) / NODE_ARENA_LINE_SIZE * NODE_ARENA_LINE_SIZE;
+  arena_memory = new (std::nothrow) unsigned char[arena_size + NODE_ARENA_LINE_SIZE];
+
+  if (arena_memory == nullptr) {
+    std::cerr << "Cannot allocate memory !!" << std::endl;
+    std::cerr << "You must reduce tree size !!" << std::endl;
+    exit(1);
+  }
+
+  // 確保した領域の中でキャッシュラインの境界に揃える
+  const uintptr_t address = reinterpret_cast<uintptr_t>(arena_memory);
+  const uintptr_t offset = (NODE_ARENA_LINE_SIZE - address % NODE_ARENA_LINE_SIZE) % NODE_ARENA_LINE_SIZE;
+  arena_base = arena_memory + offset;
+  arena_limit = arena_size / 10 * 9;
+
+  ClearNodeArena();
+}
+
+
+/**
+ * @~english
+ * @brief Interleave the arena over all NUMA nodes. It must be called before any block is allocated.
+ * @~japanese
+ * @brief メモリ領域を全NUMAノードに交互に配置する (ブロックを割り当てる前に呼び出す)
+ */
+void
+InterleaveNodeArena( void )
+{
+  InterleaveMemory(arena_base, arena_size);
+}
+
+
+/**
+ * @~english
+ * @brief Release all blocks. Blocks allocated before it belong to an old generation
+ * and must not be passed to FreeNodeArena.
+ * @~japanese
+ * @brief 全ブロックの解放
+ * これより前に割り当てたブロックは古い世代になるので, FreeNodeArenaに渡してはいけない
+ */
+void
+ClearNodeArena( void )
+{
+  arena_generation++;
+  arena_top = 0;
+  arena_used = 0;
+  arena_exhausted = false;
+  for (std::vector<size_t> &blocks : free_blocks) {
+    blocks.clear();
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Allocate a block. The smallest free block which is large enough is reused,
+ * and new memory is taken from the top of the arena only when there is no such block.
+ * It can be called from multiple threads.
+ * @param[in, out] size Requested size, and size of the allocated block.
+ * @return Allocated block (nullptr if the arena is full).
+ * @~japanese
+ * @brief ブロックの割り当て
+ * 足りる大きさの空きブロックのうち最小のものを再利用し,
+ * 無い時だけメモリ領域の未使用部分から切り出す (複数のスレッドから呼び出せる)
+ * @param[in, out] size 要求する大きさ, 割り当てたブロックの大きさ
+ * @return 割り当てたブロック (メモリ領域が埋まっていればnullptr)
+ */
+void *
+AllocateNodeArena( size_t &size )
+{
+  const size_t lines = (size + NODE_ARENA_LINE_SIZE - 1) / NODE_ARENA_LINE_SIZE;
+  std::lock_guard<std::mutex> lock(mutex_arena);
+
+  for (size_t i = lines; i < free_blocks.size(); i++) {
+    if (!free_blocks[i].empty()) {
+      const size_t offset = free_blocks[i].back();
+      free_blocks[i].pop_back();
+      size = i * NODE_ARENA_LINE_SIZE;
+      arena_used += size;
+      return arena_base + offset;
+    }
+  }
+
+  size = lines * NODE_ARENA_LINE_SIZE;
+
+  if (arena_top + size > arena_size) {
+    arena_exhausted = true;
+    return nullptr;
+  }
+
+  const size_t offset = arena_top;
+  arena_top += size;
+  arena_used += size;
+
+  return arena_base + offset;
+}
+
+
+/**
+ * @~english
+ * @brief Release a block.
+ * @param[in] block Block to release.
+ * @param[in] size Size of the block returned by AllocateNodeArena.
+ * @~japanese
+ * @brief ブロックの解放
+ * @param[in] block 解放するブロック
+ * @param[in] size AllocateNodeArenaが返したブロックの大きさ
+ */
+void
+FreeNodeArena( void *block, const size_t size )
+{
+  const size_t lines = size / NODE_ARENA_LINE_SIZE;
+  std::lock_guard<std::mutex> lock(mutex_arena);
+
+  if (free_blocks.size() <= lines) {
+    free_blocks.resize(lines + 1);
+  }
+
+  free_blocks[lines].push_back(static_cast<unsigned char *>(block) - arena_base);
+  arena_used -= size;
+  arena_exhausted = false;
+}
+
+
+/**
+ * @~english
+ * @brief Check whether the arena has enough free memory to continue searching.
+ * Once the top reaches the limit, at least half of the limit must be in free blocks.
+ * It has no room after an allocation fails until a block is released.
+ * @return Enough free memory flag.
+ * @~japanese
+ * @brief 探索を続けられるだけの余裕がメモリ領域にあるかの確認
+ * 未使用部分が上限に達した後は, 上限の半分以上が空きブロックになっていれば余裕があるとする
+ * 割り当てに失敗した後は, ブロックが解放されるまで余裕がないとする
+ * @return 余裕があればtrue
+ */
+bool
+CheckRemainingNodeArena( void )
+{
+  return !arena_exhausted && (arena_top <= arena_limit || arena_used <= arena_limit / 2);
+}
+
+
+/**
+ * @~english
+ * @brief Get size of the arena.
+ * @return Size of the arena.
+ * @~japanese
+ * @brief メモリ領域の大きさの取得
+ * @return メモリ領域の大きさ
+ */
+size_t
+GetNodeArenaSize( void )
+{
+  return arena_size;
+}
+
+
+/**
+ * @~english
+ * @brief Get amount of allocated memory.
+ * @return Amount of allocated memory.
+ * @~japanese
+ * @brief 割り当て中のメモリ量の取得
+ * @return 割り当て中のメモリ量
+ */
+size_t
+GetNodeArenaUsedSize( void )
+{
+  return arena_used;
+}
+
+
+/**
+ * @~english
+ * @brief Get the generation of the arena.
+ * @return Generation of the arena.
+ * @~japanese
+ * @brief メモリ領域の世代の取得
+ * @return メモリ領域の世代
+ */
+unsigned int
+GetNodeArenaGeneration( void )
+{
+  return arena_generation;
+}
@@ -22,10 +22,61 @@
 #include "feature/Nakade.hpp"
 //#include "feature/Semeai.hpp"
 #include "feature/SimulationFeature.hpp"
+#include "mcts/RateSampler.hpp"
 #include "mcts/Rating.hpp"
 #include "util/Utility.hpp"
 
 
+/**
+ * @enum RATING_UPDATE_KIND
+ * @~english
+ * @brief Kinds of rating updates in PartialRating.
+ * @~japanese
+ * @brief PartialRatingのレート更新の種類
+ */
+enum RATING_UPDATE_KIND {
+  UPDATE_CRITICAL,
+  UPDATE_DISTANCE_2,
+  UPDATE_DISTANCE_3,
+  UPDATE_DISTANCE_4,
+  UPDATE_DISTANCE_3_EDGE,
+  UPDATE_PATTERN,
+};
+
+
+/**
+ * @~english
+ * @brief Coordinates to update in PartialRating.
+ * @~japanese
+ * @brief PartialRatingで更新する座標の一覧
+ */
+struct rating_update_t {
+  /**
+   * @~english
+   * @brief The number of coordinates.
+   * @~japanese
+   * @brief 座標の個数
+   */
+  int num;
+
+  /**
+   * @~english
+   * @brief Coordinates.
+   * @~japanese
+   * @brief 座標
+   */
+  int pos[BOARD_MAX];
+
+  /**
+   * @~english
+   * @brief Kinds of updates.
+   * @~japanese
+   * @brief 更新の種類
+   */
+  unsigned char kind[BOARD_MAX];
+};
+
+
 /**
  * @~english
  * @brief 3x3 pattern gamma values.
@@ -236,13 +287,13 @@ int
 RatingMove( game_info_t *game, int color, std::mt19937_64 &mt )
 {
   long long *rate = game->rate[color - 1];
-  long long *sum_rate_row = game->sum_rate_row[color - 1];
+  long long *sum_rate_tree = game->sum_rate_tree[color - 1];
   long long *sum_rate = &game->sum_rate[color - 1];
-  int y, pos;
+  int pos;
   long long rand_num;
 
   // レートの部分更新
-  PartialRating(game, color, sum_rate, sum_rate_row, rate);
+  PartialRating(game, color, sum_rate, sum_rate_tree, rate);
 
   // 合法手を選択するまでループ
   while (true) {
@@ -253,28 +304,15 @@ RatingMove( game_info_t *game, int color, std::mt19937_64 &mt )
 
     rand_num = (mt() % (*sum_rate)) + 1;
 
-    // 縦方向の位置を求める
-    y = board_start;
-    while (rand_num > sum_rate_row[y]){
-      rand_num -= sum_rate_row[y++];
-    }
-
-    // 横方向の位置を求める
-    pos = POS(board_start, y);
-    do {
-      rand_num -= rate[pos];
-      if (rand_num <= 0) break;
-      pos++;
-    } while (true);
+    // 累積のレートが乱数に達する座標を求める
+    pos = SampleRate(sum_rate_tree, rate, rand_num);
 
     // 選ばれた手が合法手ならループを抜け出し
     // そうでなければその箇所のレートを0にし, 手を選びなおす
     if (IsLegalNotEye(game, pos, color)) {
       break;
     } else {
-      *sum_rate -= rate[pos];
-      sum_rate_row[y] -= rate[pos];
-      rate[pos] = 0;
+      UpdateRate(sum_rate, sum_rate_tree, rate, pos, 0);
     }
   }
 
@@ -321,373 +359,198 @@ Neighbor12( const int previous_move, int distance_2[], int distance_3[], int dis
 
 /**
  * @~english
- * @brief Update neighbor intesections from previous move.
- * @param[in] game Board position data.
- * @param[in] color Player's color.
- * @param[in, out] sum_rate Total rate value.
- * @param[in, out] sum_rate_row Total rate value for each rows.
- * @param[in, out] rate Rate value for each coordinates.
- * @param[in] update Update point.
- * @param[in, out] flag Already updated flag.
- * @param[in] index Specific process index.
+ * @brief Start a new list of coordinates to update.
+ * @param[in, out] game Board position data.
+ * @param[out] update Coordinates to update.
  * @~japanese
- * @brief 直前の着手の周辺の更新
- * @param[in] game 局面情報
- * @param[in] color 手番の色
- * @param[in, out] sum_rate レートの合計値
- * @param[in, out] sum_rate_row 各行のレートの合計値
- * @param[in, out] rate 各座標のレート
- * @param[in] update 更新箇所
- * @param[in, out] flag 更新済フラグ
- * @param[in] index 特別処理インデックス
+ * @brief 更新する座標の一覧の初期化
+ * @param[in, out] game 局面情報
+ * @param[out] update 更新する座標の一覧
  */
 static void
-UpdateAroundPreviousMove( game_info_t *game, int color, long long *sum_rate, long long *sum_rate_row, long long *rate, int *update, bool *flag, int index )
+ClearRatingUpdate( game_info_t *game, rating_update_t *update )
 {
-  double bias[4] = {1.0, 1.0, 1.0, 1.0};
-
-  // 盤端での特殊処理
-  if (index == 1) {
-    const int pos = game->record[game->moves - 1].pos;
-    if ((border_dis_x[pos] == 1 && border_dis_y[pos] == 2) ||
-        (border_dis_x[pos] == 2 && border_dis_y[pos] == 1)) {
-      for (int i = 0; i < 4; i++) {
-        if ((border_dis_x[update[i]] == 1 && border_dis_y[update[i]] == 2) ||
-            (border_dis_x[update[i]] == 2 && border_dis_y[update[i]] == 1)) {
-          bias[i] = 1000.0;
-          break;
-        }
-      }
-    }
+  // 印が一周する前に消去する
+  if (game->rating_stamp_count >= UINT_MAX - 2) {
+    std::fill_n(game->rating_stamp, BOARD_MAX, 0u);
+    game->rating_stamp_count = 0;
   }
 
-  for (int i = 0; i < 4; i++) {
-    const int pos = update[i];
-    if (game->candidates[pos]){
-      if (flag[pos] && bias[i] == 1.0) continue;
-      const bool self_atari_flag = CheckSelfAtariForSimulation(game, color, pos);
-
-      // 元あったレートを消去
-      *sum_rate -= rate[pos];
-      sum_rate_row[board_y[pos]] -= rate[pos];
-
-      if (!self_atari_flag){
-        rate[pos] = 0;
-      } else {
-        CheckCaptureAndAtariForSimulation(game, color, pos);
-        const double gamma = po_pattern[MD2(game->pat, pos)]
-          * po_previous_distance[index]
-          * CalculateTacticalFeatures(&game->tactical_features[pos * ALL_MAX])
-          * bias[i];
-        rate[pos] = static_cast<long long>(gamma) + 1;
-
-        // 新たに計算したレートを代入
-        *sum_rate += rate[pos];
-        sum_rate_row[board_y[pos]] += rate[pos];
-      }
-    }
-    ClearTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
-    flag[pos] = true;
-  }
+  game->rating_stamp_count += 2;
+  update->num = 0;
 }
 
 
 /**
  * @~english
- * @brief Update critical intesections.
- * @param[in] game Board position data.
- * @param[in] color Player's color.
- * @param[in, out] sum_rate Total rate value.
- * @param[in, out] sum_rate_row Total rate value for each rows.
- * @param[in, out] rate Rate value for each coordinates.
- * @param[in] update_pos Update point.
- * @param[in] update_num The number of update points.
- * @param[in, out] flag Already updated flag.
- * @param[in] pm1 Previous move's coordinate.
+ * @brief Add a coordinate to the list unless it is already in the list.
+ * @param[in, out] game Board position data.
+ * @param[in, out] update Coordinates to update.
+ * @param[in] pos Coordinate.
+ * @param[in] kind Kind of the update.
  * @~japanese
- * @brief 重要な箇所のレートの更新
- * @param[in] game 局面情報
- * @param[in] color 手番の色
- * @param[in, out] sum_rate レートの合計値
- * @param[in, out] sum_rate_row 各行のレートの合計値
- * @param[in, out] rate 各座標のレート
- * @param[in] update_pos 更新箇所
- * @param[in] update_num 更新箇所の個数
- * @param[in, out] flag 更新済フラグ
- * @param[in] pm1 直前の着手の座標
+ * @brief 一覧に含まれていない座標の追加
+ * @param[in, out] game 局面情報
+ * @param[in, out] update 更新する座標の一覧
+ * @param[in] pos 座標
+ * @param[in] kind 更新の種類
  */
 static void
-UpdateCriticalPoint( game_info_t *game, int color, long long *sum_rate, long long sum_rate_row[], long long rate[], int update_pos[], int update_num, bool *flag, int pm1 )
+AddRatingUpdate( game_info_t *game, rating_update_t *update, const int pos, const int kind )
 {
-  double gamma;
-
-  for (int i = 0; i < update_num; i++) {
-    const int pos = update_pos[i];
-    if (pos != NOT_NAKADE && game->candidates[pos]){
-      const bool self_atari_flag = CheckSelfAtariForSimulation(game, color, pos);
-
-      // 元あったレートを消去
-      *sum_rate -= rate[pos];
-      sum_rate_row[board_y[pos]] -= rate[pos];
-
-      if (!self_atari_flag) {
-        rate[pos] = 0;
-      } else {
-        CheckCaptureAndAtariForSimulation(game, color, pos);
-        const int dis = DIS(pm1, pos);
-        if (dis < 5) {
-          gamma = 10000.0 * po_previous_distance[dis - 2];
-        } else {
-          gamma = 10000.0;
-        }
-        gamma *= po_pattern[MD2(game->pat, pos)];
-        gamma *= CalculateTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
-        rate[pos] = static_cast<long long>(gamma) + 1;
+  if (game->rating_stamp[pos] >= game->rating_stamp_count) return;
 
-        // 新たに計算したレートを代入      
-        *sum_rate += rate[pos];
-        sum_rate_row[board_y[pos]] += rate[pos];     
-      }
-      ClearTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
-      flag[pos] = true;
-    }
-  }
+  game->rating_stamp[pos] = game->rating_stamp_count;
+  update->pos[update->num] = pos;
+  update->kind[update->num++] = static_cast<unsigned char>(kind);
 }
 
 
 /**
  * @~english
- * @brief Update intesections' rating.
- * @param[in] game Board position data.
- * @param[in] color Player's color.
- * @param[in, out] sum_rate Total rate value.
- * @param[in, out] sum_rate_row Total rate value for each rows.
- * @param[in, out] rate Rate value for each coordinates.
- * @param[in] update Update point.
- * @param[in] update_num The number of update points.
- * @param[in, out] flag Already updated flag.
+ * @brief Add coordinates within MD2 of a coordinate to the list.
+ * @param[in, out] game Board position data.
+ * @param[in, out] update Coordinates to update.
+ * @param[in] center Center coordinate.
  * @~japanese
- * @brief レートの更新
- * @param[in] game 局面情報
- * @param[in] color 手番の色
- * @param[in, out] sum_rate レートの合計値
- * @param[in, out] sum_rate_row 各行のレートの合計値
- * @param[in, out] rate 各座標のレート
- * @param[in] update 更新箇所
- * @param[in] update_num 更新箇所の個数
- * @param[in, out] flag 更新済フラグ
+ * @brief MD2パターンの範囲内の座標の一覧への追加
+ * @param[in, out] game 局面情報
+ * @param[in, out] update 更新する座標の一覧
+ * @param[in] center 中心の座標
  */
 static void
-OtherUpdate( game_info_t *game, int color, long long *sum_rate, long long sum_rate_row[], long long rate[], int update_num, int update[], bool flag[] )
+AddNeighborRatingUpdates( game_info_t *game, rating_update_t *update, const int center )
 {
-  for (int i = 0; i < update_num; i++) {
-    const int pos = update[i];
-    if (flag[pos]) continue;
-
-    if (game->candidates[pos]) {
-      const bool self_atari_flag = CheckSelfAtariForSimulation(game, color, pos);
-
-      // 元あったレートを消去
-      *sum_rate -= rate[pos];
-      sum_rate_row[board_y[pos]] -= rate[pos];
-
-      // パターン、戦術的特徴、距離のγ値
-      if (!self_atari_flag) {
-        rate[pos] = 0;
-      } else {
-        CheckCaptureAndAtariForSimulation(game, color, pos);
-        const double gamma = po_pattern[MD2(game->pat, pos)]
-          * CalculateTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
-        rate[pos] = static_cast<long long>(gamma) + 1;
+  // 既に周辺を加えた座標は飛ばす
+  if (game->rating_stamp[center] == game->rating_stamp_count + 1) return;
 
-        // 新たに計算したレートを代入
-        *sum_rate += rate[pos];
-        sum_rate_row[board_y[pos]] += rate[pos];
-      }
-    }
-    ClearTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
-    // 更新済みフラグを立てる
-    flag[pos] = true;
+  for (int i = 0; i < UPDATE_NUM; i++) {
+    AddRatingUpdate(game, update, center + neighbor[i], UPDATE_PATTERN);
   }
+
+  game->rating_stamp[center] = game->rating_stamp_count + 1;
 }
 
 
 /**
  * @~english
- * @brief Update intesections' rating within MD2.
- * @param[in] game Board position data.
- * @param[in] color Player's color.
- * @param[in, out] sum_rate Total rate value.
- * @param[in, out] sum_rate_row Total rate value for each rows.
- * @param[in, out] rate Rate value for each coordinates.
- * @param[in] update_num The number of update points.
- * @param[in] update Update point.
- * @param[in, out] flag Already updated flag.
+ * @brief Add neighbor intesections from previous move to the list.
+ * @param[in, out] game Board position data.
+ * @param[in, out] update Coordinates to update.
+ * @param[in] pm1 Previous move's coordinate.
  * @~japanese
- * @brief MD2パターンの範囲内のレートの更新
- * @param[in] game 局面情報
- * @param[in] color 手番の色
- * @param[in, out] sum_rate レートの合計値
- * @param[in, out] sum_rate_row 各行のレートの合計値
- * @param[in, out] rate 各座標のレート
- * @param[in] update_num 更新箇所の個数
- * @param[in] update 更新箇所
- * @param[in, out] flag 更新済フラグ
+ * @brief 直前の着手の周辺の座標の一覧への追加
+ * @param[in, out] game 局面情報
+ * @param[in, out] update 更新する座標の一覧
+ * @param[in] pm1 直前の着手の座標
  */
 static void
-UpdateNeighborCoordinates( game_info_t *game, int color, long long *sum_rate, long long sum_rate_row[], long long rate[], int update_num, int update[], bool flag[] )
+AddAroundPreviousMove( game_info_t *game, rating_update_t *update, const int pm1 )
 {
-  for (int i = 0; i < update_num; i++) {
-    for (int j = 0; j < UPDATE_NUM; j++) {
-      const int pos = update[i] + neighbor[j];
-      if (flag[pos]) continue;
-
-      if (game->candidates[pos]) {
-        const bool self_atari_flag = CheckSelfAtariForSimulation(game, color, pos);
-
-        // 元あったレートを消去
-        *sum_rate -= rate[pos];
-        sum_rate_row[board_y[pos]] -= rate[pos];
-
-        // パターン、戦術的特徴、距離のγ値
-        if (!self_atari_flag){
-          rate[pos] = 0;
-        } else {
-          CheckCaptureAndAtariForSimulation(game, color, pos);
-          const double gamma = po_pattern[MD2(game->pat, pos)]
-            * CalculateTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
-          rate[pos] = static_cast<long long>(gamma) + 1;
+  int distance_2[4], distance_3[4], distance_4[4];
+  int edge = -1;
 
-          // 新たに計算したレートを代入
-          *sum_rate += rate[pos];
-          sum_rate_row[board_y[pos]] += rate[pos];
-        }
+  Neighbor12(pm1, distance_2, distance_3, distance_4);
 
+  // 盤端での特殊処理
+  if ((border_dis_x[pm1] == 1 && border_dis_y[pm1] == 2) ||
+      (border_dis_x[pm1] == 2 && border_dis_y[pm1] == 1)) {
+    for (int i = 0; i < 4; i++) {
+      if ((border_dis_x[distance_3[i]] == 1 && border_dis_y[distance_3[i]] == 2) ||
+          (border_dis_x[distance_3[i]] == 2 && border_dis_y[distance_3[i]] == 1)) {
+        edge = distance_3[i];
+        break;
       }
-      ClearTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
-      // 更新済みフラグを立てる
-      flag[pos] = true;
     }
   }
-}
-
-
-/**
- * @~english
- * @brief Update intesections' rating within MD2.
- * @param[in] game Board position data.
- * @param[in] color Player's color.
- * @param[in, out] sum_rate Total rate value.
- * @param[in, out] sum_rate_row Total rate value for each rows.
- * @param[in, out] rate Rate value for each coordinates.
- * @param[in] update Update point.
- * @param[in, out] flag Already updated flag.
- * @~japanese
- * @brief MD2パターンの範囲内のレートの更新
- * @param[in] game 局面情報
- * @param[in] color 手番の色
- * @param[in, out] sum_rate レートの合計値
- * @param[in, out] sum_rate_row 各行のレートの合計値
- * @param[in, out] rate 各座標のレート
- * @param[in] update 更新箇所
- * @param[in, out] flag 更新済フラグ
- */
-static void
-CaptureUpdateColor( game_info_t *game, const int color, long long *sum_rate, long long sum_rate_row[], long long rate[], int update[], bool flag[] )
-{
-  int update_pos = update[0];
-
-  while (update_pos < CAPTURE_END) {
-    for (int i = 0; i < UPDATE_NUM; i++) {
-      const int pos = update_pos + neighbor[i];
-      if (flag[pos]) continue;
-
-      if (game->candidates[pos]) {
-        const bool self_atari_flag = CheckSelfAtariForSimulation(game, color, pos);
-
-        // 元あったレートを消去
-        *sum_rate -= rate[pos];
-        sum_rate_row[board_y[pos]] -= rate[pos];
 
-        // パターン、戦術的特徴、距離のγ値
-        if (!self_atari_flag) {
-          rate[pos] = 0;
-        } else {
-          CheckCaptureAndAtariForSimulation(game, color, pos);
-          const double gamma = po_pattern[MD2(game->pat, pos)] * CalculateTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
-          rate[pos] = static_cast<long long>(gamma) + 1;
+  // 着手距離2の座標
+  for (int i = 0; i < 4; i++) {
+    AddRatingUpdate(game, update, distance_2[i], UPDATE_DISTANCE_2);
+  }
 
-          // 新たに計算したレートを代入
-          *sum_rate += rate[pos];
-          sum_rate_row[board_y[pos]] += rate[pos];
-        }
+  // 着手距離3の座標
+  // 盤端の特殊処理の座標は, 重要な箇所として加えてあっても補正したγ値で更新し直す
+  if (edge != -1 && game->rating_stamp[edge] >= game->rating_stamp_count) {
+    for (int i = 0; i < update->num; i++) {
+      if (update->pos[i] == edge) {
+        update->kind[i] = UPDATE_DISTANCE_3_EDGE;
+        ClearTacticalFeatures(&game->tactical_features[edge * ALL_MAX]);
+        break;
       }
-      // 更新済みフラグを立てる
-      ClearTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
-      flag[pos] = true;
     }
-    const int next_pos = update[update_pos];
-    update[update_pos] = 0;
-    update_pos = next_pos;
+  }
+  for (int i = 0; i < 4; i++) {
+    AddRatingUpdate(game, update, distance_3[i], distance_3[i] == edge ? UPDATE_DISTANCE_3_EDGE : UPDATE_DISTANCE_3);
+  }
+
+  // 着手距離4の座標
+  for (int i = 0; i < 4; i++) {
+    AddRatingUpdate(game, update, distance_4[i], UPDATE_DISTANCE_4);
   }
 }
 
 
 /**
  * @~english
- * @brief Update intesections' rating within MD2.
+ * @brief Update rating values of coordinates in the list.
  * @param[in] game Board position data.
  * @param[in] color Player's color.
  * @param[in, out] sum_rate Total rate value.
- * @param[in, out] sum_rate_row Total rate value for each rows.
+ * @param[in, out] sum_rate_tree Sums of rate values in the rate tree.
  * @param[in, out] rate Rate value for each coordinates.
- * @param[in] update Update point.
- * @param[in, out] flag Already updated flag.
+ * @param[in] update Coordinates to update.
+ * @param[in] pm1 Previous move's coordinate.
  * @~japanese
- * @brief MD2パターンの範囲内のレートの更新
+ * @brief 一覧の座標のレートの更新
  * @param[in] game 局面情報
  * @param[in] color 手番の色
  * @param[in, out] sum_rate レートの合計値
- * @param[in, out] sum_rate_row 各行のレートの合計値
+ * @param[in, out] sum_rate_tree レートの木の合計値
  * @param[in, out] rate 各座標のレート
- * @param[in] update 更新箇所
- * @param[in, out] flag 更新済フラグ
+ * @param[in] update 更新する座標の一覧
+ * @param[in] pm1 直前の着手の座標
  */
 static void
-CaptureUpdateOther( game_info_t *game, const int color, long long *sum_rate, long long sum_rate_row[], long long rate[], int update[], bool flag[] )
+UpdateRatingList( game_info_t *game, int color, long long *sum_rate, long long sum_rate_tree[], long long rate[], const rating_update_t *update, const int pm1 )
 {
-  int update_pos = update[0];
-
-  while (update_pos < CAPTURE_END) {
-    for (int i = 0; i < UPDATE_NUM; i++) {
-      const int pos = update_pos + neighbor[i];
-      if (flag[pos]) continue;
+  double gamma;
 
-      if (game->candidates[pos]) {
-        const bool self_atari_flag = CheckSelfAtariForSimulation(game, color, pos);
+  for (int i = 0; i < update->num; i++) {
+    const int pos = update->pos[i];
+    const int kind = update->kind[i];
 
-        // 元あったレートを消去
-        *sum_rate -= rate[pos];
-        sum_rate_row[board_y[pos]] -= rate[pos];
+    if (game->candidates[pos]) {
+      const bool self_atari_flag = CheckSelfAtariForSimulation(game, color, pos);
 
+      if (!self_atari_flag) {
+        UpdateRate(sum_rate, sum_rate_tree, rate, pos, 0);
+      } else {
+        CheckCaptureAndAtariForSimulation(game, color, pos);
         // パターン、戦術的特徴、距離のγ値
-        if (!self_atari_flag) {
-          rate[pos] = 0;
+        if (kind == UPDATE_CRITICAL) {
+          const int dis = DIS(pm1, pos);
+          if (dis < 5) {
+            gamma = 10000.0 * po_previous_distance[dis - 2];
+          } else {
+            gamma = 10000.0;
+          }
+          gamma *= po_pattern[MD2(game->pat, pos)];
+          gamma *= CalculateTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
+        } else if (kind == UPDATE_PATTERN) {
+          gamma = po_pattern[MD2(game->pat, pos)]
+            * CalculateTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
         } else {
-          CheckCaptureAndAtariForSimulation(game, color, pos);
-          const double gamma = po_pattern[MD2(game->pat, pos)] * CalculateTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
-          rate[pos] = static_cast<long long>(gamma) + 1;
-
-          // 新たに計算したレートを代入
-          *sum_rate += rate[pos];
-          sum_rate_row[board_y[pos]] += rate[pos];
+          const int index = kind == UPDATE_DISTANCE_3_EDGE ? 1 : kind - UPDATE_DISTANCE_2;
+          gamma = po_pattern[MD2(game->pat, pos)]
+            * po_previous_distance[index]
+            * CalculateTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
+          if (kind == UPDATE_DISTANCE_3_EDGE) gamma *= 1000.0;
         }
+        UpdateRate(sum_rate, sum_rate_tree, rate, pos, static_cast<long long>(gamma) + 1);
       }
-      // 更新済みフラグを立てる
-      ClearTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
-      flag[pos] = true;
     }
-    update_pos = update[update_pos];
+    ClearTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
   }
 }
 
@@ -695,41 +558,42 @@ CaptureUpdateOther( game_info_t *game, const int color, long long *sum_rate, lon
 /**
  * @~english
  * @brief Update rating value for intersections must be updated.
+ * Every coordinate to update is added to one list once, and the first kind added decides its gamma value.
  * @param[in, out] game Board position data.
  * @param[in] color Player's color.
  * @param[in, out] sum_rate Total rate value.
- * @param[in, out] sum_rate_row Total rate value for each rows.
+ * @param[in, out] sum_rate_tree Sums of rate values in the rate tree.
  * @param[in, out] rate Rate value for each coordinates.
  * @~japanese
  * @brief レートの部分更新
+ * 更新する座標は1つの一覧に1度だけ加え, 最初に加えた種類でγ値を決める
  * @param[in] game 局面情報
  * @param[in] color 手番の色
  * @param[in, out] sum_rate レートの合計値
- * @param[in, out] sum_rate_row 各行のレートの合計値
+ * @param[in, out] sum_rate_tree レートの木の合計値
  * @param[in, out] rate 各座標のレート
  */
 void
-PartialRating( game_info_t *game, int color, long long *sum_rate, long long *sum_rate_row, long long *rate )
+PartialRating( game_info_t *game, int color, long long *sum_rate, long long *sum_rate_tree, long long *rate )
 {
   const int other = GetOppositeColor(color);
-  int pm1 = PASS, pm2 = PASS, pm3 = PASS;
-  int distance_2[4], distance_3[4], distance_4[4];
-  bool flag[BOARD_MAX] = { false };  
+  int pm1 = PASS, pm3 = PASS;
   int *update_pos = game->update_pos[color - 1];
   int &update_num = game->update_num[color - 1];
   int nakade_pos[4] = { 0 };
   int nakade_num = 0;
   const int prev_feature = game->update_num[color - 1];
   int prev_feature_pos[PURE_BOARD_MAX];
+  rating_update_t update;
 
   for (int i = 0; i < prev_feature; i++){
     prev_feature_pos[i] = update_pos[i];
   }
 
   game->update_num[color - 1] = 0;
+  ClearRatingUpdate(game, &update);
 
   pm1 = game->record[game->moves - 1].pos;
-  if (game->moves > 2) pm2 = game->record[game->moves - 2].pos;
   if (game->moves > 3) pm3 = game->record[game->moves - 3].pos;
 
   if (game->ko_move == game->moves - 2){
@@ -737,36 +601,43 @@ PartialRating( game_info_t *game, int color, long long *sum_rate, long long *sum
   }
 
   if (pm1 != PASS) {
-    Neighbor12(pm1, distance_2, distance_3, distance_4);
     CheckFeaturesForSimulation(game, color, update_pos, update_num);
     CheckRemove2StonesForSimulation(game, color, update_pos, update_num);
 
+    // 重要な箇所
     SearchNakade(game, &nakade_num, nakade_pos);
-    UpdateCriticalPoint(game, color, sum_rate, sum_rate_row, rate, nakade_pos, nakade_num, flag, pm1);
-    // 着手距離2の更新
-    UpdateAroundPreviousMove(game, color, sum_rate, sum_rate_row, rate, distance_2, flag, 0);
-    // 着手距離3の更新
-    UpdateAroundPreviousMove(game, color, sum_rate, sum_rate_row, rate, distance_3, flag, 1);
-    // 着手距離4の更新
-    UpdateAroundPreviousMove(game, color, sum_rate, sum_rate_row, rate, distance_4, flag, 2);
+    for (int i = 0; i < nakade_num; i++) {
+      if (nakade_pos[i] != NOT_NAKADE && game->candidates[nakade_pos[i]]) {
+        AddRatingUpdate(game, &update, nakade_pos[i], UPDATE_CRITICAL);
+      }
+    }
+    // 着手距離2, 3, 4の座標
+    AddAroundPreviousMove(game, &update, pm1);
+  }
+
+  // 前回の更新以降に石が置かれた, または打ち上げられた箇所の12近傍
+  for (int i = 0; i < game->dirty_num[color - 1]; i++) {
+    AddNeighborRatingUpdates(game, &update, game->dirty_pos[color - 1][i]);
   }
+  game->dirty_num[color - 1] = 0;
+  // 3手前の着手の12近傍
+  if (pm3 != PASS) AddNeighborRatingUpdates(game, &update, pm3);
 
-  // 2手前の着手の12近傍の更新
-  if (pm2 != PASS) UpdateNeighborCoordinates(game, color, sum_rate, sum_rate_row, rate, 1, &pm2, flag);
-  // 3手前の着手の12近傍の更新
-  if (pm3 != PASS) UpdateNeighborCoordinates(game, color, sum_rate, sum_rate_row, rate, 1, &pm3, flag);
-
-  // 以前の着手で戦術的特徴が現れた箇所の更新
-  OtherUpdate(game, color, sum_rate, sum_rate_row, rate, prev_feature, prev_feature_pos, flag);
-  // 最近の自分の着手の時に戦術的特徴が現れた箇所の更新
-  OtherUpdate(game, color, sum_rate, sum_rate_row, rate, game->update_num[color - 1], game->update_pos[color - 1], flag);
-  // 最近の相手の着手の時に戦術的特徴が現れた箇所の更新
-  OtherUpdate(game, color, sum_rate, sum_rate_row, rate, game->update_num[other - 1], game->update_pos[other - 1], flag);
-  // 自分の着手で石を打ち上げた箇所のとその周囲の更新
-  CaptureUpdateColor(game, color, sum_rate, sum_rate_row, rate, game->capture_pos[color - 1], flag);
-  // 相手の着手で石を打ち上げられた箇所とその周囲の更新
-  CaptureUpdateOther(game, color, sum_rate, sum_rate_row, rate, game->capture_pos[other - 1], flag);
+  // 以前の着手で戦術的特徴が現れた箇所
+  for (int i = 0; i < prev_feature; i++) {
+    AddRatingUpdate(game, &update, prev_feature_pos[i], UPDATE_PATTERN);
+  }
+  // 最近の自分の着手の時に戦術的特徴が現れた箇所
+  for (int i = 0; i < game->update_num[color - 1]; i++) {
+    AddRatingUpdate(game, &update, game->update_pos[color - 1][i], UPDATE_PATTERN);
+  }
+  // 最近の相手の着手の時に戦術的特徴が現れた箇所
+  for (int i = 0; i < game->update_num[other - 1]; i++) {
+    AddRatingUpdate(game, &update, game->update_pos[other - 1][i], UPDATE_PATTERN);
+  }
 
+  // 一覧の座標のレートを更新
+  UpdateRatingList(game, color, sum_rate, sum_rate_tree, rate, &update, pm1);
 }
 
 
@@ -776,22 +647,25 @@ PartialRating( game_info_t *game, int color, long long *sum_rate, long long *sum
  * @param[in, out] game Board position data.
  * @param[in] color Player's color.
  * @param[in, out] sum_rate Total rate value.
- * @param[in, out] sum_rate_row Total rate value for each rows.
+ * @param[in, out] sum_rate_tree Sums of rate values in the rate tree.
  * @param[in, out] rate Rate value for each coordinates.
  * @~japanese
  * @brief 全ての合法手のレートの計算
  * @param[in] game 局面情報
  * @param[in] color 手番の色
  * @param[in, out] sum_rate レートの合計値
- * @param[in, out] sum_rate_row 各行のレートの合計値
+ * @param[in, out] sum_rate_tree レートの木の合計値
  * @param[in, out] rate 各座標のレート
  */
 void
-Rating( game_info_t *game, int color, long long *sum_rate, long long *sum_rate_row, long long *rate )
+Rating( game_info_t *game, int color, long long *sum_rate, long long *sum_rate_tree, long long *rate )
 {
   const int pm1 = game->record[game->moves - 1].pos;
-  int update_num = 0;
-  int update_pos[PURE_BOARD_MAX];  
+  int *update_pos = game->update_pos[color - 1];
+  int &update_num = game->update_num[color - 1];
+
+  // 戦術的特徴が現れた箇所は次のPartialRatingで更新し直す
+  update_num = 0;
 
   for (int i = 0; i < pure_board_max; i++) {
     const int pos = onboard_pos[i];
@@ -823,11 +697,25 @@ Rating( game_info_t *game, int color, long long *sum_rate, long long *sum_rate_r
         rate[pos] = static_cast<long long>(gamma) + 1;
       }
 
-      *sum_rate += rate[pos];
-      sum_rate_row[board_y[pos]] += rate[pos];
+      AddRateToTree(sum_rate, sum_rate_tree, pos, rate[pos]);
     }
     ClearTacticalFeatures(&game->tactical_features[pos * ALL_MAX]);
   }
+
+  // 次のPartialRatingで更新する箇所として, この手番の直前の着手と打ち上げられた石を記録する
+  const bool own_last = game->record[game->moves - 1].color == color;
+  const int last = own_last ? game->moves - 1 : game->moves - 2;
+
+  game->dirty_num[color - 1] = 0;
+  if (last > 0 && game->record[last].pos != PASS) {
+    RecordDirtyPosition(game, color, game->record[last].pos);
+  }
+  for (int c = S_BLACK; c <= S_WHITE; c++) {
+    if (own_last && c != color) continue;
+    for (int tmp = game->capture_pos[c - 1][0]; tmp < CAPTURE_END; tmp = game->capture_pos[c - 1][tmp]) {
+      RecordDirtyPosition(game, color, tmp);
+    }
+  }
 }
 
 
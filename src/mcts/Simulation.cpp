@@ -6,59 +6,335 @@
  * @~japanese
  * @brief モンテカルロシミュレーション
  */
+#include <algorithm>
+#include <cstring>
 #include <random>
 
 #include "board/GoBoard.hpp"
 #include "board/Point.hpp"
+#include "board/String.hpp"
 #include "common/Message.hpp"
+#include "feature/SimulationFeature.hpp"
+#include "mcts/RateSampler.hpp"
 #include "mcts/Rating.hpp"
 #include "mcts/Simulation.hpp"
 
 
+/**
+ * @~english
+ * @brief Rating of the root position for both colors.
+ * @~japanese
+ * @brief 探索開始局面の両手番のレート
+ */
+struct root_rate_t {
+  /**
+   * @~english
+   * @brief Flag whether the rating is available.
+   * @~japanese
+   * @brief レートが使えるかのフラグ
+   */
+  bool valid;
+
+  /**
+   * @~english
+   * @brief Move number of the root position.
+   * @~japanese
+   * @brief 探索開始局面の手数
+   */
+  int moves;
+
+  /**
+   * @~english
+   * @brief Hash value of the root position.
+   * @~japanese
+   * @brief 探索開始局面のハッシュ値
+   */
+  unsigned long long hash;
+
+  /**
+   * @~english
+   * @brief Rate value for each coordinates.
+   * @~japanese
+   * @brief 各座標のレート
+   */
+  long long rate[2][BOARD_MAX];
+
+  /**
+   * @~english
+   * @brief Sums of rate values in the rate tree.
+   * @~japanese
+   * @brief レートの木の合計値
+   */
+  long long sum_rate_tree[2][RATE_TREE_SIZE];
+
+  /**
+   * @~english
+   * @brief Total rate value.
+   * @~japanese
+   * @brief レートの合計値
+   */
+  long long sum_rate[2];
+
+  /**
+   * @~english
+   * @brief The number of coordinates with tactical features.
+   * @~japanese
+   * @brief 戦術的特徴が現れた座標の個数
+   */
+  int update_num[2];
+
+  /**
+   * @~english
+   * @brief Coordinates with tactical features.
+   * @~japanese
+   * @brief 戦術的特徴が現れた座標
+   */
+  int update_pos[2][PURE_BOARD_MAX];
+
+  /**
+   * @~english
+   * @brief The number of coordinates to be updated by the first partial rating.
+   * @~japanese
+   * @brief 最初の部分更新で更新する座標の個数
+   */
+  int dirty_num[2];
+
+  /**
+   * @~english
+   * @brief Coordinates to be updated by the first partial rating.
+   * @~japanese
+   * @brief 最初の部分更新で更新する座標
+   */
+  int dirty_pos[2][PURE_BOARD_MAX + 2];
+};
+
+/**
+ * @~english
+ * @brief Rating of the root position.
+ * @~japanese
+ * @brief 探索開始局面のレート
+ */
+static root_rate_t root_rate;
+
+/**
+ * @~english
+ * @brief Difference of captured stones to finish a simulation (0 disables the mercy rule).
+ * @~japanese
+ * @brief シミュレーションを打ち切るアゲハマの差 (0なら打ち切らない)
+ */
+static int mercy_threshold = 0;
+
+/**
+ * @~english
+ * @brief Work area to rate the root position.
+ * @~japanese
+ * @brief 探索開始局面のレート計算用の局面
+ */
+static game_info_t *rating_game = nullptr;
+
+
+/**
+ * @~english
+ * @brief Set difference of captured stones to finish a simulation.
+ * @param[in] threshold Difference of captured stones (0 disables the mercy rule).
+ * @~japanese
+ * @brief シミュレーションを打ち切るアゲハマの差の設定
+ * @param[in] threshold アゲハマの差 (0なら打ち切らない)
+ */
+void
+SetMercyThreshold( const int threshold )
+{
+  mercy_threshold = threshold > 0 ? threshold : 0;
+}
+
+
+/**
+ * @~english
+ * @brief Rate the root position once per search. Simulations start from the copy of
+ * the rating and update only coordinates changed in the search tree.
+ * It must be called while no simulation is running.
+ * @param[in] game Root position data.
+ * @~japanese
+ * @brief 探索開始局面のレートを探索ごとに1度だけ計算する
+ * シミュレーションはこのレートのコピーから始め, 探索木の中で変化した箇所だけを更新する
+ * シミュレーションが動いていない間に呼び出すこと
+ * @param[in] game 探索開始局面の情報
+ */
+void
+SetSimulationRoot( const game_info_t *game )
+{
+  if (rating_game == nullptr) {
+    rating_game = AllocateGame();
+  }
+
+  CopyGame(rating_game, game);
+
+  std::fill_n(rating_game->sum_rate, 2, 0);
+  std::fill(rating_game->sum_rate_tree[0], rating_game->sum_rate_tree[2], 0);
+  std::fill(rating_game->rate[0], rating_game->rate[2], 0);
+
+  for (int color = S_BLACK; color <= S_WHITE; color++) {
+    Rating(rating_game, color, &rating_game->sum_rate[color - 1], rating_game->sum_rate_tree[color - 1], rating_game->rate[color - 1]);
+  }
+
+  root_rate.moves = game->moves;
+  root_rate.hash = game->record[game->moves - 1].hash;
+  memcpy(root_rate.rate,         rating_game->rate,         sizeof(root_rate.rate));
+  memcpy(root_rate.sum_rate_tree, rating_game->sum_rate_tree, sizeof(root_rate.sum_rate_tree));
+  memcpy(root_rate.sum_rate,     rating_game->sum_rate,     sizeof(root_rate.sum_rate));
+  memcpy(root_rate.update_num,   rating_game->update_num,   sizeof(root_rate.update_num));
+  memcpy(root_rate.update_pos,   rating_game->update_pos,   sizeof(root_rate.update_pos));
+  memcpy(root_rate.dirty_num,    rating_game->dirty_num,    sizeof(root_rate.dirty_num));
+  memcpy(root_rate.dirty_pos,    rating_game->dirty_pos,    sizeof(root_rate.dirty_pos));
+  root_rate.valid = true;
+}
+
+
+/**
+ * @~english
+ * @brief Copy the rating of the root position, and record coordinates changed in the search tree
+ * to be updated by PartialRating.
+ * @param[in, out] game Board position data reached from the root position.
+ * @return Whether the rating of the root position can be used.
+ * @~japanese
+ * @brief 探索開始局面のレートをコピーし, 探索木の中で変化した箇所をPartialRatingの更新対象に加える
+ * @param[in, out] game 探索開始局面から進めた局面の情報
+ * @return 探索開始局面のレートが使えればtrue
+ */
+static bool
+CopyRootRating( game_info_t *game )
+{
+  const int root_moves = root_rate.moves;
+
+  // 変更履歴が探索開始局面からのものでなければ使えない
+  if (!root_rate.valid || game->moves < root_moves ||
+      game->record[root_moves - 1].hash != root_rate.hash) {
+    return false;
+  }
+
+  memcpy(game->rate,         root_rate.rate,         sizeof(root_rate.rate));
+  memcpy(game->sum_rate_tree, root_rate.sum_rate_tree, sizeof(root_rate.sum_rate_tree));
+  memcpy(game->sum_rate,     root_rate.sum_rate,     sizeof(root_rate.sum_rate));
+  memcpy(game->update_num,   root_rate.update_num,   sizeof(root_rate.update_num));
+  memcpy(game->dirty_num,    root_rate.dirty_num,    sizeof(root_rate.dirty_num));
+  for (int i = 0; i < 2; i++) {
+    memcpy(game->update_pos[i], root_rate.update_pos[i], sizeof(int) * root_rate.update_num[i]);
+    memcpy(game->dirty_pos[i],  root_rate.dirty_pos[i],  sizeof(int) * root_rate.dirty_num[i]);
+  }
+
+  // 前回のシミュレーションの戦術的特徴を消す
+  std::fill_n(game->tactical_features, board_max * ALL_MAX, 0);
+
+  // 探索開始局面の直前の着手からの距離のγ値を外す
+  if (root_moves > 1 && game->record[root_moves - 1].pos != PASS) {
+    RecordDirtyPosition(game, S_BLACK, game->record[root_moves - 1].pos);
+    RecordDirtyPosition(game, S_WHITE, game->record[root_moves - 1].pos);
+  }
+
+  // 探索木の中で石が置かれた, または打ち上げられた箇所
+  for (int i = 0; i < game->journal_pos_num; i++) {
+    const int pos = game->journal_pos[i];
+    if (game->board[pos] != S_EMPTY) {
+      UpdateRate(&game->sum_rate[0], game->sum_rate_tree[0], game->rate[0], pos, 0);
+      UpdateRate(&game->sum_rate[1], game->sum_rate_tree[1], game->rate[1], pos, 0);
+    }
+    RecordDirtyPosition(game, S_BLACK, pos);
+    RecordDirtyPosition(game, S_WHITE, pos);
+  }
+
+  // 呼吸点が変化した連の呼吸点は戦術的特徴が変わりうる
+  for (int i = 0; i < game->journal_string_num; i++) {
+    const string_t *string = &game->string[game->journal_string[i]];
+    if (!string->flag) continue;
+    int lib = FirstLiberty(string);
+    while (lib != LIBERTY_END) {
+      RecordDirtyPosition(game, S_BLACK, lib);
+      RecordDirtyPosition(game, S_WHITE, lib);
+      lib = NextLiberty(string, lib);
+    }
+  }
+
+  // 更新箇所が溢れたら全体を計算し直す
+  return game->dirty_num[0] < PURE_BOARD_MAX + 2 &&
+         game->dirty_num[1] < PURE_BOARD_MAX + 2;
+}
+
+
 /**
  * @~english
  * @brief Simulate a match with Monte Carlo method.
+ * The simulation finishes early when the difference of stones captured in it reaches
+ * the mercy threshold. The board is not finished then, so it must not be used for statistics.
  * @param[in] game Board situation.
  * @param[in] starting_color First playing color.
  * @param[in] mt Random number generator.
+ * @param[out] mercy Whether the simulation finished by the mercy rule.
+ * @return Score without komi (black - white).
  * @~japanese
  * @brief モンテカルロ法による対局のシミュレーション
+ * シミュレーション中に取った石の差が閾値に達したときは途中で打ち切る
+ * その時の盤面は終局していないので, 統計情報に使ってはいけない
  * @param[in] game 局面の情報
  * @param[in] starting_color シミュレーション開始手番
  * @param[in] mt 乱数生成器
+ * @param[out] mercy 取った石の差で打ち切ったらtrue
+ * @return コミを含めないスコア (黒 - 白)
  */
-void
-Simulation( game_info_t *game, int starting_color, std::mt19937_64 &mt )
+int
+Simulation( game_info_t *game, int starting_color, std::mt19937_64 &mt, bool &mercy )
 {
   int color = starting_color, pos = -1;
   int pass_count = 0;
+  const int start_prisoner = game->prisoner[S_BLACK] - game->prisoner[S_WHITE];
+
+  mercy = false;
 
   // シミュレーション打ち切り手数を設定
   int length = MAX_MOVES - game->moves;
 
-  if (length < 0) {
-    return;
-  }
+  if (length >= 0) {
+    // 探索開始局面のレートをコピーし, 探索木の中で変化した箇所は最初の着手生成時に更新する
+    // 使えなければ全体を計算する
+    if (!CopyRootRating(game)) {
+      // レートの初期化
+      std::fill_n(game->sum_rate, 2, 0);
+      std::fill(game->sum_rate_tree[0], game->sum_rate_tree[2], 0);
+      std::fill(game->rate[0], game->rate[2], 0);
+
+      // 黒番のレートの計算
+      Rating(game, S_BLACK, &game->sum_rate[0], game->sum_rate_tree[0], game->rate[0]);
+      // 白番のレートの計算
+      Rating(game, S_WHITE, &game->sum_rate[1], game->sum_rate_tree[1], game->rate[1]);
+    }
+
+    // 終局まで対局をシミュレート
+    while (length-- && pass_count < 2) {
+      // 着手を生成する
+      pos = RatingMove(game, color, mt);
+      // 石を置く
+      PoPutStone(game, pos, color);
+      // パスの確認
+      pass_count = (pos == PASS) ? (pass_count + 1) : 0;
+      // 手番の入れ替え
+      color = GetOppositeColor(color);
 
-  // レートの初期化  
-  std::fill_n(game->sum_rate, 2, 0);
-  std::fill(game->sum_rate_row[0], game->sum_rate_row[2], 0);
-  std::fill(game->rate[0], game->rate[2], 0);
-
-  // 黒番のレートの計算
-  Rating(game, S_BLACK, &game->sum_rate[0], game->sum_rate_row[0], game->rate[0]);
-  // 白番のレートの計算
-  Rating(game, S_WHITE, &game->sum_rate[1], game->sum_rate_row[1], game->rate[1]);
-
-  // 終局まで対局をシミュレート
-  while (length-- && pass_count < 2) {
-    // 着手を生成する
-    pos = RatingMove(game, color, mt);
-    // 石を置く
-    PoPutStone(game, pos, color);
-    // パスの確認
-    pass_count = (pos == PASS) ? (pass_count + 1) : 0;
-    // 手番の入れ替え
-    color = GetOppositeColor(color);
+      // 取った石の差が大きく開いたら, 多く取った方の勝ちとする
+      if (mercy_threshold > 0) {
+        const int prisoner = game->prisoner[S_BLACK] - game->prisoner[S_WHITE] - start_prisoner;
+        if (prisoner >= mercy_threshold) {
+          mercy = true;
+          return pure_board_max;
+        } else if (prisoner <= -mercy_threshold) {
+          mercy = true;
+          return -pure_board_max;
+        }
+      }
+    }
   }
+
+  // 隅の曲がり四目の確認
+  CheckBentFourInTheCorner(game);
+
+  // コミを含めない盤面のスコアを求める
+  return CalculateScore(game);
 }
@@ -12,6 +12,7 @@
 #include <cstring>
 #include <string>
 #include <iostream>
+#include <vector>
 
 #include "board/Point.hpp"
 #include "common/Message.hpp"
@@ -196,7 +197,7 @@ double uct_criticality[CRITICALITY_MAX];
  * @~japanese
  * @brief MD3パターンのインデックスハッシュマップ
  */
-static index_hash_t md3_index[HASH_MAX];
+static pattern_index_t md3_index;
 
 /**
  * @~english
@@ -204,7 +205,7 @@ static index_hash_t md3_index[HASH_MAX];
  * @~japanese
  * @brief MD4パターンのインデックスハッシュマップ
  */
-static index_hash_t md4_index[HASH_MAX];
+static pattern_index_t md4_index;
 
 /**
  * @~english
@@ -212,7 +213,7 @@ static index_hash_t md4_index[HASH_MAX];
  * @~japanese
  * @brief MD5パターンのインデックスハッシュマップ
  */
-static index_hash_t md5_index[HASH_MAX];
+static pattern_index_t md5_index;
 
 /**
  * @~english
@@ -264,7 +265,13 @@ static void InputPat3( const char *filename, fm_t params[] );
 //  読み込み MD2
 static void InputMD2( const char *filename, fm_t params[] );
 //  読み込み
-static void InputLargePattern( const char *filename, fm_t params[], index_hash_t pat_index[] );
+static void InputLargePattern( const char *filename, fm_t params[], pattern_index_t *table );
+//  一致する最も大きいパターンの特徴の探索
+static fm_t *SearchPatternFeature( const game_info_t *game, const int pos, const pattern_hash_t *hash_pat );
+//  着手の有効な特徴の収集
+static int CollectFeatures( const game_info_t *game, const int pos, const unsigned int *tactical_features, const int distance_index, const pattern_hash_t *hash_pat, const fm_t *features[] );
+//  有効な特徴からのスコアの算出
+static double ScoreFeatures( const fm_t *features[], const int num );
 
 
 
@@ -284,88 +291,39 @@ InitializeUctRating()
 
 /**
  * @~english
- * @brief Calculate 1st term evaluation value.
- * @param[in] params Features data.
- * @return 1st term evaluation value.
- * @~japanese
- * @brief 1次の項のスコアの算出
- * @param[in] params 特徴データ
- * @return 1次の劫のスコア
- */
-static double
-Gamma( std::vector<fm_t*> &params )
-{
-  double gamma = 1.0;
-
-  for (const fm_t *param : params) {
-    gamma *= param->w;
-  }
-  
-  return gamma;
-}
-
-
-/**
- * @~english
- * @brief Calculate 2nd term evaluation value.
- * @param[in] t Features.
- * @param[in] i Feature's index.
- * @param[in] j Feature's index.
- * @return 2nd term evaluation value.
- * @~japanese
- * @brief 2次の項のスコアの算出
- * @param[in] t 特徴
- * @param[in] i 計算対象とする特徴のインデックス
- * @param[in] j 計算対象とする特徴のインデックス
- * @return 2次の劫のスコア
- */
-static double
-Theta( std::vector<fm_t*> &t, const int i, const int j )
-{
-  const double inv = 1.0 / static_cast<double>(BTFM_DIMENSION);
-  double theta = 0.0;
-
-  for (int k = 0; k < BTFM_DIMENSION; k++) {
-    theta += t[i]->v[k] * t[j]->v[k];
-  }
-
-  return theta * inv;
-}
-
-
-/**
- * @~english
- * @brief Calculate move evaluation score.
+ * @brief Collect active features of a move.
  * @param[in] game Board position data.
  * @param[in] pos Coordinate.
  * @param[in] tactical_features Tactical feature's data.
  * @param[in] distance_index Move distance index.
- * @return Move evaluation score.
+ * @param[in] hash_pat Hash values of the patterns at pos (not used for pass).
+ * @param[out] features Active features.
+ * @return The number of active features.
  * @~japanese
- * @brief 着手評価値の算出
+ * @brief 着手の有効な特徴の収集
  * @param[in] game 局面情報
  * @param[in] pos 座標
  * @param[in] tactical_features 戦術的特徴のデータ
  * @param[in] distance_index 着手距離のインデックス
- * @return 着手評価値
+ * @param[in] hash_pat posのパターンのハッシュ値 (パスでは使わない)
+ * @param[out] features 有効な特徴
+ * @return 有効な特徴の個数
  */
-double
-CalculateMoveScoreWithBTFM( const game_info_t *game, const int pos, const unsigned int *tactical_features, const int distance_index )
+static int
+CollectFeatures( const game_info_t *game, const int pos, const unsigned int *tactical_features, const int distance_index, const pattern_hash_t *hash_pat, const fm_t *features[] )
 {
   const int moves = game->moves;
   const int pm1 = (moves > 1) ? game->record[moves - 1].pos : PASS;
   const int pm2 = (moves > 2) ? game->record[moves - 2].pos : PASS;
   const int pm3 = (moves > 3) ? game->record[moves - 3].pos : PASS;
   const int pm4 = (moves > 4) ? game->record[moves - 4].pos : PASS;
-  int dis = 0;
-  std::vector<fm_t*> active_features;
-  pattern_hash_t hash_pat;
+  int dis = 0, num = 0;
 
   if (pos == PASS) {
     if (moves > 1 && pm1 == PASS) {
-      active_features.push_back(&uct_pass[UCT_PASS_AFTER_PASS]);
+      features[num++] = &uct_pass[UCT_PASS_AFTER_PASS];
     } else {
-      active_features.push_back(&uct_pass[UCT_PASS_AFTER_MOVE]);
+      features[num++] = &uct_pass[UCT_PASS_AFTER_MOVE];
     }
   } else {
     if (pm1 != PASS) {
@@ -373,7 +331,7 @@ CalculateMoveScoreWithBTFM( const game_info_t *game, const int pos, const unsign
       if (dis >= MOVE_DISTANCE_MAX - 1) {
         dis = MOVE_DISTANCE_MAX - 1;
       }
-      active_features.push_back(&uct_move_distance_1[dis + distance_index]);
+      features[num++] = &uct_move_distance_1[dis + distance_index];
     }
 
     if (pm2 != PASS) {
@@ -381,7 +339,7 @@ CalculateMoveScoreWithBTFM( const game_info_t *game, const int pos, const unsign
       if (dis >= MOVE_DISTANCE_MAX - 1) {
         dis = MOVE_DISTANCE_MAX - 1;
       }
-      active_features.push_back(&uct_move_distance_2[dis + distance_index]);
+      features[num++] = &uct_move_distance_2[dis + distance_index];
     }
 
     if (pm3 != PASS) {
@@ -389,7 +347,7 @@ CalculateMoveScoreWithBTFM( const game_info_t *game, const int pos, const unsign
       if (dis >= MOVE_DISTANCE_MAX - 1) {
         dis = MOVE_DISTANCE_MAX - 1;
       }
-      active_features.push_back(&uct_move_distance_3[dis + distance_index]);
+      features[num++] = &uct_move_distance_3[dis + distance_index];
     }
 
     if (pm4 != PASS) {
@@ -397,54 +355,71 @@ CalculateMoveScoreWithBTFM( const game_info_t *game, const int pos, const unsign
       if (dis >= MOVE_DISTANCE_MAX - 1) {
         dis = MOVE_DISTANCE_MAX - 1;
       }
-      active_features.push_back(&uct_move_distance_4[dis + distance_index]);
+      features[num++] = &uct_move_distance_4[dis + distance_index];
     }
 
-    const unsigned int *features = &tactical_features[pos * UCT_INDEX_MAX];
-
-    if (features[UCT_CAPTURE_INDEX]        > 0) active_features.push_back(&uct_capture[features[UCT_CAPTURE_INDEX]]);
-    if (features[UCT_SAVE_EXTENSION_INDEX] > 0) active_features.push_back(&uct_save_extension[features[UCT_SAVE_EXTENSION_INDEX]]);
-    if (features[UCT_ATARI_INDEX]          > 0) active_features.push_back(&uct_atari[features[UCT_ATARI_INDEX]]);
-    if (features[UCT_EXTENSION_INDEX]      > 0) active_features.push_back(&uct_extension[features[UCT_EXTENSION_INDEX]]);
-    if (features[UCT_DAME_INDEX]           > 0) active_features.push_back(&uct_dame[features[UCT_DAME_INDEX]]);
-    if (features[UCT_CONNECT_INDEX]        > 0) active_features.push_back(&uct_connect[features[UCT_CONNECT_INDEX]]);
-    if (features[UCT_THROW_IN_INDEX]       > 0) active_features.push_back(&uct_throw_in[features[UCT_THROW_IN_INDEX]]);
+    const unsigned int *tactical = &tactical_features[pos * UCT_INDEX_MAX];
 
-    PatternHash(&game->pat[pos], &hash_pat);
-    const int pat3_idx = Pat3(game->pat, pos);
-    const int md2_idx = md2_index[MD2(game->pat, pos)];
-    const int md3_idx = SearchIndex(md3_index, hash_pat.list[MD_3]);
-    const int md4_idx = SearchIndex(md4_index, hash_pat.list[MD_4]);
-    const int md5_idx = SearchIndex(md5_index, hash_pat.list[MD_5 + MD_MAX]);
+    if (tactical[UCT_CAPTURE_INDEX]        > 0) features[num++] = &uct_capture[tactical[UCT_CAPTURE_INDEX]];
+    if (tactical[UCT_SAVE_EXTENSION_INDEX] > 0) features[num++] = &uct_save_extension[tactical[UCT_SAVE_EXTENSION_INDEX]];
+    if (tactical[UCT_ATARI_INDEX]          > 0) features[num++] = &uct_atari[tactical[UCT_ATARI_INDEX]];
+    if (tactical[UCT_EXTENSION_INDEX]      > 0) features[num++] = &uct_extension[tactical[UCT_EXTENSION_INDEX]];
+    if (tactical[UCT_DAME_INDEX]           > 0) features[num++] = &uct_dame[tactical[UCT_DAME_INDEX]];
+    if (tactical[UCT_CONNECT_INDEX]        > 0) features[num++] = &uct_connect[tactical[UCT_CONNECT_INDEX]];
+    if (tactical[UCT_THROW_IN_INDEX]       > 0) features[num++] = &uct_throw_in[tactical[UCT_THROW_IN_INDEX]];
 
     // 盤上の位置
-    active_features.push_back(&uct_pos_id[board_pos_id[pos]]);
+    features[num++] = &uct_pos_id[board_pos_id[pos]];
 
     // パターン
-    if (md5_idx != -1) {
-      active_features.push_back(&uct_md5[md5_idx]);
-    } else if (md4_idx != -1) {
-      active_features.push_back(&uct_md4[md4_idx]);
-    } else if (md3_idx != -1) {
-      active_features.push_back(&uct_md3[md3_idx]);
-    } else if (md2_idx != -1) {
-      active_features.push_back(&uct_md2[md2_idx]);
-    } else {
-      active_features.push_back(&uct_pat3[pat3_idx]);
-    }
+    features[num++] = SearchPatternFeature(game, pos, hash_pat);
   }
 
   if (moves > 1 && game->ko_move == game->moves - 1) {
-    active_features.push_back(&uct_ko_exist);
+    features[num++] = &uct_ko_exist;
   }
 
-  const int feature_num = active_features.size();
-  const double gamma = Gamma(active_features);
-  double theta = feature_num > 1 ? 1.0 : 0.0;
+  return num;
+}
+
 
-  for (int i = 0; i < feature_num - 1; i++) {
-    for (int j = i + 1; j < feature_num; j++) {
-      theta *= Theta(active_features, i, j);
+/**
+ * @~english
+ * @brief Calculate evaluation value from active features.
+ * @param[in] features Active features.
+ * @param[in] num The number of active features.
+ * @return Evaluation value.
+ * @~japanese
+ * @brief 有効な特徴からのスコアの算出
+ * @param[in] features 有効な特徴
+ * @param[in] num 有効な特徴の個数
+ * @return スコア
+ */
+static double
+ScoreFeatures( const fm_t *features[], const int num )
+{
+  const double inv = 1.0 / static_cast<double>(BTFM_DIMENSION);
+  double gamma = 1.0;
+
+  // 1次の項
+  for (int i = 0; i < num; i++) {
+    gamma *= features[i]->w;
+  }
+
+  if (num <= 1) return gamma;
+
+  // 2次の項
+  double theta = 1.0;
+
+  for (int i = 0; i < num - 1; i++) {
+    const double *vi = features[i]->v;
+    for (int j = i + 1; j < num; j++) {
+      const double *vj = features[j]->v;
+      double dot = 0.0;
+      for (int k = 0; k < BTFM_DIMENSION; k++) {
+        dot += vi[k] * vj[k];
+      }
+      theta *= dot * inv;
     }
   }
 
@@ -452,6 +427,107 @@ CalculateMoveScoreWithBTFM( const game_info_t *game, const int pos, const unsign
 }
 
 
+/**
+ * @~english
+ * @brief Calculate move evaluation score.
+ * @param[in] game Board position data.
+ * @param[in] pos Coordinate.
+ * @param[in] tactical_features Tactical feature's data.
+ * @param[in] distance_index Move distance index.
+ * @return Move evaluation score.
+ * @~japanese
+ * @brief 着手評価値の算出
+ * @param[in] game 局面情報
+ * @param[in] pos 座標
+ * @param[in] tactical_features 戦術的特徴のデータ
+ * @param[in] distance_index 着手距離のインデックス
+ * @return 着手評価値
+ */
+double
+CalculateMoveScoreWithBTFM( const game_info_t *game, const int pos, const unsigned int *tactical_features, const int distance_index )
+{
+  double score;
+
+  CalculateMoveScoresWithBTFM(game, 1, &pos, tactical_features, distance_index, &score);
+
+  return score;
+}
+
+
+/**
+ * @~english
+ * @brief Calculate evaluation scores of moves at once.
+ * Buckets of pattern index for all moves are prefetched before lookups.
+ * @param[in] game Board position data.
+ * @param[in] num The number of moves.
+ * @param[in] pos Coordinates.
+ * @param[in] tactical_features Tactical feature's data.
+ * @param[in] distance_index Move distance index.
+ * @param[out] score Move evaluation scores.
+ * @~japanese
+ * @brief 複数の着手の評価値の一括算出
+ * 全ての着手のパターンのインデックスのバケットを探索前に先読みする
+ * @param[in] game 局面情報
+ * @param[in] num 着手の個数
+ * @param[in] pos 座標
+ * @param[in] tactical_features 戦術的特徴のデータ
+ * @param[in] distance_index 着手距離のインデックス
+ * @param[out] score 着手評価値
+ */
+void
+CalculateMoveScoresWithBTFM( const game_info_t *game, const int num, const int pos[], const unsigned int *tactical_features, const int distance_index, double score[] )
+{
+  pattern_hash_t hash_pat[PURE_BOARD_MAX + 1];
+  const fm_t *features[UCT_FEATURE_SLOT_MAX];
+
+  for (int i = 0; i < num; i++) {
+    if (pos[i] == PASS) continue;
+    PatternHash(&game->pat[pos[i]], &hash_pat[i]);
+    PrefetchPatternIndex(&md5_index, hash_pat[i].list[MD_5 + MD_MAX]);
+    PrefetchPatternIndex(&md4_index, hash_pat[i].list[MD_4]);
+    PrefetchPatternIndex(&md3_index, hash_pat[i].list[MD_3]);
+  }
+
+  for (int i = 0; i < num; i++) {
+    const int feature_num = CollectFeatures(game, pos[i], tactical_features, distance_index, &hash_pat[i], features);
+    score[i] = ScoreFeatures(features, feature_num);
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Search the largest matching pattern feature (MD5, MD4, MD3, MD2 and 3x3 in this order).
+ * @param[in] game Board position data.
+ * @param[in] pos Coordinate.
+ * @param[in] hash_pat Hash values of the patterns.
+ * @return Pattern feature.
+ * @~japanese
+ * @brief 一致する最も大きいパターンの特徴の探索 (MD5, MD4, MD3, MD2, 3x3の順)
+ * @param[in] game 局面情報
+ * @param[in] pos 座標
+ * @param[in] hash_pat パターンのハッシュ値
+ * @return パターンの特徴
+ */
+static fm_t *
+SearchPatternFeature( const game_info_t *game, const int pos, const pattern_hash_t *hash_pat )
+{
+  const int md5_idx = FindPatternIndex(&md5_index, hash_pat->list[MD_5 + MD_MAX]);
+  if (md5_idx != -1) return &uct_md5[md5_idx];
+
+  const int md4_idx = FindPatternIndex(&md4_index, hash_pat->list[MD_4]);
+  if (md4_idx != -1) return &uct_md4[md4_idx];
+
+  const int md3_idx = FindPatternIndex(&md3_index, hash_pat->list[MD_3]);
+  if (md3_idx != -1) return &uct_md3[md3_idx];
+
+  const int md2_idx = md2_index[MD2(game->pat, pos)];
+  if (md2_idx != -1) return &uct_md2[md2_idx];
+
+  return &uct_pat3[Pat3(game->pat, pos)];
+}
+
+
 /**
  * @~english
  * @brief Get policy and ownership predictions.
@@ -564,13 +640,13 @@ InputUCTParameter(void)
   InputMD2(path.c_str(), uct_md2);
   //  マンハッタン距離3のパターン
   path = uct_parameters_path + "MD3.txt";
-  InputLargePattern(path.c_str(), uct_md3, md3_index);
+  InputLargePattern(path.c_str(), uct_md3, &md3_index);
   //  マンハッタン距離4のパターン
   path = uct_parameters_path + "MD4.txt";
-  InputLargePattern(path.c_str(), uct_md4, md4_index);
+  InputLargePattern(path.c_str(), uct_md4, &md4_index);
   //  マンハッタン距離5のパターン
   path = uct_parameters_path + "MD5.txt";
-  InputLargePattern(path.c_str(), uct_md5, md5_index);
+  InputLargePattern(path.c_str(), uct_md5, &md5_index);
 
   //  Owner
   for (int i = 0; i < OWNER_MAX; i++) {
@@ -779,20 +855,21 @@ InputMD2( const char *filename, fm_t params[] )
  * @brief Input parameters for Bradley-Terry model with factorization machines (for large patterns).
  * @param[in] filename Parameter file name.
  * @param[out] params Parameters.
- * @param[out] pat_index Patttern hash index table.
+ * @param[out] table Patttern index.
  * @~japanese
  * @brief 2次のBTモデルのパラメータ読み込み (大きいパターン用)
  * @param[in] filename パラメータファイル名
  * @param[out] params 読み込んだパラメータ
- * @param[out] pat_index パターンハッシュのインデックステーブル
+ * @param[out] table パターンのインデックス
  */
 static void 
-InputLargePattern( const char *filename, fm_t params[], index_hash_t pat_index[] )
+InputLargePattern( const char *filename, fm_t params[], pattern_index_t *table )
 {
   FILE *fp;
   int index, idx = 0;
   unsigned long long hash;
   double weight;
+  std::vector<index_hash_t> pat_index(HASH_MAX);
 
   for (int i = 0; i < HASH_MAX; i++) {
     pat_index[i].hash = 0;
@@ -837,4 +914,6 @@ InputLargePattern( const char *filename, fm_t params[], index_hash_t pat_index[]
   }
 #endif
   fclose(fp);
+
+  BuildPatternIndex(table, pat_index.data());
 }
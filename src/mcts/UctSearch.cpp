@@ -12,6 +12,7 @@
 #include <climits>
 #include <cassert>
 #include <cmath>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -21,6 +22,7 @@
 #include <thread>
 #include <random>
 
+#include "board/BitBoard.hpp"
 #include "board/DynamicKomi.hpp"
 #include "board/GoBoard.hpp"
 #include "common/Message.hpp"
@@ -29,10 +31,12 @@
 #include "feature/Seki.hpp"
 #include "feature/Semeai.hpp"
 #include "mcts/MoveSelection.hpp"
+#include "mcts/NodeArena.hpp"
 #include "mcts/Simulation.hpp"
 #include "mcts/UctRating.hpp"
 #include "mcts/UctSearch.hpp"
 #include "mcts/ucb/UCBEvaluation.hpp"
+#include "util/Numa.hpp"
 #include "util/Utility.hpp"
 
 #if defined (_WIN32)
@@ -79,19 +83,53 @@ int current_root;
 
 /**
  * @~english
- * @brief Mutex variable for UCT nodes.
+ * @brief Mutex variable for ownership of UCT nodes.
  * @~japanese
- * @brief UCTノード用のミューテックス変数
+ * @brief UCTノードのOwnership用のミューテックス変数
  */
 static std::mutex *mutex_nodes;
 
 /**
  * @~english
- * @brief Mutex variable for node expansion.
+ * @brief The number of mutexes for registering nodes to the hash table.
  * @~japanese
- * @brief ノード展開を排他処理するためのミューテックス変数
+ * @brief ハッシュ表へのノードの登録用のミューテックス変数の個数
  */
-static std::mutex mutex_expand;       
+constexpr int HASH_ENTRY_MUTEX_NUM = 256;
+
+/**
+ * @~english
+ * @brief Mutexes for registering nodes to the hash table. Threads which reach the same position are serialized.
+ * @~japanese
+ * @brief ハッシュ表へのノードの登録用のミューテックス変数 (同じ局面に辿り着いたスレッドを直列化する)
+ */
+static std::mutex mutex_hash_entry[HASH_ENTRY_MUTEX_NUM];
+
+/**
+ * @~english
+ * @brief Expected average number of children of a node in percent of the maximum.
+ * The averages measured over a game were about 80% on 19x19 and 65-85% on 9x9.
+ * @~japanese
+ * @brief 子ノードの個数の平均の見込み (最大数に対する百分率)
+ * 1局を通して測った平均は19路盤で約80%, 9路盤で65-85%だった
+ */
+constexpr int AVERAGE_CHILD_PERCENT = 90;
+
+/**
+ * @~english
+ * @brief The number of nodes which a thread takes at once when it releases blocks of removed nodes.
+ * @~japanese
+ * @brief 削除されたノードのメモリ領域を返却する時に, 1つのスレッドがまとめて取るノードの数
+ */
+constexpr int SWEEP_CHUNK_SIZE = 1024;
+
+/**
+ * @~english
+ * @brief The number of intersections the node arena is sized for.
+ * @~japanese
+ * @brief ノードのメモリ領域の大きさを合わせた盤の交点の数
+ */
+static int node_arena_board_max = 0;
 
 /**
  * @~english
@@ -111,20 +149,44 @@ static thread_arg_t t_arg[THREAD_MAX];
 
 /**
  * @~english
- * @brief Statistic information of Monte-Carlo simulation.
+ * @brief Statistic information of Monte-Carlo simulation merged from all threads.
  * @~japanese
- * @brief プレイアウトの統計情報
+ * @brief 全スレッド分を合算したプレイアウトの統計情報
  */
 static statistic_t statistic[BOARD_MAX];  
 
 /**
  * @~english
- * @brief Counter for statistic information of Monte-Carlo simulation.
+ * @brief The number of simulations in the merged statistic information.
  * @~japanese
- * @brief プレイアウトの統計情報を収集した回数
+ * @brief 合算した統計情報を収集した回数
  */
 static std::atomic<int> statistic_count;
 
+/**
+ * @~english
+ * @brief Statistic information of Monte-Carlo simulation collected by each thread (owned by the search worker thread).
+ * @~japanese
+ * @brief 各スレッドが収集するプレイアウトの統計情報 (探索ワーカスレッドが持つ)
+ */
+static statistic_shard_t *statistic_shard[THREAD_MAX];
+
+/**
+ * @~english
+ * @brief The number of playouts of each thread in the last job.
+ * @~japanese
+ * @brief 各スレッドの直前の仕事でのプレイアウト回数
+ */
+static int thread_playouts[THREAD_MAX];
+
+/**
+ * @~english
+ * @brief Ownership updates of each thread which are not added to nodes yet (owned by the search worker thread).
+ * @~japanese
+ * @brief 各スレッドのまだノードに加算していないOwnershipの更新 (探索ワーカスレッドが持つ)
+ */
+static ownership_batch_t *ownership_batch[THREAD_MAX];
+
 /**
  * @~english
  * @brief Criticality value.
@@ -207,19 +269,85 @@ static bool pondered = false;
 
 /**
  * @~english
- * @brief Search worker thread.
+ * @brief Search stopping flag. Thread 0 sets it when it finishes searching.
  * @~japanese
- * @brief 探索ワーカスレッド
+ * @brief 探索を止めるためのフラグ (スレッド0が探索を終える時に立てる)
+ */
+static std::atomic<bool> search_stop(false);
+
+/**
+ * @~english
+ * @brief Search worker thread. They are created once and wait for jobs.
+ * @~japanese
+ * @brief 探索ワーカスレッド (1度だけ作成して仕事を待つ)
  */
 static std::thread *worker[THREAD_MAX];
 
 /**
  * @~english
- * @brief Random number generator for Monte-Carlo simulation.
+ * @brief Job for search worker threads.
  * @~japanese
- * @brief 乱数生成器
+ * @brief 探索ワーカスレッドに配る仕事
  */
-static std::mt19937_64 mt[THREAD_MAX];
+static void (*search_job)( thread_arg_t *arg, game_info_t *game ) = nullptr;
+
+/**
+ * @~english
+ * @brief Serial number of the latest job.
+ * @~japanese
+ * @brief 最後に配った仕事の通し番号
+ */
+static int job_number = 0;
+
+/**
+ * @~english
+ * @brief The number of search worker threads which have not finished the job.
+ * @~japanese
+ * @brief 仕事を終えていない探索ワーカスレッドの数
+ */
+static int running_workers = 0;
+
+/**
+ * @~english
+ * @brief Mutex variable for jobs.
+ * @~japanese
+ * @brief 仕事の受け渡し用のミューテックス変数
+ */
+static std::mutex mutex_job;
+
+/**
+ * @~english
+ * @brief Condition variable to wake search worker threads up for a new job.
+ * It is never destroyed because worker threads keep waiting on it until the process exits.
+ * @~japanese
+ * @brief 新しい仕事で探索ワーカスレッドを起こすための条件変数
+ * 探索ワーカスレッドが終了まで待ち続けるので破棄しない
+ */
+static std::condition_variable *job_start;
+
+/**
+ * @~english
+ * @brief Condition variable to notify that all search worker threads finished the job.
+ * @~japanese
+ * @brief 全探索ワーカスレッドが仕事を終えたことを知らせるための条件変数
+ */
+static std::condition_variable *job_finish;
+
+/**
+ * @~english
+ * @brief Random number generator for Monte-Carlo simulation (owned by the search worker thread).
+ * @~japanese
+ * @brief 乱数生成器 (探索ワーカスレッドが持つ)
+ */
+static std::mt19937_64 *mt[THREAD_MAX];
+
+/**
+ * @~english
+ * @brief NUMA mode flag. Search threads are pinned to cores and the search tree is interleaved over NUMA nodes.
+ * @~japanese
+ * @brief NUMAモードのフラグ (探索スレッドをコアに固定し, 探索木をNUMAノードに交互に配置する)
+ */
+static bool numa_mode = false;
 
 /**
  * @~english
@@ -229,6 +357,110 @@ static std::mt19937_64 mt[THREAD_MAX];
  */
 static bool reuse_subtree = false;
 
+/**
+ * @~english
+ * @brief Transposition mode flag. Nodes are keyed on positions instead of move sequences.
+ * @~japanese
+ * @brief 局面の合流のフラグ (着手の履歴ではなく局面でノードを引く)
+ */
+static bool transposition_mode = false;
+
+/**
+ * @~english
+ * @brief Request flag for garbage collection during search. Other threads stop outside the tree while it is set.
+ * @~japanese
+ * @brief 探索中のノードの回収の要求フラグ (立っている間は他のスレッドは探索木の外で止まる)
+ */
+static std::atomic<bool> gc_request(false);
+
+/**
+ * @~english
+ * @brief Garbage collection during search is available (thread 0 is searching and the last collection succeeded).
+ * @~japanese
+ * @brief 探索中のノードの回収ができるかのフラグ (スレッド0が探索中で, 前回の回収が成功している)
+ */
+static std::atomic<bool> gc_available(false);
+
+/**
+ * @~english
+ * @brief The number of threads which have not finished searching.
+ * @~japanese
+ * @brief 探索を終えていないスレッドの数
+ */
+static std::atomic<int> gc_searching_threads(0);
+
+/**
+ * @~english
+ * @brief The number of threads waiting for garbage collection.
+ * @~japanese
+ * @brief ノードの回収を待っているスレッドの数
+ */
+static std::atomic<int> gc_waiting_threads(0);
+
+/**
+ * @~english
+ * @brief Task of tree maintenance shared by all search worker threads.
+ * @~japanese
+ * @brief 全探索ワーカスレッドで分担する探索木の整理の仕事
+ */
+static void (*tree_task)( void ) = nullptr;
+
+/**
+ * @~english
+ * @brief Serial number of tree tasks given to threads waiting for garbage collection.
+ * @~japanese
+ * @brief ノードの回収を待っているスレッドに配った探索木の整理の仕事の通し番号
+ */
+static std::atomic<int> tree_task_number(0);
+
+/**
+ * @~english
+ * @brief The number of threads waiting for garbage collection which finished the tree task.
+ * @~japanese
+ * @brief 探索木の整理の仕事を終えた, ノードの回収を待っているスレッドの数
+ */
+static std::atomic<int> tree_task_helpers(0);
+
+/**
+ * @~english
+ * @brief Indices of nodes which have blocks of the current generation of the node arena.
+ * @~japanese
+ * @brief メモリ領域の現在の世代のブロックを持つノードのインデックス
+ */
+static int *block_nodes = nullptr;
+
+/**
+ * @~english
+ * @brief The number of nodes in block_nodes.
+ * @~japanese
+ * @brief block_nodesに入っているノードの数
+ */
+static std::atomic<int> block_node_num(0);
+
+/**
+ * @~english
+ * @brief Roots of subtrees to mark in the current generation.
+ * @~japanese
+ * @brief 現在の世代に付け直す部分木の根
+ */
+static std::vector<int> mark_roots;
+
+/**
+ * @~english
+ * @brief Index of the next subtree to mark in mark_roots.
+ * @~japanese
+ * @brief 次に付け直すmark_rootsの位置
+ */
+static std::atomic<size_t> mark_next(0);
+
+/**
+ * @~english
+ * @brief Position of the next chunk to sweep in block_nodes.
+ * @~japanese
+ * @brief 次に返却を確認するblock_nodesの位置
+ */
+static std::atomic<int> sweep_next(0);
+
 /**
 * @~english
 * @brief Ray's stone color.
@@ -239,19 +471,73 @@ static int my_color;
 
 
 // Criticaliityの計算
-static void CalculateCriticality( int color );
+static void CalculateCriticality( int color, const int count );
 
 // Criticality
-static void CalculateCriticalityIndex( uct_node_t *node, statistic_t *node_statistic, int color, int *index );
+static void CalculateCriticalityIndex( uct_node_t *node, statistic_t *node_statistic, const int count, int color, int *index );
 
 // Ownershipの計算
-static void CalculateOwner( int color );
+static void CalculateOwner( int color, const int count );
 
 // Ownership
-static void CalculateOwnerIndex( uct_node_t *node, statistic_t *node_statistc, int color, int *index );
+static void CalculateOwnerIndex( uct_node_t *node, statistic_t *node_statistc, const int count, int color, int *index );
+
+// ノードを引くためのハッシュ値の取得
+static unsigned long long GetNodeHash( const game_info_t *game );
+
+// ノードのOwnershipの更新の記録
+static void RecordOwnership( const int thread_id, const int node, const int color );
+
+// 溜めたOwnershipの更新のノードへの加算
+static void FlushOwnership( const int thread_id );
+
+// Ownershipの更新のノードのインデックスによる大小比較
+static int OwnershipUpdateComp( const void *a, const void *b );
+
+// 探索中のノードの回収の準備
+static void InitializeGarbageCollection( void );
 
-// 現局面の子ノードのインデックスの導出
-static void CorrectDescendentNodes( std::vector<int> &indexes, int index );
+// 探索中のノードの回収が終わるまで待つ
+static void WaitGarbageCollection( const int thread_id );
+
+// 探索スレッドの終了の通知
+static void LeaveGarbageCollection( const int thread_id );
+
+// 探索中のノードの回収
+static bool CollectGarbageNodes( void );
+
+// 合流先のノードへの接続
+static bool LinkTransposedNode( const game_info_t *game, const int color, child_node_t &child );
+
+// 探索木の整理の仕事を全探索ワーカスレッドで分担する
+static void RunTreeTask( void (*task)( void ) );
+
+// 探索木の整理の仕事をする探索ワーカ
+static void TreeTaskJob( thread_arg_t *, game_info_t * );
+
+// 現局面から辿れるノードだけを残す
+static void RetainDescendentNodes( const int root );
+
+// 現局面から辿れるノードを現在の世代に付け直す
+static void MarkRetainedNodes( const int root );
+
+// 子孫ノードを現在の世代に残す
+static void MarkDescendentNodes( void );
+
+// 使われていないノードのメモリ領域の返却
+static void SweepNodeBlocks( void );
+
+// ノードへのメモリ領域のブロックの設定
+static void AttachNodeBlock( const int index, const int child_num, void *block, const size_t size );
+
+// 全ノードのメモリ領域の返却
+static void ClearNodeBlocks( void );
+
+// 盤の大きさに合わせたノードのメモリ領域の確保
+static void InitializeNodeBlocks( void );
+
+// 候補手の列挙
+static int EnumerateCandidates( const game_info_t *game, const int color, int candidate[] );
 
 // ノードの展開
 static int ExpandNode( game_info_t *game, int color, int current );
@@ -259,11 +545,26 @@ static int ExpandNode( game_info_t *game, int color, int current );
 // ルートの展開
 static int ExpandRoot( game_info_t *game, int color );
 
+// 探索ワーカスレッド
+static void SearchWorker( const int thread_id );
+
+// 探索ワーカスレッドに仕事を配る
+static void StartSearchJob( void (*job)( thread_arg_t *arg, game_info_t *game ) );
+
+// 探索ワーカスレッドが仕事を終えたことの通知
+static void FinishSearchJob( void );
+
+// 探索ワーカスレッドが仕事を終えるまで待つ
+static void WaitSearchJob( void );
+
+// NUMAノードごとの探索速度の出力
+static void PrintNumaPlayoutSpeed( const double finish_time );
+
 // UCT探索
-static void ParallelUctSearch( thread_arg_t *arg );
+static void ParallelUctSearch( thread_arg_t *arg, game_info_t *game );
 
 // UCT探索(予測読み)
-static void ParallelUctSearchPondering( thread_arg_t *arg );
+static void ParallelUctSearchPondering( thread_arg_t *arg, game_info_t *game );
 
 // ノードのレーティング
 static void RatingNode( game_info_t *game, int color, int index );
@@ -274,10 +575,19 @@ static int RateComp( const void *a, const void *b );
 static int SelectMaxUcbChild( int current, int color, std::mt19937_64 &mt );
 
 // 各座標の統計処理
-static void Statistic( game_info_t *game, int winner );
+static void Statistic( game_info_t *game, int winner, const int thread_id );
+
+// 統計情報のクリア
+static void ClearStatistic( void );
+
+// 全スレッドの統計情報の合算
+static int MergeStatistic( statistic_t *dest );
+
+// 全スレッドの統計情報を収集したシミュレーションで勝った回数の合算
+static int MergeStatisticWin( const int color );
 
 // UCT探索(1回の呼び出しにつき, 1回の探索)
-static int UctSearch( game_info_t *game, int color, std::mt19937_64 &mt, int current, int &winner );
+static int UctSearch( game_info_t *game, int color, std::mt19937_64 &mt, int current, int &winner, const int thread_id );
 
 // ノード展開の閾値を取得
 static int GetExpandThreshold( const game_info_t *game );
@@ -360,6 +670,36 @@ SetReuseSubtree( bool flag )
 }
 
 
+/**
+ * @~english
+ * @brief Set transposition mode.
+ * @param[in] flag Transposition mode.
+ * @~japanese
+ * @brief 局面の合流の設定
+ * @param[in] flag 局面の合流のモード
+ */
+void
+SetTranspositionMode( bool flag )
+{
+  transposition_mode = flag;
+}
+
+
+/**
+ * @~english
+ * @brief Set NUMA mode.
+ * @param[in] flag NUMA mode.
+ * @~japanese
+ * @brief NUMAモードの設定
+ * @param[in] flag NUMAモード
+ */
+void
+SetNumaMode( bool flag )
+{
+  numa_mode = flag;
+}
+
+
 /**
  * @~english
  * @brief Set parameters for search settings.
@@ -407,16 +747,51 @@ InitializeUctSearch( void )
   // UCTのノードのメモリを確保
   uct_node = new uct_node_t[uct_hash_size];
 
-  std::cerr << "Require " << uct_hash_size * sizeof(uct_node_t) / 1024 / 1024 << " Mbytes for Uct Node" << std::endl << std::endl;
-  std::cerr << sizeof(uct_node_t) << std::endl;
-  std::cerr << sizeof(child_node_t) * UCT_CHILD_MAX << std::endl;
-  
   if (uct_node == NULL) {
     std::cerr << "Cannot allocate memory !!" << std::endl;
     std::cerr << "You must reduce tree size !!" << std::endl;
     exit(1);
   }
 
+  // NUMAモードでは初期化で触れる前にノードを全NUMAノードに交互に配置する
+  if (numa_mode) {
+    InitializeNumaTopology();
+    InterleaveMemory(uct_node, sizeof(uct_node_t) * uct_hash_size);
+  }
+
+  for (unsigned int i = 0; i < uct_hash_size; i++) {
+    uct_node[i].child = nullptr;
+    uct_node[i].ownership = nullptr;
+    uct_node[i].ownership_bits = nullptr;
+    uct_node[i].block_size = 0;
+    uct_node[i].expanded = false;
+  }
+
+  // 子ノードとOwnershipのメモリ領域を確保する
+  InitializeNodeBlocks();
+
+  // 以前の固定長のノードと, 現在の盤の大きさでの可変長のノードの1つあたりの最大の大きさ
+  const size_t fixed_node_size = sizeof(int) * 7 + sizeof(child_node_t) * UCT_CHILD_MAX + (sizeof(bool) + sizeof(double)) * BOARD_MAX;
+  const size_t block_size = (CalculateNodeBlockSize(pure_board_max + 1) + NODE_ARENA_LINE_SIZE - 1) / NODE_ARENA_LINE_SIZE * NODE_ARENA_LINE_SIZE;
+  const size_t variable_node_size = sizeof(uct_node_t) + block_size;
+  const size_t giga_bytes = 1024ULL * 1024 * 1024;
+
+  std::cerr << "Require " << (uct_hash_size * sizeof(uct_node_t) + GetNodeArenaSize()) / 1024 / 1024 << " Mbytes for Uct Node" << std::endl;
+  std::cerr << "Fixed node    : " << fixed_node_size << " bytes/node, " << giga_bytes / fixed_node_size << " nodes/GB" << std::endl;
+  std::cerr << "Variable node : " << variable_node_size << " bytes/node at most, " << giga_bytes / variable_node_size << " nodes/GB at least" << std::endl << std::endl;
+
+  if (numa_mode) {
+    std::cerr << "NUMA nodes    : " << GetNumaNodeNum() << std::endl << std::endl;
+  }
+
+  // 探索ワーカスレッドを作成して, スレッドごとのデータを用意し終えるまで待つ
+  job_start = new std::condition_variable();
+  job_finish = new std::condition_variable();
+  running_workers = threads;
+  for (i = 0; i < threads; i++) {
+    worker[i] = new std::thread(SearchWorker, i);
+  }
+  WaitSearchJob();
 }
 
 
@@ -429,6 +804,11 @@ InitializeUctSearch( void )
 void
 InitializeSearchSetting( void )
 {
+  // 盤の大きさが変わったらノードのメモリ領域を確保し直す
+  if (node_arena_board_max != pure_board_max) {
+    InitializeNodeBlocks();
+  }
+
   // Ownerの初期化
   for (int i = 0; i < board_max; i++){
     owner[i] = 50;
@@ -438,8 +818,8 @@ InitializeSearchSetting( void )
 
   // 乱数の初期化
   std::random_device rand;
-  for (int i = 0; i < THREAD_MAX; i++) {
-    mt[i].seed(rand());
+  for (int i = 0; i < threads; i++) {
+    mt[i]->seed(rand());
   }
 
 
@@ -466,10 +846,7 @@ StopPondering( void )
 
   if (ponder) {
     pondering_stop = true;
-    for (int i = 0; i < threads; i++) {
-      worker[i]->join();
-      delete worker[i];
-    }
+    WaitSearchJob();
     ponder = false;
     pondered = true;
     PrintPonderingCount(GetPoCount());
@@ -498,10 +875,7 @@ UctSearchGenmove( game_info_t *game, int color, int lz_analysis_cs )
 
   // 探索情報をクリア
   if (!pondered) {
-    for (int i = 0; i < board_max; i++) {
-      statistic[i].clear();
-    }
-    statistic_count = 0;
+    ClearStatistic();
     std::fill_n(criticality_index, board_max, 0);
     for (int i = 0; i < board_max; i++) {
       criticality[i] = 0.0;
@@ -552,27 +926,14 @@ UctSearchGenmove( game_info_t *game, int color, int lz_analysis_cs )
     t_arg[i].game = game;
     t_arg[i].color = color;
     t_arg[i].lz_analysis_cs = lz_analysis_cs;
+    t_arg[i].time_extension = true;
   }
 
-  const double mag[3] = { 1.0, 1.5, 2.0 };
-  int mag_count = 0;
-
-  // 着手が41手以降で, 
-  // 時間延長を行う設定になっていて,
-  // 探索時間延長をすべきときは
-  // 探索回数を1.5倍, 2.0倍に増やす
-
-  do {
-    ExtendSearchTime(mag[mag_count]);
-    for (int i = 0; i < threads; i++) {
-      worker[i] = new std::thread(ParallelUctSearch, &t_arg[i]);
-    }
-    for (int i = 0; i < threads; i++) {
-      worker[i]->join();
-      delete worker[i];
-    }
-    mag_count++;
-  } while (mag_count < 3 && ExtendTime(uct_node[current_root], game->moves));
+  // 探索時間の延長はスレッド0が探索を続けたまま行う
+  InitializeGarbageCollection();
+  SetSimulationRoot(game);
+  StartSearchJob(ParallelUctSearch);
+  WaitSearchJob();
 
   const int pos = SelectMove(game, uct_node[current_root], color, best_wp);
   
@@ -580,10 +941,15 @@ UctSearchGenmove( game_info_t *game, int color, int lz_analysis_cs )
   const double finish_time = CalculateElapsedTime();
 
   // 各地点の領地になる確率の出力
-  PrintOwner(&uct_node[current_root], statistic, color, statistic_count.load(), owner);
+  PrintOwner(&uct_node[current_root], statistic, color, MergeStatistic(statistic), owner);
   
   const int po_speed = static_cast<int>(CalculatePlayoutSpeed(finish_time, threads));
 
+  // NUMAノードごとの探索速度を出力
+  if (numa_mode) {
+    PrintNumaPlayoutSpeed(finish_time);
+  }
+
   // 最善応手列を出力
   PrintBestSequence(game, uct_node, current_root, color);
   // 探索の情報を出力(探索回数, 勝敗, 思考時間, 勝率, 探索速度)
@@ -617,10 +983,7 @@ UctSearchPondering( game_info_t *game, int color, int lz_analysis_cs )
   }
 
   // 探索情報をクリア
-  for (int i = 0; i < board_max; i++) {
-    statistic[i].clear();
-  }
-  statistic_count = 0;
+  ClearStatistic();
   std::fill_n(criticality_index, board_max, 0);  
   for (int i = 0; i < board_max; i++) {
     criticality[i] = 0.0;    
@@ -653,18 +1016,322 @@ UctSearchPondering( game_info_t *game, int color, int lz_analysis_cs )
   // Dynamic Komiの算出(置碁のときのみ)
   DynamicKomi(game, &uct_node[current_root], color);
 
+  InitializeGarbageCollection();
+
   for (int i = 0; i < threads; i++) {
     t_arg[i].thread_id = i;
     t_arg[i].game = game;
     t_arg[i].color = color;
     t_arg[i].lz_analysis_cs = lz_analysis_cs;
-    worker[i] = new std::thread(ParallelUctSearchPondering, &t_arg[i]);
+    t_arg[i].time_extension = false;
   }
 
+  SetSimulationRoot(game);
+
+  // 止めるまで探索を続けさせて戻る
+  StartSearchJob(ParallelUctSearchPondering);
+
   return;
 }
 
 
+/**
+ * @~english
+ * @brief Run a task of tree maintenance on all search worker threads.
+ * When the search is stopped, it is given to the workers as a job. During garbage collection,
+ * thread 0 runs it with the threads which wait outside the tree.
+ * The task must take its work from shared counters, so that it is finished by any number of threads.
+ * @param[in] task Task of tree maintenance.
+ * @~japanese
+ * @brief 探索木の整理の仕事を全探索ワーカスレッドで分担する
+ * 探索していない時は探索ワーカスレッドに仕事として配り, 探索中のノードの回収では
+ * スレッド0と探索木の外で待っているスレッドで分担する
+ * 何個のスレッドでも終えられるように, 仕事は共有のカウンタから取り合うようにする
+ * @param[in] task 探索木の整理の仕事
+ */
+static void
+RunTreeTask( void (*task)( void ) )
+{
+  tree_task = task;
+
+  if (gc_request) {
+    // 待っているスレッドは回収が終わるまで抜けないので, その全員が終えるまで待つ
+    tree_task_helpers = 0;
+    tree_task_number++;
+    task();
+    while (tree_task_helpers < gc_waiting_threads) {
+      std::this_thread::yield();
+    }
+  } else {
+    for (int i = 0; i < threads; i++) {
+      t_arg[i].thread_id = i;
+    }
+    StartSearchJob(TreeTaskJob);
+    WaitSearchJob();
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Search worker job for a task of tree maintenance.
+ * @~japanese
+ * @brief 探索木の整理の仕事をする探索ワーカ
+ */
+static void
+TreeTaskJob( thread_arg_t *, game_info_t * )
+{
+  tree_task();
+}
+
+
+/**
+ * @~english
+ * @brief Keep only nodes reachable from a root node (parallel mark and sweep).
+ * Reachable entries are marked in the next generation of the hash table,
+ * and node arena blocks of the other nodes are released. Both phases are shared
+ * by all search worker threads.
+ * @param[in] root Index of the root node.
+ * @~japanese
+ * @brief 現局面から辿れるノードだけを残す (並列のマーク&スイープ)
+ * ハッシュ表の次の世代に辿れるエントリを付け直し, 他のノードのメモリ領域を返却する
+ * どちらも全探索ワーカスレッドで分担する
+ * @param[in] root ルートノードのインデックス
+ */
+static void
+RetainDescendentNodes( const int root )
+{
+  MarkRetainedNodes(root);
+
+  // 付け直されなかったノードのメモリ領域を返却する
+  sweep_next = 0;
+  RunTreeTask(SweepNodeBlocks);
+
+  // 残ったノードだけを詰める
+  const int node_num = block_node_num;
+  int kept = 0;
+  for (int i = 0; i < node_num; i++) {
+    if (IsUsedHashIndex(block_nodes[i])) {
+      block_nodes[kept++] = block_nodes[i];
+    }
+  }
+  block_node_num = kept;
+}
+
+
+/**
+ * @~english
+ * @brief Mark nodes reachable from a root node in the next generation of the hash table.
+ * Unreachable entries are removed without scanning the table.
+ * @param[in] root Index of the root node.
+ * @~japanese
+ * @brief 現局面から辿れるノードのハッシュ表の次の世代への付け直し
+ * 表を走査せずに, 辿れないエントリが消える
+ * @param[in] root ルートノードのインデックス
+ */
+static void
+MarkRetainedNodes( const int root )
+{
+  std::vector<int> next_frontier;
+
+  ClearUctHash();
+  RetainHashIndex(root);
+  mark_roots.clear();
+  mark_roots.push_back(root);
+
+  // スレッドに配れるだけの部分木が集まるまで, 浅いノードは1つのスレッドで付け直す
+  while (!mark_roots.empty() && mark_roots.size() < static_cast<size_t>(threads) * 16) {
+    next_frontier.clear();
+    for (const int index : mark_roots) {
+      child_node_t *uct_child = uct_node[index].child;
+      const int child_num = uct_node[index].child_num;
+      for (int i = 0; i < child_num; i++) {
+        const int child_index = uct_child[i].index;
+        if (IsExpandedIndex(child_index) && RetainHashIndex(child_index)) {
+          next_frontier.push_back(child_index);
+        }
+      }
+    }
+    mark_roots.swap(next_frontier);
+  }
+
+  // 残りの部分木を付け直す
+  mark_next = 0;
+  RunTreeTask(MarkDescendentNodes);
+
+  FinishRetainingHash();
+}
+
+
+/**
+ * @~english
+ * @brief Mark descendent nodes in the current generation.
+ * Each thread takes subtrees from mark_roots in turn, and a node reached
+ * from several paths is marked only once.
+ * @~japanese
+ * @brief 子孫ノードを現在の世代に残す
+ * 各スレッドがmark_rootsから順に部分木を取り, 複数の経路から辿り着くノードも1度だけ付け直す
+ */
+static void
+MarkDescendentNodes( void )
+{
+  std::vector<int> stack;
+  size_t job;
+
+  while ((job = mark_next++) < mark_roots.size()) {
+    stack.push_back(mark_roots[job]);
+    while (!stack.empty()) {
+      const int index = stack.back();
+      child_node_t *uct_child = uct_node[index].child;
+      const int child_num = uct_node[index].child_num;
+
+      stack.pop_back();
+      for (int i = 0; i < child_num; i++) {
+        const int child_index = uct_child[i].index;
+        if (IsExpandedIndex(child_index) && RetainHashIndex(child_index)) {
+          stack.push_back(child_index);
+        }
+      }
+    }
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Release node arena blocks of nodes removed from the hash table.
+ * Only nodes in block_nodes are checked, and each thread takes SWEEP_CHUNK_SIZE of them in turn.
+ * @~japanese
+ * @brief ハッシュ表から削除されたノードのメモリ領域の返却
+ * block_nodesのノードだけを確認し, 各スレッドがSWEEP_CHUNK_SIZE個ずつ順に取る
+ */
+static void
+SweepNodeBlocks( void )
+{
+  const int node_num = block_node_num;
+  int begin;
+
+  while ((begin = sweep_next.fetch_add(SWEEP_CHUNK_SIZE)) < node_num) {
+    const int end = std::min(node_num, begin + SWEEP_CHUNK_SIZE);
+    for (int i = begin; i < end; i++) {
+      const int index = block_nodes[i];
+      if (!IsUsedHashIndex(index)) {
+        ReleaseNodeBlock(uct_node[index]);
+      }
+    }
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Set a block of the node arena to a node, and record the node in block_nodes.
+ * A node which has a block of the current generation is already recorded.
+ * @param[in] index Node index.
+ * @param[in] child_num The number of child nodes.
+ * @param[in] block Block allocated by AllocateNodeBlock.
+ * @param[in] size Size of the block.
+ * @~japanese
+ * @brief ノードへのメモリ領域のブロックの設定とblock_nodesへの記録
+ * 現在の世代のブロックを持っていたノードは既に記録されている
+ * @param[in] index ノードのインデックス
+ * @param[in] child_num 子ノードの個数
+ * @param[in] block AllocateNodeBlockで割り当てたブロック
+ * @param[in] size ブロックの大きさ
+ */
+static void
+AttachNodeBlock( const int index, const int child_num, void *block, const size_t size )
+{
+  const bool recorded = HasNodeBlock(uct_node[index]);
+
+  SetNodeBlock(uct_node[index], child_num, block, size);
+
+  if (!recorded) {
+    block_nodes[block_node_num++] = index;
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Release node arena blocks of all nodes. Blocks left in unused nodes
+ * belong to an old generation of the arena, so they are dropped when the nodes are reused.
+ * @~japanese
+ * @brief 全ノードのメモリ領域の返却
+ * 未使用のノードに残ったブロックはメモリ領域の古い世代になるので, ノードを再利用する時に捨てられる
+ */
+static void
+ClearNodeBlocks( void )
+{
+  ClearNodeArena();
+  block_node_num = 0;
+}
+
+
+/**
+ * @~english
+ * @brief Allocate the node arena for the current board size. It is sized for
+ * the expected average number of children instead of the maximum, and the search
+ * collects garbage nodes or stops when it fills up.
+ * @~japanese
+ * @brief 現在の盤の大きさに合わせたノードのメモリ領域の確保
+ * 子ノードの個数の最大数ではなく平均の見込みに合わせた大きさにして, 埋まったら不要なノードを回収するか探索を止める
+ */
+static void
+InitializeNodeBlocks( void )
+{
+  const int average_child_num = (pure_board_max + 1) * AVERAGE_CHILD_PERCENT / 100;
+  const size_t block_size = (CalculateNodeBlockSize(average_child_num) + NODE_ARENA_LINE_SIZE - 1) / NODE_ARENA_LINE_SIZE * NODE_ARENA_LINE_SIZE;
+
+  InitializeNodeArena(block_size * uct_hash_size);
+  if (numa_mode) {
+    InterleaveNodeArena();
+  }
+
+  delete[] block_nodes;
+  block_nodes = new int[uct_hash_size];
+  block_node_num = 0;
+
+  node_arena_board_max = pure_board_max;
+}
+
+
+/**
+ * @~english
+ * @brief Enumerate legal and meaningful move candidates by scanning the candidate bitboard.
+ * @param[in] game Current board position data.
+ * @param[in] color Player's color.
+ * @param[out] candidate Move candidates.
+ * @return The number of move candidates.
+ * @~japanese
+ * @brief 候補手のビットボードを走査して, 探索候補かつ合法で意味のある手を列挙する
+ * @param[in] game 現在の局面情報
+ * @param[in] color 手番の色
+ * @param[out] candidate 候補手
+ * @return 候補手の個数
+ */
+static int
+EnumerateCandidates( const game_info_t *game, const int color, int candidate[] )
+{
+  unsigned long long bits[BITBOARD_WORDS];
+  int candidate_num = 0;
+
+  GetMoveCandidateBits(game, color, bits);
+
+  for (int i = 0; i < bitboard_words; i++) {
+    while (bits[i] != 0) {
+      const int pos = onboard_pos[(i << 6) + LowestBit(bits[i])];
+      bits[i] &= bits[i] - 1;
+      if (candidates[pos]) {
+        candidate[candidate_num++] = pos;
+      }
+    }
+  }
+
+  return candidate_num;
+}
+
+
 /**
  * @~english
  * @brief Expand a root node.
@@ -681,7 +1348,7 @@ static int
 ExpandRoot( game_info_t *game, int color )
 {
   const int moves = game->moves;
-  const unsigned long long hash = game->move_hash;
+  const unsigned long long hash = GetNodeHash(game);
   unsigned int index = FindSameHashIndex(hash, color, moves);
   int pm1 = PASS, pm2 = PASS;
   bool ladder[BOARD_MAX] = { false };
@@ -696,14 +1363,18 @@ ExpandRoot( game_info_t *game, int color )
     LadderExtension(game, color, ladder);
   }
 
+  // 候補手のビットボードを計算し, 探索中の展開では探索木の中の着手の周囲だけを判定し直す
+  SetMoveCandidateBits(game);
+
   // 既に展開されていた時は, 探索結果を再利用する
   if (index != uct_hash_size) {
-    std::vector<int> indexes;
+    const ray_clock::time_point start_time = ray_clock::now();
+    const int before = static_cast<int>(GetUsedHashSize());
 
     // 現局面の子ノード以外を削除する
-    CorrectDescendentNodes(indexes, index);
-    std::sort(indexes.begin(), indexes.end());
-    ClearNotDescendentNodes(indexes);
+    RetainDescendentNodes(index);
+
+    PrintTreeRetention(before, static_cast<int>(GetUsedHashSize()), GetSpendTime(start_time));
     
     // 直前と2手前の着手を更新
     uct_node[index].previous_move1 = pm1;
@@ -713,6 +1384,7 @@ ExpandRoot( game_info_t *game, int color )
 
     // 展開されたノード数を1に初期化
     uct_node[index].width = 1;
+    uct_node[index].rank_count = 0;
 
     // 候補手のレーティング
     RatingNode(game, color, index);
@@ -723,20 +1395,24 @@ ExpandRoot( game_info_t *game, int color )
   } else {
     // 全ノードのクリア
     ClearUctHash();
+    ClearNodeBlocks();
     
     // 空のインデックスを探す
     index = SearchEmptyIndex(hash, color, moves);
 
     assert(index != uct_hash_size);    
+
+    uct_node[index].expanded = false;
+    PublishHashIndex(index);
     
     // ルートノードの初期化
     InitializeNode(uct_node[index], pm1, pm2);
 
-    child_node_t *uct_child = uct_node[index].child;
-    int child_num = 0;
+    int candidate[UCT_CHILD_MAX];
+    int candidate_num = 0;
 
     // パスノードの展開
-    InitializeCandidate(uct_child[PASS_INDEX], child_num, PASS, ladder[PASS]);
+    candidate[candidate_num++] = PASS;
     
     // 候補手の展開
     if (moves == 1) {
@@ -744,19 +1420,27 @@ ExpandRoot( game_info_t *game, int color )
         const int pos = first_move_candidate[i];
         // 探索候補かつ合法手であれば探索対象にする
         if (candidates[pos] && IsLegal(game, pos, color)) {
-          InitializeCandidate(uct_child[child_num], child_num, pos, ladder[pos]);
+          candidate[candidate_num++] = pos;
         }
       }
     } else {
-      for (int i = 0; i < pure_board_max; i++) {
-        const int pos = onboard_pos[i];
-        // 探索候補かつ合法手であれば探索対象にする
-        if (candidates[pos] &&
-            IsLegal(game, pos, color) &&
-            IsMeaningfulSelfAtari(game, color, pos)) {
-          InitializeCandidate(uct_child[child_num], child_num, pos, ladder[pos]);
-        }
-      }
+      candidate_num += EnumerateCandidates(game, color, &candidate[candidate_num]);
+    }
+
+    // 候補手の数に合わせて子ノードを割り当てる
+    // 全ブロックを解放した直後なので必ず割り当てられる
+    size_t block_size;
+    void *block = AllocateNodeBlock(candidate_num, block_size);
+
+    assert(block != nullptr);
+
+    AttachNodeBlock(index, candidate_num, block, block_size);
+
+    child_node_t *uct_child = uct_node[index].child;
+    int child_num = 0;
+
+    for (int i = 0; i < candidate_num; i++) {
+      InitializeCandidate(uct_child[child_num], child_num, candidate[i], ladder[candidate[i]]);
     }
     
     // 子ノード個数の設定
@@ -766,9 +1450,12 @@ ExpandRoot( game_info_t *game, int color )
     RatingNode(game, color, index);
 
     // セキの確認
-    CheckSeki(game, uct_node[index].seki);
+    bool seki[BOARD_MAX] = { false };
+    CheckSeki(game, seki);
+    SetSekiBits(uct_node[index], seki);
     
     uct_node[index].width++;
+    uct_node[index].expanded = true;
   }
 
   return index;
@@ -793,19 +1480,64 @@ static int
 ExpandNode( game_info_t *game, int color, int current )
 {
   const int moves = game->moves;
-  const unsigned long long hash = game->move_hash;
+  const unsigned long long hash = GetNodeHash(game);
   unsigned int index = FindSameHashIndex(hash, color, moves);
   int pm1 = PASS, pm2 = PASS;
+  bool ladder[BOARD_MAX] = { false };
   
-  // 合流先が検知できれば, それを返す
+  // 合流先が検知できれば, 他のスレッドが作り終えるのを待ってそれを返す
+  if (index != uct_hash_size) {
+    while (!uct_node[index].expanded) {
+      std::this_thread::yield();
+    }
+    return index;
+  }
+
+  int candidate[UCT_CHILD_MAX];
+  int candidate_num = 0;
+
+  // パスノードの展開
+  candidate[candidate_num++] = PASS;
+
+  // 候補手の展開
+  candidate_num += EnumerateCandidates(game, color, &candidate[candidate_num]);
+
+  // 候補手の数に合わせて子ノードのメモリを割り当てる
+  // 探索木が埋まっていれば展開しない
+  size_t block_size;
+  void *block = AllocateNodeBlock(candidate_num, block_size);
+
+  if (block == nullptr) {
+    return NOT_EXPANDED;
+  }
+
+  // 同じ局面のノードを複数のスレッドが作らないように, 登録し終えるまで局面ごとに排他制御する
+  std::unique_lock<std::mutex> lock(mutex_hash_entry[hash % HASH_ENTRY_MUTEX_NUM]);
+  index = FindSameHashIndex(hash, color, moves);
+
   if (index != uct_hash_size) {
+    lock.unlock();
+    FreeNodeArena(block, block_size);
+    while (!uct_node[index].expanded) {
+      std::this_thread::yield();
+    }
     return index;
   }
 
   // 空のインデックスを探す
+  // ハッシュ表が埋まっていれば展開しない
   index = SearchEmptyIndex(hash, color, moves);
 
-  assert(index != uct_hash_size);    
+  if (index == uct_hash_size) {
+    lock.unlock();
+    FreeNodeArena(block, block_size);
+    return NOT_EXPANDED;
+  }
+
+  // 前の世代の展開済みフラグを落としてから, 他のスレッドが引けるようにする
+  uct_node[index].expanded = false;
+  PublishHashIndex(index);
+  lock.unlock();
 
   // 直前の着手の座標を取り出す
   pm1 = game->record[moves - 1].pos;
@@ -814,22 +1546,18 @@ ExpandNode( game_info_t *game, int color, int current )
 
   // 現在のノードの初期化
   InitializeNode(uct_node[index], pm1, pm2);
+  AttachNodeBlock(index, candidate_num, block, block_size);
+
+  // 9路盤でなければシチョウを調べる (探索結果はスレッド間, 着手間でキャッシュされる)
+  if (pure_board_size != 9) {
+    LadderExtension(game, color, ladder);
+  }
 
   child_node_t *uct_child = uct_node[index].child;
   int child_num = 0;
 
-  // パスノードの展開
-  InitializeCandidate(uct_child[PASS_INDEX], child_num, PASS, false);
-
-  // 候補手の展開
-  for (int i = 0; i < pure_board_max; i++) {
-    const int pos = onboard_pos[i];
-    // 探索候補でなければ除外
-    if (candidates[pos] &&
-        IsLegal(game, pos, color) &&
-        IsMeaningfulSelfAtari(game, color, pos)) {
-      InitializeCandidate(uct_child[child_num], child_num, pos, false);
-    }
+  for (int i = 0; i < candidate_num; i++) {
+    InitializeCandidate(uct_child[child_num], child_num, candidate[i], ladder[candidate[i]]);
   }
 
   // 子ノードの個数を設定
@@ -839,7 +1567,14 @@ ExpandNode( game_info_t *game, int color, int current )
   RatingNode(game, color, index);
 
   // セキの確認
-  CheckSeki(game, uct_node[index].seki);
+  // パスでは盤面が変わらないので親ノードの結果を引き継ぐ
+  if (pm1 == PASS) {
+    std::copy_n(uct_node[current].seki, BITBOARD_WORDS, uct_node[index].seki);
+  } else {
+    bool seki[BOARD_MAX] = { false };
+    CheckSeki(game, seki);
+    SetSekiBits(uct_node[index], seki);
+  }
   
   // 探索幅を1つ増やす
   uct_node[index].width++;
@@ -869,6 +1604,9 @@ ExpandNode( game_info_t *game, int color, int current )
     }
   }
 
+  // 作り終えたノードを合流したスレッドに公開する
+  uct_node[index].expanded = true;
+
   return index;
 }
 
@@ -895,6 +1633,8 @@ RatingNode( game_info_t *game, int color, int index )
   child_node_t *uct_child = uct_node[index].child;
   unsigned int tactical_features[BOARD_MAX * UCT_INDEX_MAX] = {0};
   int distance_index = 0;
+  int rating_num = 0, rating_pos[PURE_BOARD_MAX + 1];
+  double rating_score[PURE_BOARD_MAX + 1];
 
   // パスのレーティング
   uct_child[PASS_INDEX].rate = CalculateMoveScoreWithBTFM(game, PASS, tactical_features, distance_index);
@@ -910,9 +1650,6 @@ RatingNode( game_info_t *game, int color, int index )
     CheckKoRecaptureForTree(game, color, tactical_features);
   }
 
-  max_index = 0;
-  max_score = uct_child[0].rate;
-
   for (int i = 1; i < child_num; i++) {
     const int pos = uct_child[i].pos;
   
@@ -923,12 +1660,27 @@ RatingNode( game_info_t *game, int color, int index )
     // アタリの確認
     CheckAtariForTree(game, color, pos, tactical_features);
 
+    // 逃げられないシチョウ以外の手をまとめてレーティングする
+    if (!uct_child[i].ladder) {
+      rating_pos[rating_num++] = pos;
+    }
+  }
+
+  CalculateMoveScoresWithBTFM(game, rating_num, rating_pos, tactical_features, distance_index, rating_score);
+
+  max_index = 0;
+  max_score = uct_child[0].rate;
+  rating_num = 0;
+
+  for (int i = 1; i < child_num; i++) {
+    const int pos = uct_child[i].pos;
+
     // 自己アタリが無意味だったらスコアを0.0にする
     // 逃げられないシチョウならスコアを-1.0にする
     if (uct_child[i].ladder) {
       score = 0.0;
     } else {
-      score = CalculateMoveScoreWithBTFM(game, pos, tactical_features, distance_index);
+      score = rating_score[rating_num++];
     }
 
     // その手のγを記録
@@ -946,57 +1698,207 @@ RatingNode( game_info_t *game, int color, int index )
     }
   }
 
-  const double inv_total = 1.0 / total_score;
+  const double inv_total = 1.0 / total_score;
+
+  for (int i = 0; i < child_num; i++) {
+    uct_child[i].rate *= inv_total;
+  }
+  
+  // 最もγが大きい着手を探索できるようにする
+  uct_child[max_index].pw = true;
+}
+
+
+/**
+ * @~english
+ * @brief Search worker thread. It waits for a job on a condition variable, and runs it
+ * with the board position data kept for the thread.
+ * @param[in] thread_id Search worker thread ID.
+ * @~japanese
+ * @brief 探索ワーカスレッド
+ * 条件変数で仕事を待ち, スレッドごとに持ち続ける局面情報を使って実行する
+ * @param[in] thread_id 探索ワーカスレッドのID
+ */
+static void
+SearchWorker( const int thread_id )
+{
+  // NUMAモードではコアに固定してから, スレッドごとのデータを自ノードのメモリに置く
+  if (numa_mode) {
+    PinCurrentThread(thread_id);
+  }
+
+  game_info_t *game = AllocateGame();
+  statistic_shard_t shard;
+  ownership_batch_t batch;
+  std::mt19937_64 rng;
+  int last_job = 0;
+
+  shard.clear();
+  batch.playout_num = 0;
+  batch.update_num = 0;
+  batch.counted = false;
+  statistic_shard[thread_id] = &shard;
+  ownership_batch[thread_id] = &batch;
+  mt[thread_id] = &rng;
+  FinishSearchJob();
+
+  while (true) {
+    void (*job)( thread_arg_t *arg, game_info_t *game );
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_job);
+      while (job_number == last_job) {
+        job_start->wait(lock);
+      }
+      last_job = job_number;
+      job = search_job;
+    }
+
+    const int count = shard.count;
+
+    job(&t_arg[thread_id], game);
+
+    thread_playouts[thread_id] = shard.count - count;
+    FinishSearchJob();
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Notify that a search worker thread finished the job.
+ * @~japanese
+ * @brief 探索ワーカスレッドが仕事を終えたことの通知
+ */
+static void
+FinishSearchJob( void )
+{
+  std::lock_guard<std::mutex> lock(mutex_job);
+
+  if (--running_workers == 0) {
+    job_finish->notify_all();
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Give a job to all search worker threads. The previous job must be finished.
+ * @param[in] job Job for search worker threads.
+ * @~japanese
+ * @brief 全探索ワーカスレッドに仕事を配る (前の仕事は終わっていなければならない)
+ * @param[in] job 探索ワーカスレッドに配る仕事
+ */
+static void
+StartSearchJob( void (*job)( thread_arg_t *arg, game_info_t *game ) )
+{
+  std::lock_guard<std::mutex> lock(mutex_job);
+
+  search_stop = false;
+  search_job = job;
+  running_workers = threads;
+  job_number++;
+  job_start->notify_all();
+}
+
+
+/**
+ * @~english
+ * @brief Wait until all search worker threads finish the job.
+ * @~japanese
+ * @brief 全探索ワーカスレッドが仕事を終えるまで待つ
+ */
+static void
+WaitSearchJob( void )
+{
+  std::unique_lock<std::mutex> lock(mutex_job);
+
+  while (running_workers > 0) {
+    job_finish->wait(lock);
+  }
+}
+
 
-  for (int i = 0; i < child_num; i++) {
-    uct_child[i].rate *= inv_total;
+/**
+ * @~english
+ * @brief Print playout speed of each NUMA node in the last job.
+ * @param[in] finish_time Search time.
+ * @~japanese
+ * @brief 直前の仕事でのNUMAノードごとの探索速度の出力
+ * @param[in] finish_time 探索時間
+ */
+static void
+PrintNumaPlayoutSpeed( const double finish_time )
+{
+  for (int node = 0; node < GetNumaNodeNum(); node++) {
+    int playouts = 0, thread_num = 0;
+
+    for (int i = 0; i < threads; i++) {
+      if (GetThreadNumaNode(i) == node) {
+        playouts += thread_playouts[i];
+        thread_num++;
+      }
+    }
+    if (thread_num > 0 && finish_time >= 0.001) {
+      PrintNodePlayoutSpeed(node, thread_num, static_cast<int>(playouts / finish_time));
+    }
   }
-  
-  // 最もγが大きい着手を探索できるようにする
-  uct_child[max_index].pw = true;
 }
 
 
 /**
  * @~english
- * @brief Search worker.
+ * @brief Search worker. Thread 0 decides when to finish searching,
+ * and extends search time without stopping the other threads.
  * @param[in] arg Arguments for a search worker thread.
+ * @param[in, out] game Board position data of the thread.
  * @~japanese
  * @brief 探索ワーカ
+ * 探索を終えるかはスレッド0が決め, 探索時間の延長も他のスレッドを止めずに行う
  * @param[in] arg 探索ワーカスレッドの引数
+ * @param[in, out] game スレッドの局面情報
  */
 static void
-ParallelUctSearch( thread_arg_t *arg )
+ParallelUctSearch( thread_arg_t *arg, game_info_t *game )
 {
   const thread_arg_t *targ = (thread_arg_t *)arg;
   const int color = targ->color;
   bool interruption = false, enough_size = true;
   bool use_analysis = targ->lz_analysis_cs > 0 ? true : false;
   int winner = 0, interval = CRITICALITY_INTERVAL;
-  game_info_t *game = AllocateGame();
   ray_clock::time_point analysis_timer;
 
+  // 盤面のコピー
+  // 以降は変更箇所だけを巻き戻して探索開始局面に戻す
+  CopyGame(game, targ->game);
+
   // スレッドIDが0のスレッドだけ別の処理をする
   // 探索回数が閾値を超える, または探索が打ち切られたらループを抜ける
   if (targ->thread_id == 0) {
+    const double mag[3] = { 1.0, 1.5, 2.0 };
+    int mag_count = 0;
+
     analysis_timer = ray_clock::now();
 
     do {
       // 探索回数を1回増やす
       IncrementPoCount();
-      // 盤面のコピー
-      CopyGame(game, targ->game);
       // 1回プレイアウトする
-      UctSearch(game, color, mt[targ->thread_id], current_root, winner);
+      UctSearch(game, color, *mt[targ->thread_id], current_root, winner, targ->thread_id);
+      // 探索開始局面に戻す
+      RestoreGame(game, targ->game);
       // 探索を打ち切るか確認
       interruption = CheckInterruption(uct_node[current_root]);
       //interruption = InterruptionCheck();
-      // ハッシュに余裕があるか確認
-      enough_size = CheckRemainingHashSize();
+      // ハッシュに余裕があるか確認し, 無ければ探索中にノードを回収する
+      enough_size = CheckRemainingHashSize() && CheckRemainingNodeArena();
+      if (!enough_size) enough_size = CollectGarbageNodes();
       // OwnerとCriticalityを計算する
       if (GetPoCount() > interval) {
-        CalculateOwner(color);
-        CalculateCriticality(color);
+        const int count = MergeStatistic(statistic);
+        statistic_count = count;
+        CalculateOwner(color, count);
+        CalculateCriticality(color, count);
         interval += CRITICALITY_INTERVAL;
       }
 
@@ -1006,28 +1908,38 @@ ParallelUctSearch( thread_arg_t *arg )
         PrintLeelaZeroAnalyze(&uct_node[current_root]);
       }
 
-      if (IsTimeOver()) break;
-    } while (IsSearchContinue() && !interruption && enough_size);
+      // 着手が41手以降で, 
+      // 時間延長を行う設定になっていて,
+      // 探索時間延長をすべきときは
+      // 探索回数を1.5倍, 2.0倍に増やして続ける
+      if (IsTimeOver() || !IsSearchContinue()) {
+        if (!targ->time_extension || ++mag_count >= 3 ||
+            !ExtendTime(uct_node[current_root], targ->game->moves)) {
+          break;
+        }
+        ExtendSearchTime(mag[mag_count]);
+      }
+    } while (!interruption && enough_size);
+
+    // 他のスレッドを止める
+    search_stop = true;
   } else {
     do {
+      // ノードの回収中は探索木の外で待つ
+      if (gc_request) WaitGarbageCollection(targ->thread_id);
       // 探索回数を1回増やす
       IncrementPoCount();
-      // 盤面のコピー
-      CopyGame(game, targ->game);
       // 1回プレイアウトする
-      UctSearch(game, color, mt[targ->thread_id], current_root, winner);
-      // 探索を打ち切るか確認
-      interruption = CheckInterruption(uct_node[current_root]);
-      //interruption = InterruptionCheck();
-      // ハッシュに余裕があるか確認
-      enough_size = CheckRemainingHashSize();
-
-      if (IsTimeOver()) break;
-    } while (IsSearchContinue() && !interruption && enough_size);
+      UctSearch(game, color, *mt[targ->thread_id], current_root, winner, targ->thread_id);
+      // 探索開始局面に戻す
+      RestoreGame(game, targ->game);
+      // ハッシュに余裕があるか確認 (スレッド0がノードを回収できる間は続ける)
+      enough_size = (CheckRemainingHashSize() && CheckRemainingNodeArena()) || gc_available;
+      // スレッド0が探索を終えるまで続ける
+    } while (!search_stop && enough_size);
   }
 
-  // メモリの解放
-  FreeGame(game);
+  LeaveGarbageCollection(targ->thread_id);
 }
 
 
@@ -1035,21 +1947,26 @@ ParallelUctSearch( thread_arg_t *arg )
  * @~english
  * @brief Pondering worker.
  * @param[in] arg Arguments for a search worker thread.
+ * @param[in, out] game Board position data of the thread.
  * @~japanese
  * @brief 予測読みワーカ
  * @param[in] arg 予測読みワーカスレッドの引数
+ * @param[in, out] game スレッドの局面情報
  */
 static void
-ParallelUctSearchPondering( thread_arg_t *arg )
+ParallelUctSearchPondering( thread_arg_t *arg, game_info_t *game )
 {
   const thread_arg_t *targ = (thread_arg_t *)arg;
   const int color = targ->color;
   int winner = 0, interval = CRITICALITY_INTERVAL;
   bool enough_size = true;
   bool use_analysis = targ->lz_analysis_cs > 0 ? true : false;
-  game_info_t *game = AllocateGame();
   ray_clock::time_point analysis_timer;
 
+  // 盤面のコピー
+  // 以降は変更箇所だけを巻き戻して探索開始局面に戻す
+  CopyGame(game, targ->game);
+
   // スレッドIDが0のスレッドだけ別の処理をする
   // 探索回数が閾値を超える, または探索が打ち切られたらループを抜ける
   if (targ->thread_id == 0) {
@@ -1057,16 +1974,19 @@ ParallelUctSearchPondering( thread_arg_t *arg )
     do {
       // 探索回数を1回増やす
       IncrementPoCount();
-      // 盤面のコピー
-      CopyGame(game, targ->game);
       // 1回プレイアウトする
-      UctSearch(game, color, mt[targ->thread_id], current_root, winner);
-      // ハッシュに余裕があるか確認
-      enough_size = CheckRemainingHashSize();
+      UctSearch(game, color, *mt[targ->thread_id], current_root, winner, targ->thread_id);
+      // 探索開始局面に戻す
+      RestoreGame(game, targ->game);
+      // ハッシュに余裕があるか確認し, 無ければ探索中にノードを回収する
+      enough_size = CheckRemainingHashSize() && CheckRemainingNodeArena();
+      if (!enough_size) enough_size = CollectGarbageNodes();
       // OwnerとCriticalityを計算する
       if (GetPoCount() > interval) {
-        CalculateOwner(color);
-        CalculateCriticality(color);
+        const int count = MergeStatistic(statistic);
+        statistic_count = count;
+        CalculateOwner(color, count);
+        CalculateCriticality(color, count);
         interval += CRITICALITY_INTERVAL;
       }
 
@@ -1079,19 +1999,20 @@ ParallelUctSearchPondering( thread_arg_t *arg )
     } while (!pondering_stop && enough_size);
   } else {
     do {
+      // ノードの回収中は探索木の外で待つ
+      if (gc_request) WaitGarbageCollection(targ->thread_id);
       // 探索回数を1回増やす
       IncrementPoCount();
-      // 盤面のコピー
-      CopyGame(game, targ->game);
       // 1回プレイアウトする
-      UctSearch(game, color, mt[targ->thread_id], current_root, winner);
-      // ハッシュに余裕があるか確認
-      enough_size = CheckRemainingHashSize();
+      UctSearch(game, color, *mt[targ->thread_id], current_root, winner, targ->thread_id);
+      // 探索開始局面に戻す
+      RestoreGame(game, targ->game);
+      // ハッシュに余裕があるか確認 (スレッド0がノードを回収できる間は続ける)
+      enough_size = (CheckRemainingHashSize() && CheckRemainingNodeArena()) || gc_available;
     } while (!pondering_stop && enough_size);
   }
 
-  // メモリの解放
-  FreeGame(game);
+  LeaveGarbageCollection(targ->thread_id);
 }
 
 
@@ -1103,6 +2024,7 @@ ParallelUctSearchPondering( thread_arg_t *arg )
  * @param[in] mt Random number generator.
  * @param[in] current Index of current node.
  * @param[in] winner Search result data.
+ * @param[in] thread_id Search thread ID.
  * @return Monte-Carlo simulation's result.
  * @~japanese
  * @brief UCTアルゴリズムによる探索
@@ -1111,17 +2033,16 @@ ParallelUctSearchPondering( thread_arg_t *arg )
  * @param[in] mt 乱数生成器
  * @param[in] current 現在のノードのインデックス
  * @param[in] winner 探索結果
+ * @param[in] thread_id 探索スレッドのID
  * @return モンテカルロ・シミュレーションの結果
  */
 static int 
-UctSearch( game_info_t *game, int color, std::mt19937_64 &mt, int current, int &winner )
+UctSearch( game_info_t *game, int color, std::mt19937_64 &mt, int current, int &winner, const int thread_id )
 {
-  int result = 0, next_index;
+  int result = 0, next_index, next_node;
   double score;
   child_node_t *uct_child = uct_node[current].child;  
 
-  // 現在見ているノードをロック
-  mutex_nodes[current].lock();
   // UCB値最大の手を求める
   next_index = SelectMaxUcbChild(current, color, mt);
   // 選んだ手を着手
@@ -1129,22 +2050,40 @@ UctSearch( game_info_t *game, int color, std::mt19937_64 &mt, int current, int &
   // 色を入れ替える
   color = GetOppositeColor(color);
 
-  if ((uct_child[next_index].move_count + uct_child[next_index].virtual_loss) < GetExpandThreshold(game)) {
-    AddVirtualLoss(uct_node[current], uct_child[next_index]);
+  // 合流先のノードがあれば, 展開の閾値に達していなくてもそのノードを辿る
+  const bool transposed = transposition_mode && LinkTransposedNode(game, color, uct_child[next_index]);
 
-    memcpy(game->seki, uct_node[current].seki, sizeof(bool) * BOARD_MAX);
-    
-    // 現在見ているノードのロックを解除
-    mutex_nodes[current].unlock();
+  const bool expand = transposed ||
+    (uct_child[next_index].move_count + uct_child[next_index].virtual_loss) >= GetExpandThreshold(game);
 
-    // 終局まで対局のシミュレーション
-    Simulation(game, color, mt);
+  // Virtual Lossを加算
+  AddVirtualLoss(uct_node[current], uct_child[next_index]);
 
-    // 隅の曲がり四目の確認
-    CheckBentFourInTheCorner(game);
-    
-    // コミを含めない盤面のスコアを求める
-    score = static_cast<double>(CalculateScore(game));
+  next_node = NOT_EXPANDED;
+  if (expand) {
+    // ノードの展開の確認
+    int expected = NOT_EXPANDED;
+    if (uct_child[next_index].index == NOT_EXPANDED &&
+        uct_child[next_index].index.compare_exchange_strong(expected, NODE_EXPANDING)) {
+      // 展開中に切り替えたスレッドだけがノードを作る
+      // 探索木が埋まっていて作れなければ, 未展開に戻す
+      next_node = ExpandNode(game, color, current);
+      // 作り終えたノードを公開する
+      uct_child[next_index].index = next_node;
+    } else {
+      // 他のスレッドが展開中なら終わるまで待つ
+      while ((next_node = uct_child[next_index].index) == NODE_EXPANDING) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  if (next_node == NOT_EXPANDED) {
+    CopySekiFlags(uct_node[current], game->seki);
+
+    // 終局まで対局のシミュレーションをして, コミを含めない盤面のスコアを求める
+    bool mercy;
+    score = static_cast<double>(Simulation(game, color, mt, mercy));
     
     // コミを考慮した勝敗
     if (my_color == S_BLACK) {
@@ -1165,31 +2104,21 @@ UctSearch( game_info_t *game, int color, std::mt19937_64 &mt, int current, int &
       }
     }
     // 統計情報の記録
-    Statistic(game, winner);
-  } else {
-    // Virtual Lossを加算
-    AddVirtualLoss(uct_node[current], uct_child[next_index]);
-    // ノードの展開の確認
-    if (uct_child[next_index].index == -1) {
-      // ノードの展開中はロック
-      mutex_expand.lock();
-      // ノードの展開
-      uct_child[next_index].index = ExpandNode(game, color, current);
-      // ノード展開のロックの解除
-      mutex_expand.unlock();
+    // 取った石の差で打ち切った盤面は終局していないので, OwnershipとCriticalityには使わない
+    if (!mercy) {
+      Statistic(game, winner, thread_id);
     }
-    // 現在見ているノードのロックを解除
-    mutex_nodes[current].unlock();
+    ownership_batch[thread_id]->counted = !mercy;
+  } else {
     // 手番を入れ替えて1手深く読む
-    result = UctSearch(game, color, mt, uct_child[next_index].index, winner);
+    result = UctSearch(game, color, mt, next_node, winner, thread_id);
   }
 
   // 探索結果の反映
   UpdateResult(uct_node[current], uct_child[next_index], result);
 
-  mutex_nodes[current].lock();
-  UpdateOwnership(uct_node[current], game, GetOppositeColor(color));
-  mutex_nodes[current].unlock();
+  // 終局時の領域はプレイアウト1回につき1度だけStatisticで求めたものを使う
+  RecordOwnership(thread_id, current, GetOppositeColor(color));
 
   return 1 - result;
 }
@@ -1244,54 +2173,79 @@ SelectMaxUcbChild( int current, int color, std::mt19937_64 &mt )
   child_node_t *uct_child = uct_node[current].child;
   rate_order_t order[PURE_BOARD_MAX + 1];  
   
-  // 128回ごとにOwnerとCriticalityでソートし直す  
-  if ((sum & 0x7f) == 0 && sum != 0) {
+  // 128回ごとにOwnerとCriticalityでソートし直す
+  // 同じ探索回数でソートし直すのは, rank_countを書き換えた1つのスレッドだけ
+  int rank_count = uct_node[current].rank_count;
+  if ((sum & 0x7f) == 0 && sum != 0 && rank_count != sum &&
+      uct_node[current].rank_count.compare_exchange_strong(rank_count, sum)) {
     int o_index[UCT_CHILD_MAX], c_index[UCT_CHILD_MAX];
-    CalculateCriticalityIndex(&uct_node[current], statistic, color, c_index);
-    CalculateOwnerIndex(&uct_node[current], statistic, color, o_index);
+    bool candidate[UCT_CHILD_MAX] = { false };
+    // 統計情報はスレッド0が一定間隔で合算したものを使う
+    const int count = statistic_count;
+    CalculateCriticalityIndex(&uct_node[current], statistic, count, color, c_index);
+    CalculateOwnerIndex(&uct_node[current], statistic, count, color, o_index);
     for (int i = 0; i < child_num; i++) {
       const int pos = uct_child[i].pos;
       const double dynamic_parameter = (pos == PASS) ? 1.0 : uct_owner[o_index[i]] * uct_criticality[c_index[i]];
 
       order[i].rate = uct_child[i].rate * dynamic_parameter;
       order[i].index = i;
-      uct_child[i].pw = false;
     }
     qsort(order, child_num, sizeof(rate_order_t), RateComp);
 
+    // 探索幅を増やすスレッドと排他制御して, 読んだ探索幅と候補の数を一致させる
+    std::lock_guard<std::mutex> lock(mutex_nodes[current]);
+
     // 子ノードの数と探索幅の最小値を取る
-    const int width = ((uct_node[current].width > child_num) ? child_num : uct_node[current].width);
+    const int node_width = uct_node[current].width;
+    const int width = ((node_width > child_num) ? child_num : node_width);
 
     // 探索候補の手を展開し直す
+    // 新しい候補を立ててから古い候補を外すので, 他のスレッドから候補が空に見えることはない
     for (int i = 0; i < width; i++) {
-      uct_child[order[i].index].pw = true;
+      candidate[order[i].index] = true;
+    }
+    for (int i = 0; i < child_num; i++) {
+      if (candidate[i]) uct_child[i].pw = true;
+    }
+    for (int i = 0; i < child_num; i++) {
+      if (!candidate[i]) uct_child[i].pw = false;
     }
   }
 
   // Progressive Wideningの閾値を超えたら, 
   // レートが最大の手を読む候補を1手追加
+  // 候補を選び直すスレッドと排他制御して, 探索幅の更新と候補の追加を一緒に行う
   if (sum > pw[uct_node[current].width]) {
-    int max_index = -1;
-    double max_rate = -10000.0;
-    for (int i = 0; i < child_num; i++) {
-      if (!uct_child[i].pw) {
-        const int pos = uct_child[i].pos;
-        const double dynamic_parameter = (pos == PASS) ? 1.0 : uct_owner[owner_index[pos]] * uct_criticality[criticality_index[pos]];
-        const double rate = uct_child[i].rate * dynamic_parameter;
-
-        if (rate > max_rate) {
-          max_index = i;
-          max_rate = rate;
+    std::lock_guard<std::mutex> lock(mutex_nodes[current]);
+    const int width = uct_node[current].width;
+
+    // 他のスレッドが先に探索幅を増やしていなければ候補を追加する
+    if (sum > pw[width]) {
+      int max_index = -1;
+      double max_rate = -10000.0;
+
+      uct_node[current].width = width + 1;
+      for (int i = 0; i < child_num; i++) {
+        if (!uct_child[i].pw) {
+          const int pos = uct_child[i].pos;
+          const double dynamic_parameter = (pos == PASS) ? 1.0 : uct_owner[owner_index[pos]] * uct_criticality[criticality_index[pos]];
+          const double rate = uct_child[i].rate * dynamic_parameter;
+
+          if (rate > max_rate) {
+            max_index = i;
+            max_rate = rate;
+          }
         }
       }
+      if (max_index != -1) {
+        uct_child[max_index].pw = true;
+      }
     }
-    if (max_index != -1) {
-      uct_child[max_index].pw = true;
-    }
-    uct_node[current].width++;  
   }
 
-  return SelectBestChildIndexByUCB1(uct_node[current], mt);
+  // 局面を合流させる時は, 合流先のノードの勝率を使う
+  return SelectBestChildIndexByUCB1(uct_node[current], mt, transposition_mode ? uct_node : nullptr);
 }
 
 
@@ -1300,30 +2254,226 @@ SelectMaxUcbChild( int current, int color, std::mt19937_64 &mt )
  * @brief Update statistic information.
  * @param[in] game Board position data.
  * @param[in] winner Winner's color.
+ * @param[in] thread_id Search thread ID.
  * @~japanese
  * @brief 統計情報の更新
  * @param[in] game 局面情報
  * @param[in] winner 勝った手番の色
+ * @param[in] thread_id 探索スレッドのID
  */
 static void
-Statistic( game_info_t *game, int winner )
+Statistic( game_info_t *game, int winner, const int thread_id )
 {
-  const char *board = game->board;
+  statistic_shard_t &shard = *statistic_shard[thread_id];
+  ownership_batch_t &batch = *ownership_batch[thread_id];
 
-  for (int i = 0; i < pure_board_max; i++) {
-    const int pos = onboard_pos[i];
-    int color = board[pos];
+  // まとめたプレイアウトが溜まっていたらノードに加算する
+  if (batch.playout_num == OWNERSHIP_BATCH_PLAYOUTS) {
+    FlushOwnership(thread_id);
+  }
+
+  unsigned long long (&area)[S_OB][BITBOARD_WORDS] = batch.area[batch.playout_num++];
+
+  // 各色の領域とどちらの領域でもない点を求める (Ownershipの更新でも使う)
+  CalculateAreaBits(game, area[S_BLACK], area[S_WHITE]);
+  for (int i = 0; i < bitboard_words; i++) {
+    area[S_EMPTY][i] = board_bits[i] & ~(area[S_BLACK][i] | area[S_WHITE][i]);
+  }
+
+  for (int color = S_EMPTY; color < S_OB; color++) {
+    for (int i = 0; i < bitboard_words; i++) {
+      unsigned long long bits = area[color][i];
+      while (bits != 0) {
+        const int pos = onboard_pos[(i << 6) + LowestBit(bits)];
+        bits &= bits - 1;
+        shard.point[pos].increment(color);
+        if (color == winner) {
+          shard.point[pos].increment(static_cast<int>(StatisticInformation::Win));
+        }
+      }
+    }
+  }
+  shard.win[winner].store(shard.win[winner].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  shard.count.store(shard.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+
+/**
+ * @~english
+ * @brief Record an ownership update of a node for the last playout of the thread.
+ * It is added to the node later by FlushOwnership.
+ * @param[in] thread_id Search thread ID.
+ * @param[in] node UCT node index.
+ * @param[in] color Color whose territory is counted.
+ * @~japanese
+ * @brief スレッドの直前のプレイアウトでのノードのOwnershipの更新の記録
+ * ノードへの加算は後でFlushOwnershipで行う
+ * @param[in] thread_id 探索スレッドのID
+ * @param[in] node ノードのインデックス
+ * @param[in] color 領域を数える色
+ */
+static void
+RecordOwnership( const int thread_id, const int node, const int color )
+{
+  ownership_batch_t &batch = *ownership_batch[thread_id];
+  const int playout = batch.playout_num - 1;
+
+  // 領域を数えないプレイアウトは記録しない
+  if (!batch.counted) {
+    return;
+  }
+
+  // 記録できなければその場で加算する
+  if (batch.update_num == OWNERSHIP_BATCH_ENTRIES) {
+    std::lock_guard<std::mutex> lock(mutex_nodes[node]);
+    UpdateOwnership(uct_node[node], batch.area[playout][color], batch.area[playout][S_EMPTY]);
+    return;
+  }
+
+  ownership_update_t &update = batch.update[batch.update_num++];
+
+  update.node = node;
+  update.playout = static_cast<short>(playout);
+  update.color = static_cast<short>(color);
+}
 
-    if (color == S_EMPTY) {
-      color = territory[Pat3(game->pat, pos)];
+
+/**
+ * @~english
+ * @brief Add ownership updates kept by the thread to nodes.
+ * Updates are sorted by node, and each node is locked once.
+ * @param[in] thread_id Search thread ID.
+ * @~japanese
+ * @brief スレッドが溜めたOwnershipの更新のノードへの加算
+ * 更新をノードの順に並べて, ノードごとに1度だけロックを取る
+ * @param[in] thread_id 探索スレッドのID
+ */
+static void
+FlushOwnership( const int thread_id )
+{
+  ownership_batch_t &batch = *ownership_batch[thread_id];
+  const ownership_update_t *update = batch.update;
+  const int update_num = batch.update_num;
+
+  qsort(batch.update, update_num, sizeof(ownership_update_t), OwnershipUpdateComp);
+
+  for (int i = 0; i < update_num; ) {
+    const int node = update[i].node;
+    std::lock_guard<std::mutex> lock(mutex_nodes[node]);
+    for (; i < update_num && update[i].node == node; i++) {
+      const unsigned long long (&area)[S_OB][BITBOARD_WORDS] = batch.area[update[i].playout];
+      UpdateOwnership(uct_node[node], area[update[i].color], area[S_EMPTY]);
     }
+  }
+
+  batch.playout_num = 0;
+  batch.update_num = 0;
+}
+
+
+/**
+ * @~english
+ * @brief Comparator of ownership updates by node index.
+ * @param[in] a Left-hand value.
+ * @param[in] b Right-hand value.
+ * @return Order judgment.
+ * @~japanese
+ * @brief Ownershipの更新のノードのインデックスによる大小比較
+ * @param[in] a 左辺値
+ * @param[in] b 右辺値
+ * @return 並び順の判定
+ */
+static int
+OwnershipUpdateComp( const void *a, const void *b )
+{
+  const ownership_update_t *ua = static_cast<const ownership_update_t *>(a);
+  const ownership_update_t *ub = static_cast<const ownership_update_t *>(b);
+
+  if (ua->node < ub->node) {
+    return -1;
+  } else if (ua->node > ub->node) {
+    return 1;
+  } else {
+    return 0;
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Clear statistic information of all threads.
+ * @~japanese
+ * @brief 全スレッドの統計情報のクリア
+ */
+static void
+ClearStatistic( void )
+{
+  for (int i = 0; i < board_max; i++) {
+    statistic[i].clear();
+  }
+  statistic_count = 0;
+  for (int i = 0; i < threads; i++) {
+    statistic_shard[i]->clear();
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Merge statistic information of all threads.
+ * @param[out] dest Merged statistic information.
+ * @return The number of collected simulations.
+ * @~japanese
+ * @brief 全スレッドの統計情報の合算
+ * @param[out] dest 合算した統計情報
+ * @return 統計情報を収集した回数
+ */
+static int
+MergeStatistic( statistic_t *dest )
+{
+  constexpr int info_max = static_cast<int>(StatisticInformation::Max);
+  int count = 0;
 
-    std::atomic_fetch_add(&statistic[pos].colors[color], 1);
-    if (color == winner) {
-      std::atomic_fetch_add(&statistic[pos].colors[static_cast<int>(StatisticInformation::Win)], 1);
+  for (int i = 0; i < board_max; i++) {
+    int sum[info_max] = { 0 };
+    for (int j = 0; j < threads; j++) {
+      for (int k = 0; k < info_max; k++) {
+        sum[k] += statistic_shard[j]->point[i].colors[k].load(std::memory_order_relaxed);
+      }
+    }
+    for (int k = 0; k < info_max; k++) {
+      dest[i].colors[k].store(sum[k], std::memory_order_relaxed);
     }
   }
-  std::atomic_fetch_add(&statistic_count, 1);
+
+  for (int j = 0; j < threads; j++) {
+    count += statistic_shard[j]->count.load(std::memory_order_relaxed);
+  }
+
+  return count;
+}
+
+
+/**
+ * @~english
+ * @brief Merge the number of collected simulations won by a color over all threads.
+ * @param[in] color Player's color.
+ * @return The number of won simulations.
+ * @~japanese
+ * @brief 全スレッドの統計情報を収集したシミュレーションで勝った回数の合算
+ * @param[in] color 手番の色
+ * @return 勝った回数
+ */
+static int
+MergeStatisticWin( const int color )
+{
+  int win = 0;
+
+  for (int j = 0; j < threads; j++) {
+    win += statistic_shard[j]->win[color].load(std::memory_order_relaxed);
+  }
+
+  return win;
 }
 
 
@@ -1332,20 +2482,22 @@ Statistic( game_info_t *game, int winner )
  * @brief Calculate criticality feature index.
  * @param[in] node UCT node.
  * @param[in] node_statistic Statistic information for UCT node.
+ * @param[in] count The number of collected simulations.
  * @param[in] color Player's color.
  * @param[in] index Criticality feature index.
  * @~japanese
  * @brief Criticalityの特徴インデックスの計算
  * @param[in] node UCTノード
  * @param[in] node_statistic UCTノードの統計情報
+ * @param[in] count 統計情報を収集した回数
  * @param[in] color 手番の色
  * @param[in] index Criticalityの特徴インデックス
  */
 static void
-CalculateCriticalityIndex( uct_node_t *node, statistic_t *node_statistic, int color, int *index )
+CalculateCriticalityIndex( uct_node_t *node, statistic_t *node_statistic, const int count, int color, int *index )
 {
   const int other = GetOppositeColor(color);
-  const double inv_count = (statistic_count.load() > 0) ? 1.0 / statistic_count.load() : 1.0;
+  const double inv_count = (count > 0) ? 1.0 / count : 1.0;
   const int child_num = node->child_num;
   const double win = static_cast<double>(node->win) / node->move_count;
   const double lose = 1.0 - win;
@@ -1370,16 +2522,19 @@ CalculateCriticalityIndex( uct_node_t *node, statistic_t *node_statistic, int co
  * @~english
  * @brief Calculate criticality.
  * @param[in] color Player's color.
+ * @param[in] count The number of collected simulations.
  * @~japanese
  * @brief Criticalityの計算
  * @param[in] color 手番の色
+ * @param[in] count 統計情報を収集した回数
  */
 static void
-CalculateCriticality( int color )
+CalculateCriticality( int color, const int count )
 {
   const int other = GetOppositeColor(color);
-  const double inv_count = (statistic_count.load() > 0) ? 1.0 / statistic_count.load() : 1.0;
-  const double win = static_cast<double>(uct_node[current_root].win) / uct_node[current_root].move_count;
+  const double inv_count = (count > 0) ? 1.0 / count : 1.0;
+  // 勝率も統計情報と同じシミュレーションから求める (合算の後に増えた分があるので1で抑える)
+  const double win = std::min(1.0, MergeStatisticWin(color) * inv_count);
   const double lose = 1.0 - win;
   double tmp;
 
@@ -1403,19 +2558,21 @@ CalculateCriticality( int color )
  * @brief Calculate ownership feature index.
  * @param[in] node UCT node.
  * @param[in] node_statistic Statistic information for UCT node.
+ * @param[in] count The number of collected simulations.
  * @param[in] color Player's color
  * @param[in] index Ownership feature index.
  * @~japanese
  * @brief Ownershipの特徴インデックスの計算
  * @param[in] node UCTノード
  * @param[in] node_statistic UCTノードの統計情報
+ * @param[in] count 統計情報を収集した回数
  * @param[in] color 手番の色
  * @param[in] index Ownerの特徴インデックス
  */
 static void
-CalculateOwnerIndex( uct_node_t *node, statistic_t *node_statistic, int color, int *index )
+CalculateOwnerIndex( uct_node_t *node, statistic_t *node_statistic, const int count, int color, int *index )
 {
-  const double inv_count = (statistic_count.load() > 0) ? 1.0 / statistic_count.load() : 1.0;
+  const double inv_count = (count > 0) ? 1.0 / count : 1.0;
   const int child_num = node->child_num;
 
   index[0] = 0;
@@ -1433,14 +2590,16 @@ CalculateOwnerIndex( uct_node_t *node, statistic_t *node_statistic, int color, i
  * @~english
  * @brief Calculate ownership feature index.
  * @param[in] color Player's color.
+ * @param[in] count The number of collected simulations.
  * @~japanese
  * @brief Ownershipの特徴インデックスの計算
  * @param[in] color 手番の色
+ * @param[in] count 統計情報を収集した回数
  */
 static void
-CalculateOwner( int color )
+CalculateOwner( int color, const int count )
 {
-  const double inv_count = (statistic_count.load() > 0) ? 1.0 / statistic_count.load() : 1.0;
+  const double inv_count = (count > 0) ? 1.0 / count : 1.0;
 
   for (int i = 0; i < pure_board_max; i++){
     const int pos = onboard_pos[i];
@@ -1466,13 +2625,8 @@ CalculateOwner( int color )
 int
 UctAnalyze( game_info_t *game, int color )
 {
-  std::thread *worker[THREAD_MAX];
-
   // 探索情報をクリア
-  for (int i = 0; i < board_max; i++) {
-    statistic[i].clear();
-  }
-  statistic_count = 0;
+  ClearStatistic();
   std::fill_n(criticality_index, board_max, 0);  
   for (int i = 0; i < board_max; i++) {
     criticality[i] = 0.0;
@@ -1485,22 +2639,24 @@ UctAnalyze( game_info_t *game, int color )
 
   SetPoHalt(10000);
 
+  InitializeGarbageCollection();
+
   for (int i = 0; i < threads; i++) {
     t_arg[i].thread_id = i;
     t_arg[i].game = game;
     t_arg[i].color = color;
     t_arg[i].lz_analysis_cs = -1;
-    worker[i] = new std::thread(ParallelUctSearch, &t_arg[i]);
+    t_arg[i].time_extension = false;
   }
 
-  for (int i = 0; i < threads; i++) {
-    worker[i]->join();
-    delete worker[i];
-  }
+  SetSimulationRoot(game);
+  StartSearchJob(ParallelUctSearch);
+  WaitSearchJob();
 
   int black = 0, white = 0;
+  const int count = MergeStatistic(statistic);
 
-  const int inv_count = 1.0 / statistic_count.load();
+  const int inv_count = 1.0 / count;
   for (int y = board_start; y <= board_end; y++) {
     for (int x = board_start; x <= board_end; x++) {
       const int pos = POS(x, y);
@@ -1513,7 +2669,7 @@ UctAnalyze( game_info_t *game, int color )
     }
   }
 
-  PrintOwner(&uct_node[current_root], statistic, color, statistic_count.load(), owner);
+  PrintOwner(&uct_node[current_root], statistic, color, count, owner);
 
   return black - white;
 }
@@ -1530,9 +2686,13 @@ UctAnalyze( game_info_t *game, int color )
 void
 OwnerCopy( int *dest )
 {
+  statistic_t merged[BOARD_MAX];
+  const int count = MergeStatistic(merged);
+  const double inv_count = (count > 0) ? 1.0 / count : 0.0;
+
   for (int i = 0; i < pure_board_max; i++) {
     const int pos = onboard_pos[i];
-    dest[pos] = static_cast<int>(static_cast<double>(statistic[pos].colors[my_color]) / uct_node[current_root].move_count * 100);
+    dest[pos] = static_cast<int>(static_cast<double>(merged[pos].colors[my_color]) * inv_count * 100);
   }
 }
 
@@ -1566,9 +2726,7 @@ CopyCriticality( double *dest )
 void
 CopyStatistic( statistic_t *dest )
 {
-  for (int i = 0; i < board_max; i++) {
-    dest[i] = statistic[i];
-  }
+  MergeStatistic(dest);
 }
 
 
@@ -1589,12 +2747,8 @@ UctSearchGenmoveCleanUp( game_info_t *game, int color )
 {
   int pos;
   double wp;
-  std::thread *worker[THREAD_MAX];
 
-  for (int i = 0; i < board_max; i++) {
-    statistic[i].clear();
-  }
-  statistic_count = 0;
+  ClearStatistic();
   std::fill_n(criticality_index, board_max, 0); 
   for (int i = 0; i < board_max; i++) {
     criticality[i] = 0.0;
@@ -1619,18 +2773,19 @@ UctSearchGenmoveCleanUp( game_info_t *game, int color )
 
   DynamicKomi(game, &uct_node[current_root], color);
 
+  InitializeGarbageCollection();
+
   for (int i = 0; i < threads; i++) {
     t_arg[i].thread_id = i;
     t_arg[i].game = game;
     t_arg[i].color = color;
     t_arg[i].lz_analysis_cs = -1;
-    worker[i] = new std::thread(ParallelUctSearch, &t_arg[i]);
+    t_arg[i].time_extension = false;
   }
 
-  for (int i = 0; i < threads; i++) {
-    worker[i]->join();
-    delete worker[i];
-  }
+  SetSimulationRoot(game);
+  StartSearchJob(ParallelUctSearch);
+  WaitSearchJob();
 
   child_node_t *uct_child = uct_node[current_root].child;
 
@@ -1643,7 +2798,7 @@ UctSearchGenmoveCleanUp( game_info_t *game, int color )
   const int po_speed = static_cast<int>(CalculatePlayoutSpeed(finish_time, threads));
 
   PrintPlayoutInformation(&uct_node[current_root], po_speed, finish_time, 0);
-  PrintOwner(&uct_node[current_root], statistic, color, statistic_count.load(), owner);
+  PrintOwner(&uct_node[current_root], statistic, color, MergeStatistic(statistic), owner);
 
   PrintBestSequence(game, uct_node, current_root, color);
 
@@ -1678,27 +2833,226 @@ UctSearchGenmoveCleanUp( game_info_t *game, int color )
 
 /**
  * @~english
- * @brief Correct descendent node indices.
- * @param[in, out] indexes Descendent node indices.
- * @param[in] index Node index.
+ * @brief Get hash value to look up nodes. In transposition mode it is the hash value
+ * of the position including ko and passes, otherwise it is the hash value of the move sequence.
+ * @param[in] game Board position data.
+ * @return Hash value for nodes.
+ * @~japanese
+ * @brief ノードを引くためのハッシュ値の取得
+ * 局面を合流させる時は劫とパスを含めた局面のハッシュ値, それ以外は着手の履歴のハッシュ値
+ * @param[in] game 局面情報
+ * @return ノード用のハッシュ値
+ */
+static unsigned long long
+GetNodeHash( const game_info_t *game )
+{
+  return transposition_mode ? game->current_hash : game->move_hash;
+}
+
+
+/**
+ * @~english
+ * @brief Prepare garbage collection during search. It must be called before search threads start.
  * @~japanese
- * @brief 子孫ノードのインデックスの収集
- * @param[in, out] indexes 子孫ノードのインデックス
- * @param[in] index 現在のインデックス
+ * @brief 探索中のノードの回収の準備 (探索スレッドを起動する前に呼び出す)
  */
 static void
-CorrectDescendentNodes( std::vector<int> &indexes, int index )
+InitializeGarbageCollection( void )
 {
-  child_node_t *uct_child = uct_node[index].child;
-  const int child_num = uct_node[index].child_num;
+  gc_request = false;
+  gc_available = true;
+  gc_searching_threads = threads;
+  gc_waiting_threads = 0;
+}
 
-  indexes.push_back(index);
 
-  for (int i = 0; i < child_num; i++) {
-    if (uct_child[i].index != NOT_EXPANDED) {
-      CorrectDescendentNodes(indexes, uct_child[i].index);
+/**
+ * @~english
+ * @brief Wait outside the tree until garbage collection finishes.
+ * @~japanese
+ * @brief 探索中のノードの回収が終わるまで探索木の外で待つ
+ */
+static void
+WaitGarbageCollection( const int thread_id )
+{
+  // 回収されるノードへの更新を残さない
+  FlushOwnership(thread_id);
+
+  // 待っている間はスレッド0が配る探索木の整理の仕事を手伝う
+  // 仕事は待っているスレッドが揃ってから配られるので, 通し番号は数に入る前に読む
+  int task_number = tree_task_number;
+
+  gc_waiting_threads++;
+  while (gc_request) {
+    if (tree_task_number != task_number) {
+      task_number++;
+      tree_task();
+      tree_task_helpers++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  gc_waiting_threads--;
+}
+
+
+/**
+ * @~english
+ * @brief Notify that a search thread has finished. Finished threads are not waited for by garbage collection.
+ * @param[in] thread_id Search thread ID.
+ * @~japanese
+ * @brief 探索スレッドの終了の通知 (終了したスレッドはノードの回収で待たない)
+ * @param[in] thread_id 探索スレッドのID
+ */
+static void
+LeaveGarbageCollection( const int thread_id )
+{
+  // 終了したスレッドはノードの回収を待たないので, 先に更新を加算する
+  FlushOwnership(thread_id);
+
+  // ノードを回収するスレッド0が抜けたら, 他のスレッドもハッシュが埋まった時点で止める
+  if (thread_id == 0) {
+    gc_available = false;
+  }
+  gc_searching_threads--;
+}
+
+
+/**
+ * @~english
+ * @brief Collect garbage nodes during search. It is called from thread 0 when the hash table
+ * or the node arena fills up. After the other threads stop outside the tree, subtrees whose
+ * visits are fewer than the nodes on the hot path are cut off so that about half of the
+ * hash table remains, and their entries and blocks are released. Moves at the root and
+ * statistics on cut moves are kept, so the moves are expanded again if they are searched.
+ * @return Whether enough memory is available to continue searching.
+ * @~japanese
+ * @brief 探索中のノードの回収
+ * ハッシュ表かノードのメモリ領域が埋まった時にスレッド0から呼び出す
+ * 他のスレッドが探索木の外で止まってから, ハッシュ表の半分程度が残るように
+ * 探索回数の少ない部分木を切り離し, そのエントリとブロックを返却する
+ * ルートの着手と切り離した着手の探索結果は残すので, 再び探索されれば展開し直す
+ * @return 探索を続けられるだけの余裕があればtrue
+ */
+static bool
+CollectGarbageNodes( void )
+{
+  if (!gc_available) {
+    return false;
+  }
+
+  // 回収されるノードへの更新を残さない
+  FlushOwnership(0);
+
+  // 他のスレッドが探索木の外で止まるまで待つ
+  gc_request = true;
+  while (gc_waiting_threads < gc_searching_threads - 1) {
+    std::this_thread::yield();
+  }
+
+  const ray_clock::time_point start_time = ray_clock::now();
+  const int before = static_cast<int>(GetUsedHashSize());
+
+  // 辿れるノードを現在の世代に付け直し, ルート以外の探索回数を集める
+  MarkRetainedNodes(current_root);
+
+  std::vector<int> counts;
+  const int node_num = block_node_num;
+  for (int i = 0; i < node_num; i++) {
+    const int index = block_nodes[i];
+    if (index != current_root && IsUsedHashIndex(index)) {
+      counts.push_back(uct_node[index].move_count);
+    }
+  }
+
+  const int reachable_num = static_cast<int>(counts.size()) + 1;
+  int keep_num = static_cast<int>(uct_hash_size / 2);
+
+  // 序盤は子ノードが多くメモリ領域が先に埋まるので,
+  // 割り当て中のメモリ量が全体の1/4程度に収まるように残すノード数を減らす
+  // (探索を続けられるのは上限の半分以下なので, 回収の直後に再び埋まらないように余裕を持たせる)
+  const size_t arena_used = GetNodeArenaUsedSize();
+  const size_t arena_keep = GetNodeArenaSize() / 4;
+  if (arena_used > arena_keep) {
+    const int arena_keep_num = static_cast<int>(static_cast<double>(reachable_num) * arena_keep / arena_used);
+    keep_num = std::min(keep_num, arena_keep_num);
+  }
+
+  if (reachable_num > keep_num) {
+    // 残すノード数に合わせて探索回数の閾値を決める
+    const int cut_num = static_cast<int>(counts.size()) - keep_num;
+    int threshold = -1;
+    if (cut_num > 0) {
+      std::nth_element(counts.begin(), counts.begin() + cut_num, counts.end());
+      threshold = counts[cut_num];
+    }
+
+    // ルート以外で探索回数が閾値以下のノードへの枝を切る
+    for (int j = 0; j < node_num; j++) {
+      const int index = block_nodes[j];
+      if (index == current_root || !IsUsedHashIndex(index)) continue;
+      child_node_t *uct_child = uct_node[index].child;
+      const int child_num = uct_node[index].child_num;
+      for (int i = 0; i < child_num; i++) {
+        const int child_index = uct_child[i].index;
+        if (IsExpandedIndex(child_index) &&
+            uct_node[child_index].move_count <= threshold) {
+          uct_child[i].index = NOT_EXPANDED;
+        }
+      }
+    }
+  }
+
+  // 辿れなくなったノードを削除する
+  RetainDescendentNodes(current_root);
+
+  PrintGarbageCollection(before, static_cast<int>(GetUsedHashSize()), GetSpendTime(start_time));
+
+  const bool enough_size = CheckRemainingHashSize() && CheckRemainingNodeArena();
+
+  // 空けられなければ以降は回収せず, 他のスレッドも止める
+  if (!enough_size) {
+    gc_available = false;
+  }
+
+  gc_request = false;
+
+  return enough_size;
+}
+
+
+/**
+ * @~english
+ * @brief Link a move which is not expanded yet to the node of the same position
+ * if another path has already built it.
+ * @param[in] game Board position data after the move.
+ * @param[in] color Player's color after the move.
+ * @param[in, out] child Move candidate.
+ * @return Whether the move leads to a built node.
+ * @~japanese
+ * @brief 未展開の着手の, 他の経路で作り終えた同じ局面のノードへの接続
+ * @param[in] game 着手後の局面情報
+ * @param[in] color 着手後の手番の色
+ * @param[in, out] child 着手のノード
+ * @return 作り終えたノードに繋がっていればtrue
+ */
+static bool
+LinkTransposedNode( const game_info_t *game, const int color, child_node_t &child )
+{
+  int index = child.index;
+
+  if (index == NOT_EXPANDED) {
+    const unsigned int found = FindSameHashIndex(GetNodeHash(game), color, game->moves);
+    // 作っている途中のノードには繋がずにシミュレーションする
+    if (found == uct_hash_size || !uct_node[found].expanded) {
+      return false;
     }
-  }   
+    int expected = NOT_EXPANDED;
+    child.index.compare_exchange_strong(expected, static_cast<int>(found));
+    index = child.index;
+  }
+
+  return IsExpandedIndex(index);
 }
 
 
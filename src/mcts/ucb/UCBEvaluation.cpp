@@ -36,6 +36,10 @@ static double bonus_equivalence = BONUS_EQUIVALENCE;
 static double ucb_c = UCB_COEFFICIENT;
 
 
+//  合流を考慮した着手の勝ち数の取得
+static double GetChildWin( const child_node_t &child, const uct_node_t *nodes );
+
+
 /**
  * @~english
  * @brief Calculate move score bonus.
@@ -82,19 +86,21 @@ CalculateUCB1Value( const child_node_t &child, const int total_visits )
  * @~english
  * @brief Calculate UCB1-Tuned value.
  * @param[in] child Next move candidate.
+ * @param[in] win The number of wins of the move.
  * @param[in] total_visits Total visits count of a current node.
  * @return UCB1-Tuned value.
  * @~japanese
  * @brief UCB1-Tuned値を返す
  * @param[in] child 次の着手のノード
+ * @param[in] win 着手の勝ち数
  * @param[in] total_visits 現在のノードの探索回数合計値
  * @return UCB1-Tuned値
  */
 double
-CalculateUCB1TunedValue( const child_node_t &child, const int total_visits )
+CalculateUCB1TunedValue( const child_node_t &child, const double win, const int total_visits )
 {
   const int move_count = child.move_count + child.virtual_loss.load();
-  const double p = static_cast<double>(child.win) / move_count;
+  const double p = win / move_count;
   const double div = std::log(total_visits) / move_count;
   const double v = p - p * p + std::sqrt(2.0 * div);
 
@@ -102,20 +108,54 @@ CalculateUCB1TunedValue( const child_node_t &child, const int total_visits )
 }
 
 
+/**
+ * @~english
+ * @brief Get the number of wins of a move. When the node table is given, the winning rate
+ * of the next node is used, so all moves which reach the same position share it.
+ * @param[in] child Next move candidate.
+ * @param[in] nodes Node table (nullptr if positions are not merged).
+ * @return The number of wins of the move.
+ * @~japanese
+ * @brief 着手の勝ち数の取得
+ * ノードの表が渡された時は次のノードの勝率を使うので, 同じ局面に合流する着手は勝率を共有する
+ * @param[in] child 次の着手のノード
+ * @param[in] nodes ノードの表 (局面を合流させない時はnullptr)
+ * @return 着手の勝ち数
+ */
+static double
+GetChildWin( const child_node_t &child, const uct_node_t *nodes )
+{
+  const int index = child.index;
+
+  if (nodes != nullptr && IsExpandedIndex(index)) {
+    const uct_node_t &next = nodes[index];
+    const int node_count = next.move_count;
+    // 次のノードの勝率は相手の手番から見た値
+    if (node_count > 0) {
+      return child.move_count * (1.0 - static_cast<double>(next.win) / node_count);
+    }
+  }
+
+  return child.win;
+}
+
+
 /**
  * @~english
  * @brief Select child node by UCB1 value .
  * @param[in] node Current node.
  * @param[in] mt Random number generator.
+ * @param[in] nodes Node table to share values of merged positions (nullptr if positions are not merged).
  * @return Next move node index.
  * @~japanese
  * @brief UCB1値最大の子ノードを返す
  * @param[in] node 現在のノード
  * @param[in] mt 乱数生成器
+ * @param[in] nodes 合流した局面の値を共有するためのノードの表 (局面を合流させない時はnullptr)
  * @return 次の着手のノードのインデックス
  */
 int
-SelectBestChildIndexByUCB1( const uct_node_t &node, std::mt19937_64 &mt )
+SelectBestChildIndexByUCB1( const uct_node_t &node, std::mt19937_64 &mt, const uct_node_t *nodes )
 {
   const int child_num = node.child_num;
   const int sum = node.move_count + node.virtual_loss.load();
@@ -131,7 +171,7 @@ SelectBestChildIndexByUCB1( const uct_node_t &node, std::mt19937_64 &mt )
       if (move_count == 0) {
         ucb_value = FPU + 0.0001 * (mt() % 10000);
       } else {
-        ucb_value = CalculateUCB1TunedValue(child[i], sum) + CalculateMoveScoreBonus(child[i], move_score_bonus_weight);
+        ucb_value = CalculateUCB1TunedValue(child[i], GetChildWin(child[i], nodes), sum) + CalculateMoveScoreBonus(child[i], move_score_bonus_weight);
       }
       if (ucb_value > max_value) {
         max_value = ucb_value;
@@ -82,6 +82,35 @@ constexpr unsigned long long random_bitstrings[BIT_MAX][S_MAX] = {
 };
 
 
+/**
+ * @~english
+ * @brief The number of bytes of bitstrings (4 intersections per byte).
+ * @~japanese
+ * @brief ビット列のバイト数 (1バイトに4交点)
+ */
+constexpr int BYTE_MAX = BIT_MAX / 4;
+
+
+/**
+ * @~english
+ * @brief Zobrist hash values for each byte of a pattern bitstring.
+ * @~japanese
+ * @brief パターンのビット列の各バイトに対するZobrist Hash
+ */
+struct byte_hash_table_t {
+  /**
+   * @~english
+   * @brief Hash values indexed by byte position and byte value.
+   * @~japanese
+   * @brief バイトの位置と値で指定するハッシュ値
+   */
+  unsigned long long hash[BYTE_MAX][256];
+};
+
+
+//  バイト単位のハッシュ値のテーブルの作成
+static byte_hash_table_t MakeByteHashTable( void );
+
 //  パターンのハッシュ関数
 static unsigned long long MD2Hash( const unsigned int md2 );
 static unsigned long long MD3Hash( const unsigned int md3 );
@@ -89,13 +118,82 @@ static unsigned long long MD4Hash( const unsigned int md4 );
 static unsigned long long MD5Hash( const unsigned long long md5 );
 
 
+/**
+ * @~english
+ * @brief Zobrist hash values for each byte.
+ * @~japanese
+ * @brief バイト単位のハッシュ値のテーブル
+ */
+static const byte_hash_table_t byte_hash = MakeByteHashTable();
+
+
+/**
+ * @~english
+ * @brief Make hash values for each byte from bit masks.
+ * @return Hash values for each byte.
+ * @~japanese
+ * @brief ビットマスクからバイト単位のハッシュ値のテーブルを作成
+ * @return バイト単位のハッシュ値のテーブル
+ */
+static byte_hash_table_t
+MakeByteHashTable( void )
+{
+  byte_hash_table_t table;
+
+  for (int i = 0; i < BYTE_MAX; i++) {
+    for (int value = 0; value < 256; value++) {
+      unsigned long long hash = 0;
+      for (int j = 0; j < 4; j++) {
+        hash ^= random_bitstrings[i * 4 + j][(value >> (j * 2)) & 0x3];
+      }
+      table.hash[i][value] = hash;
+    }
+  }
+
+  return table;
+}
+
+
+/**
+ * @~english
+ * @brief Return hash value of a bitstring from the hash values for each byte.
+ * @param[in] bits Bitstring.
+ * @param[in] start First byte position in the bit masks.
+ * @param[in] bytes The number of bytes.
+ * @return Hash value of the bitstring.
+ * @~japanese
+ * @brief バイト単位のハッシュ値からビット列のハッシュ値を算出
+ * @param[in] bits ビット列
+ * @param[in] start ビットマスクでの最初のバイトの位置
+ * @param[in] bytes バイト数
+ * @return ビット列のハッシュ値
+ */
+static inline unsigned long long
+ByteHash( unsigned long long bits, const int start, const int bytes )
+{
+  unsigned long long hash = 0;
+
+  for (int i = start; i < start + bytes; i++) {
+    hash ^= byte_hash.hash[i][bits & 0xFF];
+    bits >>= 8;
+  }
+
+  return hash;
+}
+
+
 /**
  * @~english
  * @brief Calculate hash value of pattern.
+ * The 16 symmetrical patterns are derived on each call instead of being kept on the board.
+ * This is called only when a node is expanded, about as often as PutStone in the tree,
+ * so keeping them up to date for every stone would cost more than deriving them here.
  * @param[in] pat Instance of stones pattern.
  * @param[out] hash_pat Hash value of pattern.
  * @~japanese
  * @brief パターンのハッシュ値の算出
+ * 16通りの対称形は盤面に保持せず, 呼び出しごとに求める
+ * 呼び出しはノードの展開時だけで探索木の中のPutStoneと同程度の回数なので, 石を置くたびに保持し直す方が高くつく
  * @param[in] pat 配石パターンのインスタンス
  * @param[out] hash_pat パターンのハッシュ値
  */
@@ -163,13 +261,7 @@ PatternHash( const pattern_t *pat, pattern_hash_t *hash_pat )
 static unsigned long long
 MD2Hash( const unsigned int md2 )
 {
-  unsigned long long hash = 0;
-
-  for (int i = 0; i < 12; i++) {
-    hash ^= random_bitstrings[i][(md2 >> (i * 2)) & 0x3];
-  }
-
-  return hash;
+  return ByteHash(md2, 0, 3);
 }
 
 
@@ -186,13 +278,7 @@ MD2Hash( const unsigned int md2 )
 static unsigned long long
 MD3Hash( const unsigned int md3 )
 {
-  unsigned long long hash = 0;
-
-  for (int i = 0; i < 12; i++) {
-    hash ^= random_bitstrings[i + 12][(md3 >> (i * 2)) & 0x3];
-  }
-
-  return hash;
+  return ByteHash(md3, 3, 3);
 }
 
 
@@ -209,13 +295,7 @@ MD3Hash( const unsigned int md3 )
 static unsigned long long
 MD4Hash( const unsigned int md4 )
 {
-  unsigned long long hash = 0;
-
-  for (int i = 0; i < 16; i++) {
-    hash ^= random_bitstrings[i + 24][(md4 >> (i * 2)) & 0x3];
-  }
-  
-  return hash;
+  return ByteHash(md4, 6, 4);
 }
 
 
@@ -232,13 +312,7 @@ MD4Hash( const unsigned int md4 )
 static unsigned long long
 MD5Hash( const unsigned long long md5 )
 {
-  unsigned long long hash = 0;
-
-  for (int i = 0; i < 20; i++) {
-    hash ^= random_bitstrings[i + 40][(md5 >> (i * 2)) & 0x3];
-  }
-
-  return hash;
+  return ByteHash(md5, 10, 5);
 }
 
 
@@ -275,3 +349,53 @@ SearchIndex( const index_hash_t *index, const unsigned long long hash )
 
   return -1;
 }
+
+
+/**
+ * @~english
+ * @brief Build pattern index from a hash table with linear probing.
+ * Only entries which SearchIndex can find are stored, so lookups give the same results.
+ * @param[out] table Pattern index.
+ * @param[in] index Hash table with linear probing (HASH_MAX entries).
+ * @~japanese
+ * @brief 線形探索のハッシュテーブルからパターンのインデックスを作成
+ * SearchIndexで見つかる要素だけを格納するので, 探索結果は変わらない
+ * @param[out] table パターンのインデックス
+ * @param[in] index 線形探索のハッシュテーブル (HASH_MAX要素)
+ */
+void
+BuildPatternIndex( pattern_index_t *table, const index_hash_t index[] )
+{
+  int entries = 0;
+
+  for (int i = 0; i < HASH_MAX; i++) {
+    if (index[i].hash != 0) entries++;
+  }
+
+  // 1バケットあたり平均4要素以下になるバケット数
+  unsigned int buckets = 1;
+  while (buckets < PATTERN_BUCKET_MAX &&
+         buckets * (PATTERN_BUCKET_SIZE - 1) < static_cast<unsigned int>(entries)) {
+    buckets <<= 1;
+  }
+  table->mask = buckets - 1;
+
+  for (unsigned int i = 0; i < buckets; i++) {
+    table->bucket[i].num = 0;
+  }
+
+  for (int i = 0; i < HASH_MAX; i++) {
+    const unsigned long long hash = index[i].hash;
+    if (hash == 0 || SearchIndex(index, hash) != index[i].index) continue;
+
+    unsigned int key = TransHash20(hash) & table->mask;
+    while (table->bucket[key].num == PATTERN_BUCKET_SIZE) {
+      key = (key + 1) & table->mask;
+    }
+
+    pattern_bucket_t &bucket = table->bucket[key];
+    bucket.hash[bucket.num] = hash;
+    bucket.index[bucket.num] = index[i].index;
+    bucket.num++;
+  }
+}
@@ -17,6 +17,7 @@
 #include "common/Message.hpp"
 #include "mcts/MoveSelection.hpp"
 #include "mcts/SearchManager.hpp"
+#include "mcts/Simulation.hpp"
 #include "mcts/UctSearch.hpp"
 #include "util/Command.hpp"
 
@@ -42,6 +43,9 @@ const std::string command[COMMAND_MAX] = {
   "--superko",
   "--resign",
   "--cgos",
+  "--transposition",
+  "--numa",
+  "--mercy",
 };
 
 /**
@@ -65,6 +69,9 @@ const std::string errmessage[COMMAND_MAX] = {
   "Prohibit superko move",
   "Set resign threshold (threshold is must be [0.0, 1.0])",
   "Set CGOS player mode",
+  "Merge transposed positions in the search tree",
+  "Pin search threads to cores and interleave the search tree over NUMA nodes",
+  "Finish a playout when the difference of captured stones reaches the value",
 };
 
 
@@ -106,7 +113,7 @@ AnalyzeCommand( int argc, char **argv )
         // 碁盤の大きさの設定
         size = atoi(argv[++i]);
         if (pure_board_size != size &&
-            size > 0 && size <= PURE_BOARD_SIZE) {
+            size >= MIN_PURE_BOARD_SIZE && size <= PURE_BOARD_SIZE) {
           SetBoardSize(size);
           SetParameter();
         }
@@ -152,6 +159,18 @@ AnalyzeCommand( int argc, char **argv )
       case COMMAND_CGOS_MODE:
         SetCaptureAllMode(true);
         break;
+      case COMMAND_TRANSPOSITION:
+        // 局面の合流の設定
+        SetTranspositionMode(true);
+        break;
+      case COMMAND_NUMA:
+        // NUMAモードの設定
+        SetNumaMode(true);
+        break;
+      case COMMAND_MERCY:
+        // シミュレーションを打ち切るアゲハマの差の設定
+        SetMercyThreshold(atoi(argv[++i]));
+        break;
       case COMMAND_NO_DEBUG:
         // デバッグメッセージを出力しない設定
         SetDebugMessageMode(false);
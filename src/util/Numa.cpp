@@ -0,0 +1,236 @@
+/**
+ * @file src/util/Numa.cpp
+ * @author Yuki Kobayashi
+ * @~english
+ * @brief Thread pinning and memory placement for NUMA systems.
+ * Topology is read from sysfs and memory is placed by the mbind system call,
+ * so no additional library is required. Other systems are treated as one node.
+ * @~japanese
+ * @brief NUMA環境でのスレッドの固定とメモリの配置
+ * 構成はsysfsから読み, メモリはmbindシステムコールで配置するので追加のライブラリは要らない
+ * Linux以外では1つのノードとして扱う
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util/Numa.hpp"
+#include "util/Utility.hpp"
+
+#if defined (_WIN32)
+#include <Windows.h>
+#elif defined (__linux__)
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+/**
+ * @~english
+ * @brief NUMA node IDs.
+ * @~japanese
+ * @brief NUMAノードのID
+ */
+static std::vector<int> node_id;
+
+/**
+ * @~english
+ * @brief CPU IDs belonging to each NUMA node.
+ * @~japanese
+ * @brief 各NUMAノードに属するCPUのID
+ */
+static std::vector<std::vector<int> > node_cpus;
+
+
+/**
+ * @~english
+ * @brief Read CPU list of sysfs (e.g. "0-3,8-11").
+ * @param[in] filename File name of the CPU list.
+ * @return CPU IDs.
+ * @~japanese
+ * @brief sysfsのCPUリスト (例 : "0-3,8-11") の読み込み
+ * @param[in] filename CPUリストのファイル名
+ * @return CPUのID
+ */
+static std::vector<int>
+ReadCpuList( const std::string &filename )
+{
+  std::ifstream ifs(filename);
+  std::string line;
+  std::vector<int> cpus;
+
+  if (!ifs || !std::getline(ifs, line) || line.empty()) {
+    return cpus;
+  }
+
+  for (const std::string &range : SplitString(line, ",")) {
+    const std::vector<std::string> ends = SplitString(range, "-");
+    const int first = std::atoi(ends[0].c_str());
+    const int last = ends.size() > 1 ? std::atoi(ends[1].c_str()) : first;
+    for (int cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  return cpus;
+}
+
+
+/**
+ * @~english
+ * @brief Read NUMA nodes and CPUs belonging to them.
+ * @~japanese
+ * @brief NUMAノードと所属するCPUの読み込み
+ */
+void
+InitializeNumaTopology( void )
+{
+  node_id.clear();
+  node_cpus.clear();
+
+#if defined (__linux__)
+  const std::string node_path = "/sys/devices/system/node/";
+
+  for (const int id : ReadCpuList(node_path + "online")) {
+    std::vector<int> cpus = ReadCpuList(node_path + "node" + std::to_string(id) + "/cpulist");
+    // メモリだけのノードは使わない
+    if (!cpus.empty()) {
+      node_id.push_back(id);
+      node_cpus.push_back(cpus);
+    }
+  }
+#endif
+
+  // 構成が読めなければ全CPUを1つのノードとする
+  if (node_id.empty()) {
+    const int cpu_num = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    node_id.push_back(0);
+    node_cpus.push_back(std::vector<int>());
+    for (int i = 0; i < cpu_num; i++) {
+      node_cpus[0].push_back(i);
+    }
+  }
+}
+
+
+/**
+ * @~english
+ * @brief Get the number of NUMA nodes.
+ * @return The number of NUMA nodes.
+ * @~japanese
+ * @brief NUMAノードの個数の取得
+ * @return NUMAノードの個数
+ */
+int
+GetNumaNodeNum( void )
+{
+  return static_cast<int>(node_id.size());
+}
+
+
+/**
+ * @~english
+ * @brief Get the NUMA node of a search thread. Search threads are assigned to nodes in turn.
+ * @param[in] thread_id Search thread ID.
+ * @return Index of the NUMA node (0 to GetNumaNodeNum() - 1).
+ * @~japanese
+ * @brief 探索スレッドを割り当てるNUMAノードの取得 (探索スレッドは順番にノードに割り当てる)
+ * @param[in] thread_id 探索スレッドのID
+ * @return NUMAノードの番号 (0からGetNumaNodeNum() - 1)
+ */
+int
+GetThreadNumaNode( const int thread_id )
+{
+  return node_id.empty() ? 0 : thread_id % GetNumaNodeNum();
+}
+
+
+/**
+ * @~english
+ * @brief Pin the calling thread to a CPU of the NUMA node assigned to the search thread.
+ * @param[in] thread_id Search thread ID.
+ * @return Whether the thread is pinned.
+ * @~japanese
+ * @brief 呼び出したスレッドを探索スレッドに割り当てたNUMAノードのCPUに固定する
+ * @param[in] thread_id 探索スレッドのID
+ * @return 固定できたらtrue
+ */
+bool
+PinCurrentThread( const int thread_id )
+{
+  if (node_id.empty()) {
+    return false;
+  }
+
+  const std::vector<int> &cpus = node_cpus[GetThreadNumaNode(thread_id)];
+  const int cpu = cpus[(thread_id / GetNumaNodeNum()) % cpus.size()];
+
+#if defined (_WIN32)
+  if (cpu >= 64) return false;
+  return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu) != 0;
+#elif defined (__linux__)
+  cpu_set_t cpu_set;
+
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+  return false;
+#endif
+}
+
+
+/**
+ * @~english
+ * @brief Interleave pages of a memory area over all NUMA nodes.
+ * It must be called before the pages are touched. Partial pages at both ends are left as they are.
+ * @param[in] address Head of the memory area.
+ * @param[in] size Size of the memory area.
+ * @~japanese
+ * @brief メモリ領域のページを全NUMAノードに交互に配置する
+ * ページに触れる前に呼び出す (両端の半端なページはそのままにする)
+ * @param[in] address メモリ領域の先頭
+ * @param[in] size メモリ領域の大きさ
+ */
+void
+InterleaveMemory( void *address, const size_t size )
+{
+#if defined (__linux__)
+  if (GetNumaNodeNum() < 2) {
+    return;
+  }
+
+  const uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  const uintptr_t head = (reinterpret_cast<uintptr_t>(address) + page_size - 1) / page_size * page_size;
+  const uintptr_t tail = (reinterpret_cast<uintptr_t>(address) + size) / page_size * page_size;
+  const int mask_bits = sizeof(unsigned long) * 8;
+  int max_id = 0;
+
+  if (head >= tail) {
+    return;
+  }
+
+  for (const int id : node_id) {
+    max_id = std::max(max_id, id);
+  }
+
+  std::vector<unsigned long> mask(max_id / mask_bits + 1, 0);
+
+  for (const int id : node_id) {
+    mask[id / mask_bits] |= 1UL << (id % mask_bits);
+  }
+
+  syscall(SYS_mbind, head, tail - head, MPOL_INTERLEAVE, mask.data(), mask.size() * mask_bits + 1, 0);
+#else
+  (void)address;
+  (void)size;
+#endif
+}